@@ -29,6 +29,12 @@ void *run_client(void *arg) {
     int ret;
     param_arr = malloc(num_threads * sizeof(struct configuration_params));
     thread_arr = malloc(num_threads * sizeof(pthread_t));
+    memcached_set_epoch(input_arg->epoch);
+    memcached_set_backend(input_arg->registry_mode);
+    mock_verbs_init(input_arg->verbs_mode, &rsec_config.mock_verbs);
+    rnic_sim_init(input_arg->data_path, RNIC_SIM_SEED + machine_id,
+                  &rsec_config.rnic_sim);
+    rsec_time_init();
     // initialize barrier
     ret = pthread_barrier_init(&local_barrier, NULL, input_arg->total_threads);
     if (ret)
@@ -96,17 +102,17 @@ void client_code(struct ib_inf *global_inf, struct ib_local_inf *local_inf,
     /* write your code here */
     GArray *rsec_malloc_array;
     rsec_malloc_array = g_array_new(FALSE, FALSE, sizeof(guint64));
-    char *temp = rsec_malloc(RSEC_MR_SIZE, rsec_malloc_array);
+    char *temp = rsec_malloc(RSEC_REAL_BLOCK_SIZE, rsec_malloc_array);
     char *memcached_string = malloc(RSEC_MEMCACHED_STRING_LENGTH);
     struct ibv_mr *temp_mr =
-        ibv_reg_mr(node_share_inf->pd, temp, RSEC_MR_SIZE,
+        ibv_reg_mr(node_share_inf->pd, temp, RSEC_REAL_BLOCK_SIZE,
                    IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_WRITE |
                        IBV_ACCESS_REMOTE_READ);
     int i;
     int running_times;
-    unsigned long *signal_output = malloc(sizeof(unsigned long));
-    unsigned long *signal_input;
+    unsigned long signal_input;
     int target;
+    struct rsec_sync_inf *sync;
 
     char access_set_name[RSEC_MAX_QP_NAME];
     int *access_set;
@@ -116,7 +122,10 @@ void client_code(struct ib_inf *global_inf, struct ib_local_inf *local_inf,
     int *key_array;
     struct timespec current, start;
 
-    struct ib_mr_attr *mr_list, **access_mr_list, *tmp_mr_list;
+    struct ib_mr_attr **access_mr_list;
+    struct rsec_mr_view mr_view;
+    struct ib_mr_attr base_mr;
+    struct rsec_arena *arena;
     if (RSEC_RELOAD_VPN_FILE) {
         key_array = malloc(sizeof(int) * RSEC_RELOAD_VPN_LENGTH);
         fp_key = fopen(RSEC_RELOAD_VPN_FILE, "r");
@@ -130,37 +139,41 @@ void client_code(struct ib_inf *global_inf, struct ib_local_inf *local_inf,
 
     srand(RSEC_CLIENT_RAND_KEY);
 
-    mr_list = malloc(sizeof(struct ib_mr_attr) * RSEC_MR_NUMBER);
     {
         char mem_mr_name[RSEC_MAX_QP_NAME];
         sprintf(mem_mr_name, "mr-key");
-        do {
-            ret_len =
-                memcached_get_published(mem_mr_name, (void **)&tmp_mr_list);
-        } while (ret_len <= 0);
+        ret_len = memcached_wait_published_into(
+            mem_mr_name, &base_mr, sizeof(struct ib_mr_attr),
+            RSEC_MEMCACHED_WAIT_FOREVER);
         // assert(ret_len == sizeof(struct ib_mr_attr) * RSEC_MR_NUMBER);
         assert(ret_len == sizeof(struct ib_mr_attr));
-        for (i = 0; i < RSEC_MR_NUMBER; i++) {
-            mr_list[i].addr = tmp_mr_list->addr +
-                              (unsigned long long)i * RSEC_REAL_BLOCK_SIZE;
-            mr_list[i].rkey = tmp_mr_list->rkey;
-        }
+        // every block shares the rkey, entries are computed on use
+        mr_view.base = base_mr.addr;
+        mr_view.stride = RSEC_REAL_BLOCK_SIZE;
+        mr_view.rkey = base_mr.rkey;
+        mr_view.count = RSEC_MR_NUMBER;
     }
     RSEC_PRINT("get all mr %lld\n", RSEC_MR_NUMBER);
 
     sprintf(access_set_name, RSEC_ACCESS_SET_STRING);
-    do {
-        ret_len =
-            memcached_get_published(access_set_name, (void **)&access_set);
-    } while (ret_len <= 0);
+    ret_len = memcached_wait_published(access_set_name, (void **)&access_set,
+                                      RSEC_MEMCACHED_WAIT_FOREVER);
     assert(ret_len == sizeof(int) * RSEC_ACCESS_MR_RANGE);
 
+    sync = rsec_sync_setup(node_share_inf, input_arg->machine_id,
+                           RSEC_ATTACKER_MACHINE_ID);
+    arena = rsec_arena_create(RSEC_ARENA_BLOCK_SIZE);
+
     // experiment start
     // stick_this_thread_to_core(2);
     clock_gettime(CLOCK_MONOTONIC, &start);
     for (running_times = 0; running_times < RSEC_ACCESS_TEST_RUNNING_TIMES;
          running_times++) {
         int access_target;
+        unsigned long calibrate;
+        // objects of the previous iteration are dropped at once
+        rsec_arena_reset(arena);
+        rsec_sweep_apply(running_times);
         access_target = get_access_target(running_times, key_array);
         if (running_times % 100 == 0) {
             clock_gettime(CLOCK_MONOTONIC, &current);
@@ -168,15 +181,22 @@ void client_code(struct ib_inf *global_inf, struct ib_local_inf *local_inf,
                        RSEC_ACCESS_TEST_RUNNING_TIMES,
                        current.tv_sec - start.tv_sec);
         }
-        access_mr_list = rsec_form_sub_mr(&mr_list[access_target],
-                                          RSEC_ACCESS_MR_RANGE, NULL);
+        access_mr_list = rsec_form_sub_mr(&mr_view, access_target,
+                                          RSEC_ACCESS_MR_RANGE, NULL, arena);
         // RSEC_PRINT("Experiment start-%d\n", running_times);
 
-        rsec_get_threshold(node_share_inf->conn_cq[RSEC_SERVER_QP_NUM],
-                           node_share_inf->conn_qp[RSEC_SERVER_QP_NUM], NULL,
-                           NULL, temp_mr,
-                           access_mr_list[RSEC_EXP_MODE_CACHE_TARGET], NULL, 0,
-                           NULL, NULL, 0, running_times);
+        // the attacker decides whether this iteration calibrates or is
+        // skipped by an early stop of the sweep [rsec_sweep.h]
+        calibrate =
+            rsec_sync_wait(sync, RSEC_SYNC_SLOT_CALIBRATE, running_times, 0);
+        if (calibrate == RSEC_SWEEP_SKIP) continue;
+        if (calibrate)
+            rsec_get_threshold(node_share_inf->conn_cq[RSEC_SERVER_QP_NUM],
+                               node_share_inf->conn_qp[RSEC_SERVER_QP_NUM],
+                               temp_mr,
+                               access_mr_list[RSEC_EXP_MODE_CACHE_TARGET],
+                               NULL, NULL, NULL, NULL, NULL, 0, running_times,
+                               sync);
         // RSEC_PRINT("finish threshold-%d\n", running_times);
         RSEC_PRINT(
             "%d-TARGET == rkey: %ld addr: %llx\n", running_times,
@@ -184,12 +204,11 @@ void client_code(struct ib_inf *global_inf, struct ib_local_inf *local_inf,
             (long long int)access_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->addr);
         for (i = 0; i < RSEC_ACCESS_TEST_TIME; i++) {
             // wait for access signal
-            memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
-            sprintf(memcached_string, RSEC_EVICT_STRING, running_times, i);
-            signal_input = memcached_get_published_size(memcached_string,
-                                                        RSEC_SIGNAL_SIZE);
-            if (*signal_input != i)
-                RSEC_PRINT("%d:%d\n", (int)*signal_input, i);
+            signal_input =
+                rsec_sync_wait(sync, RSEC_SYNC_SLOT_EVICT, running_times, i);
+            // the attacker has enough trials of this target
+            if (signal_input == RSEC_TRIAL_STOP) break;
+            if (signal_input != i) RSEC_PRINT("%d:%d\n", (int)signal_input, i);
             // access
 
             if (input_arg->interaction_mode) {
@@ -210,54 +229,50 @@ void client_code(struct ib_inf *global_inf, struct ib_local_inf *local_inf,
             }
 
             // submit access signal
-            memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
-            sprintf(memcached_string, RSEC_ACCESS_STRING, running_times, i);
-            *signal_output = target;
-            memcached_publish(memcached_string, signal_output,
-                              RSEC_SIGNAL_SIZE);
+            rsec_sync_signal(sync, RSEC_SYNC_SLOT_ACCESS, running_times, i,
+                             target);
         }
     }
+    rsec_arena_destroy(arena);
+    rsec_strategy_cleanup();
+    memcached_cleanup_published();
     memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
     sprintf(memcached_string, RSEC_TERMINATE_STRING, input_arg->machine_id);
-    memcached_publish(memcached_string, &input_arg->machine_id, sizeof(int));
+    memcached_publish_expire(memcached_string, &input_arg->machine_id,
+                             sizeof(int), RSEC_MEMCACHED_TRIAL_EXPIRATION);
     free(memcached_string);
 }
 
 char file_name[64];
-FILE *create_log(void);
+struct rsec_log_inf *create_log(void);
 /**
  * create_log - log creating function
  * 1. backup all configuration
- * 2. setup log
+ * 2. setup log [rsec_log.h]
  */
-FILE *create_log(void) {
-    char header_command[128], source_command[128], control_command[128];
+struct rsec_log_inf *create_log(void) {
+    static const char *const snapshot[] = {"rsec.h", "rsec.c", "client.c",
+                                           "rsec_control.c"};
+    char snapshot_name[128];
     long unsigned int current_time = (unsigned long)time(NULL);
-    sprintf(file_name, "microbenchmark-%lu.log", current_time);
-    sprintf(header_command, "cp rsec.h microbenchmark-%lu.rsec.h",
-            current_time);
-    sprintf(source_command,
-            "cp rsec.c microbenchmark-%lu.rsec.c;cp client.c "
-            "microbenchmark-%lu.client.c",
-            current_time, current_time);
-    sprintf(control_command,
-            "cp rsec_control.c microbenchmark-%lu.rsec_control.c",
-            current_time);
-    FILE *fp = fopen(file_name, "w");
-    system(header_command);
-    system(source_command);
-    system(control_command);
+    int i;
+    sprintf(file_name, RSEC_LOG_FILE_STRING, current_time);
+    for (i = 0; i < sizeof(snapshot) / sizeof(snapshot[0]); i++) {
+        sprintf(snapshot_name, "microbenchmark-%lu.%s", current_time,
+                snapshot[i]);
+        rsec_log_copy_file(snapshot[i], snapshot_name);
+    }
     RSEC_PRINT("running at %s\n", file_name);
-    return fp;
+    return rsec_log_setup(file_name);
 }
 
-void close_log(FILE *fp);
+void close_log(struct rsec_log_inf *log);
 /**
  * close_log - log function
- * close file
+ * flush and close the log
  */
-void close_log(FILE *fp) {
-    fclose(fp);
+void close_log(struct rsec_log_inf *log) {
+    rsec_log_close(log);
     RSEC_PRINT("running at %s\n", file_name);
     return;
 }
@@ -278,19 +293,26 @@ void attacker_code(struct ib_inf *global_inf, struct ib_local_inf *local_inf,
     /* write your code here */
     GArray *rsec_malloc_array;
     rsec_malloc_array = g_array_new(FALSE, FALSE, sizeof(guint64));
-    char *temp = rsec_malloc(RSEC_MR_SIZE, rsec_malloc_array);
+    char *temp = rsec_malloc(RSEC_REAL_BLOCK_SIZE, rsec_malloc_array);
     // char *temp = malloc(1024);
     char *memcached_string = malloc(RSEC_MEMCACHED_STRING_LENGTH);
     struct ibv_mr *temp_mr =
-        ibv_reg_mr(node_share_inf->pd, temp, RSEC_MR_SIZE,
+        ibv_reg_mr(node_share_inf->pd, temp, RSEC_REAL_BLOCK_SIZE,
                    IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_WRITE |
                        IBV_ACCESS_REMOTE_READ);
     int i;
     int running_times;
-    int answer, count = 0;
-    unsigned long *signal_output = malloc(sizeof(unsigned long));
-    unsigned long *signal_input;
-    struct ib_mr_attr *mr_list, *evict_mr_list, *probe_mr_list, *tmp_mr_list;
+    int answer, count = 0, num_trials;
+    unsigned long signal_input;
+    struct rsec_trial_inf trial;
+    struct rsec_hwts_inf *hwts;
+    struct rsec_sync_inf *sync;
+    struct rsec_calib_inf *calib;
+    struct rsec_evict_cache *evict_cache;
+    struct rsec_arena *arena;
+    struct ib_mr_attr *evict_mr_list;
+    struct rsec_mr_view mr_view, *probe_mr_view;
+    struct ib_mr_attr base_mr;
     struct ib_mr_attr **reload_mr_list, **sub_evict_mr_list;
     int *evict_mr_order = malloc(sizeof(int) * RSEC_EVICT_MR_NUMBER);
     int *reload_mr_order = malloc(sizeof(int) * RSEC_RELOAD_MR_NUMBER);
@@ -300,58 +322,53 @@ void attacker_code(struct ib_inf *global_inf, struct ib_local_inf *local_inf,
     int *access_set;
     int ret_len;
 
-    FILE *fp = create_log();
-    //FILE *fp_each_log = fopen("each_time.log", "w");
+    struct rsec_log_inf *log = create_log();
+    struct rsec_log_record record;
+    char line[RSEC_LOG_LINE_LENGTH];
+    struct rsec_sample_ring *samples = rsec_sample_thread_ring();
+    struct rsec_sample_stat *sample_stat = rsec_sample_stat_setup();
 
     FILE *fp_key;
     int *key_array;
 
-    mr_list = malloc(sizeof(struct ib_mr_attr) * RSEC_MR_NUMBER);
     {
         char mem_mr_name[RSEC_MAX_QP_NAME];
         sprintf(mem_mr_name, "mr-key");
-        do {
-            ret_len =
-                memcached_get_published(mem_mr_name, (void **)&tmp_mr_list);
-        } while (ret_len <= 0);
+        ret_len = memcached_wait_published_into(
+            mem_mr_name, &base_mr, sizeof(struct ib_mr_attr),
+            RSEC_MEMCACHED_WAIT_FOREVER);
         // assert(ret_len == sizeof(struct ib_mr_attr) * RSEC_MR_NUMBER);
         assert(ret_len == sizeof(struct ib_mr_attr));
-        for (i = 0; i < RSEC_MR_NUMBER; i++) {
-            mr_list[i].addr = tmp_mr_list->addr +
-                              (unsigned long long)i * RSEC_REAL_BLOCK_SIZE;
-            mr_list[i].rkey = tmp_mr_list->rkey;
-        }
+        // every block shares the rkey, entries are computed on use
+        mr_view.base = base_mr.addr;
+        mr_view.stride = RSEC_REAL_BLOCK_SIZE;
+        mr_view.rkey = base_mr.rkey;
+        mr_view.count = RSEC_MR_NUMBER;
     }
     RSEC_PRINT("get all mr %lld\n", RSEC_MR_NUMBER);
 
     {
         char mem_mr_name[RSEC_MAX_QP_NAME];
         sprintf(mem_mr_name, "evict-mr-key");
-        do {
-            ret_len =
-                memcached_get_published(mem_mr_name, (void **)&evict_mr_list);
-        } while (ret_len <= 0);
+        ret_len = memcached_wait_published(mem_mr_name, (void **)&evict_mr_list,
+                                          RSEC_MEMCACHED_WAIT_FOREVER);
         assert(ret_len == sizeof(struct ib_mr_attr) * RSEC_EVICT_MR_NUMBER);
     }
     RSEC_PRINT("get evict mr %d\n", RSEC_EVICT_MR_NUMBER);
-    probe_mr_list = mr_list;
+    probe_mr_view = &mr_view;
 
     {
         char mem_mr_name[RSEC_MAX_QP_NAME];
         sprintf(mem_mr_name, RSEC_EXTRA_MR_STRING);
-        do {
-            ret_len =
-                memcached_get_published(mem_mr_name, (void **)&extra_rkey);
-        } while (ret_len <= 0);
+        ret_len = memcached_wait_published(mem_mr_name, (void **)&extra_rkey,
+                                          RSEC_MEMCACHED_WAIT_FOREVER);
         assert(ret_len == sizeof(uint32_t) * RSEC_EXTRA_MR);
     }
     RSEC_PRINT("get extra rkey %d\n", RSEC_EXTRA_MR);
 
     sprintf(access_set_name, RSEC_ACCESS_SET_STRING);
-    do {
-        ret_len =
-            memcached_get_published(access_set_name, (void **)&access_set);
-    } while (ret_len <= 0);
+    ret_len = memcached_wait_published(access_set_name, (void **)&access_set,
+                                      RSEC_MEMCACHED_WAIT_FOREVER);
     assert(ret_len == sizeof(int) * RSEC_ACCESS_MR_RANGE);
 
     if (RSEC_RELOAD_VPN_FILE) {
@@ -365,6 +382,14 @@ void attacker_code(struct ib_inf *global_inf, struct ib_local_inf *local_inf,
     } else
         key_array = NULL;
 
+    sync = rsec_sync_setup(node_share_inf, input_arg->machine_id,
+                           RSEC_CLIENT_MACHINE_ID);
+    hwts = rsec_hwts_setup(node_share_inf, RSEC_SERVER_QP_NUM);
+    calib = rsec_calib_setup();
+    evict_cache = rsec_evict_cache_setup(RSEC_EVICT_ENGINE);
+    rsec_trial_setup(&trial);
+    arena = rsec_arena_create(RSEC_ARENA_BLOCK_SIZE);
+
     for (i = 0; i < RSEC_EVICT_MR_NUMBER; i++) evict_mr_order[i] = i;
     for (i = 0; i < RSEC_RELOAD_MR_NUMBER; i++) reload_mr_order[i] = i;
 
@@ -379,10 +404,17 @@ void attacker_code(struct ib_inf *global_inf, struct ib_local_inf *local_inf,
         int custom_evict_number = get_num_evict_target(running_times);
         uint32_t custom_rkey_choice = get_mr_target(running_times, extra_rkey);
         int custom_stride_strategy = get_stride_strategy(running_times);
-
-        struct ibv_sge input_sge;
-        // struct ibv_send_wr *wr;
-        struct ibv_send_wr **input_wr_list;
+        int custom_strategy =
+            rsec_sweep_value(running_times, RSEC_SWEEP_AXIS_STRATEGY, 0);
+
+        struct rsec_evict_inf *evict;
+        struct rsec_evict_key evict_key;
+        struct rsec_evict_cache_entry *evict_entry;
+        int num_evict_qps;
+        struct rsec_calib_key calib_key;
+        struct rsec_calib_entry *calib_entry;
+        int calibrate;
+        struct rsec_sweep_point *sweep_point;
 
         struct return_int log_index_set;
         log_index_set.index_distance = -1;
@@ -390,8 +422,18 @@ void attacker_code(struct ib_inf *global_inf, struct ib_local_inf *local_inf,
         log_index_set.first = -1;
         log_index_set.last = -1;
 
-        reload_mr_list = rsec_form_sub_mr(&mr_list[access_target],
-                                          RSEC_RELOAD_MR_NUMBER, access_set);
+        rsec_sweep_apply(running_times);
+        if (rsec_sweep_skip(running_times)) {
+            // the point stopped early, the victim skips it as well
+            rsec_sync_signal(sync, RSEC_SYNC_SLOT_CALIBRATE, running_times, 0,
+                             RSEC_SWEEP_SKIP);
+            continue;
+        }
+        // objects of the previous iteration are dropped at once
+        rsec_arena_reset(arena);
+        reload_mr_list = rsec_form_sub_mr(&mr_view, access_target,
+                                          RSEC_RELOAD_MR_NUMBER, access_set,
+                                          arena);
         RSEC_PRINT(
             "%d-TARGET == rkey: %ld addr: %llx\n", running_times,
             (long int)reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->rkey,
@@ -401,50 +443,104 @@ void attacker_code(struct ib_inf *global_inf, struct ib_local_inf *local_inf,
 
         double evict_lat;
         double total_evict_lat = 0;
-        struct timespec start, end;
-        int real_process_mr_number, total_wr_length;
+        int real_process_mr_number;
         double lat_evict, lat_hit, lat_average, lat_reload;
         double thr_evict, thr_hit, sum_evict = 0, sum_hit = 0;
         int thr_flag;
-        int per_wr;
         // int current_record = 0;
         // test_mode = PROBE_TEST_ARRAY[running_times];
         test_mode = get_evict_mode(running_times);
         real_process_mr_number = custom_evict_number;
-        switch (test_mode) {
-            case RSEC_PROBE_COLLISION_CHECK_MODE_MR:
-                sub_evict_mr_list = rsec_form_attack_sub_mr(
-                    reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->rkey,
-                    evict_mr_list, custom_evict_number, &real_process_mr_number,
-                    RSEC_EVICT_MR_NUMBER, custom_stride_distance);
-                break;
-            case RSEC_PROBE_COLLISION_CHECK_MODE_PROBE:
-            case RSEC_PROBE_COLLISION_CHECK_MODE_ALWAYS:
-            case RSEC_PROBE_COLLISION_CHECK_MODE_UNIFORM:
-            case RSEC_PROBE_COLLISION_CHECK_MODE_STRIDE:
-                sub_evict_mr_list = rsec_form_attack_sub_mr_new(
-                    probe_mr_list, custom_evict_number, RSEC_MR_NUMBER,
-                    test_mode, &real_process_mr_number, shift, access_target,
-                    &log_index_set, custom_stride_distance, custom_rkey_choice,
-                    custom_stride_strategy);
-                break;
-            default:
-                RSEC_ERROR("mode %d error\n", RSEC_PROBE_COLLISION_CHECK_MODE);
-                assert(0);
+        if (RSEC_EVICT_ENGINE == RSEC_EVICT_ENGINE_SINGLE_QP)
+            num_evict_qps = 1;
+        else
+            num_evict_qps = get_num_evict_qps(running_times);
+        // the MR-based eviction set depends on the rkeys, it is not cached
+        evict_entry = NULL;
+        if (test_mode != RSEC_PROBE_COLLISION_CHECK_MODE_MR) {
+            rsec_attack_sub_mr_key(&evict_key, custom_evict_number,
+                                   RSEC_MR_NUMBER, shift, access_target,
+                                   custom_stride_distance, custom_rkey_choice,
+                                   custom_stride_strategy);
+            evict_key.test_mode = test_mode;
+            evict_key.num_lanes = num_evict_qps;
+            evict_key.opcode = RSEC_EVICT_MODE;
+            evict_entry = rsec_evict_cache_lookup(evict_cache, &evict_key);
         }
+        if (evict_entry) {
+            evict = evict_entry->evict;
+            sub_evict_mr_list = evict_entry->mr_list;
+            real_process_mr_number = evict_entry->num_mr;
+            memcpy(&log_index_set, &evict_entry->index_set,
+                   sizeof(struct return_int));
+        } else {
+            switch (test_mode) {
+                case RSEC_PROBE_COLLISION_CHECK_MODE_MR:
+                    sub_evict_mr_list = rsec_form_attack_sub_mr(
+                        reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->rkey,
+                        evict_mr_list, custom_evict_number,
+                        &real_process_mr_number, RSEC_EVICT_MR_NUMBER,
+                        custom_stride_distance, arena);
+                    break;
+                case RSEC_PROBE_COLLISION_CHECK_MODE_PROBE:
+                case RSEC_PROBE_COLLISION_CHECK_MODE_ALWAYS:
+                case RSEC_PROBE_COLLISION_CHECK_MODE_UNIFORM:
+                case RSEC_PROBE_COLLISION_CHECK_MODE_STRIDE:
+                    sub_evict_mr_list = rsec_form_attack_sub_mr_new(
+                        probe_mr_view, custom_evict_number, RSEC_MR_NUMBER,
+                        test_mode, &real_process_mr_number, shift,
+                        access_target, &log_index_set, custom_stride_distance,
+                        custom_rkey_choice, custom_stride_strategy, arena);
+                    break;
+                default:
+                    RSEC_ERROR("mode %d error\n",
+                               RSEC_PROBE_COLLISION_CHECK_MODE);
+                    assert(0);
+            }
 
-        total_wr_length = RSEC_ROUND_UP(real_process_mr_number, RSEC_CQ_DEPTH) /
-                          RSEC_CQ_DEPTH;
-        input_wr_list =
-            rsec_form_wr_list(temp_mr, sub_evict_mr_list, &input_sge,
-                              real_process_mr_number, 0, 0);
-        thr_flag = rsec_get_threshold(
-            node_share_inf->conn_cq[RSEC_SERVER_QP_NUM],
-            node_share_inf->conn_qp[RSEC_SERVER_QP_NUM],
-            node_share_inf->conn_cq[RSEC_HELPER_QP_NUM],
-            node_share_inf->conn_qp[RSEC_HELPER_QP_NUM], temp_mr,
-            reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET], input_wr_list,
-            total_wr_length, &lat_evict, &lat_hit, 1, running_times);
+            if (RSEC_EVICT_ENGINE == RSEC_EVICT_ENGINE_SINGLE_QP) {
+                evict = rsec_evict_setup(
+                    RSEC_EVICT_ENGINE,
+                    &node_share_inf->conn_qp[RSEC_HELPER_QP_NUM],
+                    &node_share_inf->conn_cq[RSEC_HELPER_QP_NUM], 1, temp_mr,
+                    sub_evict_mr_list, real_process_mr_number, 0, 0);
+            } else {
+                assert(num_evict_qps <= node_share_inf->num_attack_rcqps);
+                evict = rsec_evict_setup(
+                    RSEC_EVICT_ENGINE, node_share_inf->attack_qp,
+                    node_share_inf->attack_cq, num_evict_qps, temp_mr,
+                    sub_evict_mr_list, real_process_mr_number, 0, 0);
+            }
+            if (test_mode != RSEC_PROBE_COLLISION_CHECK_MODE_MR)
+                evict_entry = rsec_evict_cache_insert(
+                    evict_cache, &evict_key, evict, sub_evict_mr_list,
+                    real_process_mr_number, &log_index_set);
+        }
+        memset(&calib_key, 0, sizeof(struct rsec_calib_key));
+        calib_key.evict_size = real_process_mr_number;
+        calib_key.reload_size = RSEC_RELOAD_MR_SIZE;
+        calib_key.test_mode = test_mode;
+        calib_key.stride_strategy = custom_stride_strategy;
+        calib_key.strategy = custom_strategy;
+        calib_entry =
+            rsec_calib_lookup(calib, &calib_key,
+                              reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->addr);
+        calibrate = rsec_calib_need(calib, calib_entry);
+        rsec_sync_signal(sync, RSEC_SYNC_SLOT_CALIBRATE, running_times, 0,
+                         calibrate);
+        if (calibrate) {
+            thr_flag = rsec_get_threshold(
+                node_share_inf->conn_cq[RSEC_SERVER_QP_NUM],
+                node_share_inf->conn_qp[RSEC_SERVER_QP_NUM], temp_mr,
+                reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET], hwts, evict,
+                calib_entry->cls, &lat_evict, &lat_hit, 1, running_times,
+                sync);
+            if (!thr_flag) rsec_calib_set(calib_entry, lat_evict, lat_hit);
+        } else {
+            thr_flag = 0;
+            lat_evict = calib_entry->lat_evict;
+            lat_hit = calib_entry->lat_hit;
+        }
         thr_evict = lat_evict;
         thr_hit = lat_hit;
         if (thr_flag == 1) {
@@ -454,210 +550,122 @@ void attacker_code(struct ib_inf *global_inf, struct ib_local_inf *local_inf,
         lat_average = (lat_evict + lat_hit) / 2;
         count = 0;
         answer = 0;
+        num_trials = RSEC_ACCESS_TEST_TIME;
+        rsec_trial_reset(&trial);
         for (i = 0; i < RSEC_ACCESS_TEST_TIME; i++) {
             // evict
-            clock_gettime(CLOCK_MONOTONIC, &start);
-            {
-                for (per_wr = 0; per_wr < total_wr_length; per_wr++) {
-                    userspace_one_preset(
-                        node_share_inf->conn_qp[RSEC_HELPER_QP_NUM],
-                        input_wr_list[per_wr]);
-                    userspace_one_poll(
-                        node_share_inf->conn_cq[RSEC_HELPER_QP_NUM], 1);
-                }
-            }
-            clock_gettime(CLOCK_MONOTONIC, &end);
-            evict_lat = diff_ns(&start, &end);
+            evict_lat = rsec_evict_run(evict);
             total_evict_lat += evict_lat;
             // signal evict
-            memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
-            sprintf(memcached_string, RSEC_EVICT_STRING, running_times, i);
-            *signal_output = i;
-            memcached_publish(memcached_string, signal_output,
-                              RSEC_SIGNAL_SIZE);
+            rsec_sync_signal(sync, RSEC_SYNC_SLOT_EVICT, running_times, i, i);
             // wait for access signal
-            memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
-            sprintf(memcached_string, RSEC_ACCESS_STRING, running_times, i);
-            signal_input = memcached_get_published_size(memcached_string,
-                                                        RSEC_SIGNAL_SIZE);
+            signal_input =
+                rsec_sync_wait(sync, RSEC_SYNC_SLOT_ACCESS, running_times, i);
             // array_randomize(reload_mr_order, RSEC_RELOAD_MR_NUMBER);
             switch (RSEC_EXP_MODE) {
                 case RSEC_EXP_MODE_CACHE:
-                    clock_gettime(CLOCK_MONOTONIC, &start);
-                    userspace_one_read(
-                        node_share_inf->conn_qp[RSEC_SERVER_QP_NUM], temp_mr,
+                    lat_reload = rsec_hwts_read(
+                        hwts, node_share_inf->conn_qp[RSEC_SERVER_QP_NUM],
+                        node_share_inf->conn_cq[RSEC_SERVER_QP_NUM], temp_mr,
                         RSEC_RELOAD_MR_SIZE,
                         reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET],
                         RSEC_RELOAD_MR_OFFSET);
-                    userspace_one_poll(
-                        node_share_inf->conn_cq[RSEC_SERVER_QP_NUM], 1);
-                    clock_gettime(CLOCK_MONOTONIC, &end);
-                    lat_reload = diff_ns(&start, &end);
                     // RSEC_PRINT("%d evict: %f - average %f\n", i, lat_reload,
                     // lat_average);
                     int my_answer = 0;
                     answer = 0;
-                    if (lat_reload < lat_average)
-                        my_answer = 0;
+                    if (thr_flag)
+                        my_answer = lat_reload < lat_average
+                                        ? RSEC_CLASSIFY_HIT
+                                        : RSEC_CLASSIFY_MISS;
                     else
-                        my_answer = 1;
-                    if ((int)*signal_input == my_answer) answer = 1;
-                    if ((int)*signal_input == 0)
+                        my_answer = rsec_classify_predict(calib_entry->cls,
+                                                          lat_reload, NULL);
+                    if ((int)signal_input == my_answer) answer = 1;
+                    rsec_calib_update(calib_entry, (int)signal_input,
+                                      lat_reload, answer);
+                    if ((int)signal_input == 0)
                         sum_hit += lat_reload;
                     else
                         sum_evict += lat_evict;
-                    //if (answer == 1)
-                    //    RSEC_FPRINT(fp_each_log, "correct\t%d\t%f\n",
-                    //                (int)*signal_input, lat_reload);
-                    //else
-                    //    RSEC_FPRINT(fp_each_log, "fail\t%d\t%f\n",
-                    //                (int)*signal_input, lat_reload);
+                    rsec_sample_record(samples, i, (int)signal_input,
+                                       my_answer, evict_lat, lat_reload);
                     break;
             }
             if (answer) count++;
-        }
-        if (custom_evict_number == real_process_mr_number) {
-            if (!thr_flag) {
-                RSEC_PRINT(
-                    "%d\t%d\tsuccess\t%s \t %0.2f\t%d/%d\tevict lat:\t%0.2f\t "
-                    "%llx\t%lx\t%lx\t%0.2f(%0.2f-%0.2f)\t%0.2f(%0.2f-%0.2f)"
-                    "\tindex:\t%ld\t%ld\t%ld\t%ld\t%d\n",
-                    running_times, access_target,
-                    rsec_experiment_evict_mode[test_mode],
-                    ((float)count) / RSEC_ACCESS_TEST_TIME, count,
-                    RSEC_ACCESS_TEST_TIME,
-                    RSEC_NS_TO_US(total_evict_lat / RSEC_ACCESS_TEST_TIME),
-                    (long long unsigned int)
-                    reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->addr,
-                    (long unsigned int)
-                    reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->rkey,
-                    (unsigned long)sub_evict_mr_list[0]->rkey, lat_evict,
-                    thr_evict, sum_evict / RSEC_ACCESS_TEST_TIME, lat_hit,
-                    thr_hit, sum_hit / RSEC_ACCESS_TEST_TIME,
-                    log_index_set.first, log_index_set.last,
-                    log_index_set.index_distance, log_index_set.real_distance,
-                    real_process_mr_number);
-                if (fp)
-                    RSEC_FPRINT(
-                        fp,
-                        "%d\t%d\tsuccess\t%s \t %0.2f\t%d/%d\tevict "
-                        "lat:\t%0.2f\t "
-                        "%llx\t%lx\t%lx\t%0.2f(%0.2f-%0.2f)\t%0.2f(%0.2f-%0.2f)"
-                        "\tindex:\t%ld\t%ld\t%ld\t%ld\t%d\n",
-                        running_times, access_target,
-                        rsec_experiment_evict_mode[test_mode],
-                        ((float)count) / RSEC_ACCESS_TEST_TIME, count,
-                        RSEC_ACCESS_TEST_TIME,
-                        RSEC_NS_TO_US(total_evict_lat / RSEC_ACCESS_TEST_TIME),
-                        (long long unsigned int)
-                        reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->addr,
-                        (long unsigned int)
-                        reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->rkey,
-                        (unsigned long)sub_evict_mr_list[0]->rkey, lat_evict,
-                        thr_evict, sum_evict / RSEC_ACCESS_TEST_TIME, lat_hit,
-                        thr_hit, sum_hit / RSEC_ACCESS_TEST_TIME,
-                        log_index_set.first, log_index_set.last,
-                        log_index_set.index_distance,
-                        log_index_set.real_distance, real_process_mr_number);
-            } else {
-                RSEC_PRINT(
-                    "%d\t%d\tfail\t%s \t %0.2f\t%d/%d\tevict lat:\t%0.2f\t "
-                    "%llx\t%lx\t%lx\t%0.2f(%0.2f-%0.2f)\t%0.2f(%0.2f-%0.2f)"
-                    "\tindex:\t%ld\t%ld\t%ld\t%ld\t%d\n",
-                    running_times, access_target,
-                    rsec_experiment_evict_mode[test_mode],
-                    ((float)count) / RSEC_ACCESS_TEST_TIME, count,
-                    RSEC_ACCESS_TEST_TIME,
-                    RSEC_NS_TO_US(total_evict_lat / RSEC_ACCESS_TEST_TIME),
-                    (long long unsigned int)(reload_mr_list
-                                                 [RSEC_EXP_MODE_CACHE_TARGET]
-                                                     ->addr),
-                    (long unsigned int)
-                    reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->rkey,
-                    (unsigned long)sub_evict_mr_list[0]->rkey, lat_evict,
-                    thr_evict, sum_evict / RSEC_ACCESS_TEST_TIME, lat_hit,
-                    thr_hit, sum_hit / RSEC_ACCESS_TEST_TIME,
-                    log_index_set.first, log_index_set.last,
-                    log_index_set.index_distance, log_index_set.real_distance,
-                    real_process_mr_number);
-                if (fp)
-                    RSEC_FPRINT(
-                        fp,
-                        "%d\t%d\tfail\t%s \t %0.2f\t%d/%d\tevict lat:\t%0.2f\t "
-                        "%llx\t%lx\t%lx\t%0.2f(%0.2f-%0.2f)\t%0.2f(%0.2f-%0.2f)"
-                        "\tindex:\t%ld\t%ld\t%ld\t%ld\t%d\n",
-                        running_times, access_target,
-                        rsec_experiment_evict_mode[test_mode],
-                        ((float)count) / RSEC_ACCESS_TEST_TIME, count,
-                        RSEC_ACCESS_TEST_TIME,
-                        RSEC_NS_TO_US(total_evict_lat / RSEC_ACCESS_TEST_TIME),
-                        (long long unsigned int)
-                        reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->addr,
-                        (long unsigned int)
-                        reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->rkey,
-                        (unsigned long)sub_evict_mr_list[0]->rkey, lat_evict,
-                        thr_evict, sum_evict / RSEC_ACCESS_TEST_TIME, lat_hit,
-                        thr_hit, sum_hit / RSEC_ACCESS_TEST_TIME,
-                        log_index_set.first, log_index_set.last,
-                        log_index_set.index_distance,
-                        log_index_set.real_distance, real_process_mr_number);
+            if (rsec_trial_add(&trial, answer) &&
+                i + 1 < RSEC_ACCESS_TEST_TIME) {
+                // replaces the next evict signal of the client
+                rsec_sync_signal(sync, RSEC_SYNC_SLOT_EVICT, running_times,
+                                 i + 1, RSEC_TRIAL_STOP);
+                num_trials = i + 1;
+                break;
             }
-        } else {
-            RSEC_PRINT(
-                "%d\t%d\tnotenough\t%s \t %0.2f\t%d/%d\tevict lat:\t%0.2f\t "
-                "%llx\t%lx\t%lx\t%0.2f(%0.2f-%0.2f)\t%0.2f(%0.2f-%0.2f)\tindex:"
-                "\t%ld\t%ld\t%ld\t%ld\t%d\n",
-                running_times, access_target,
-                rsec_experiment_evict_mode[test_mode],
-                ((float)count) / RSEC_ACCESS_TEST_TIME, count,
-                RSEC_ACCESS_TEST_TIME,
-                RSEC_NS_TO_US(total_evict_lat / RSEC_ACCESS_TEST_TIME),
-                (long long unsigned int)
-                reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->addr,
-                (long unsigned int)reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]
-                    ->rkey,
-                (unsigned long)sub_evict_mr_list[0]->rkey, lat_evict, thr_evict,
-                sum_evict / RSEC_ACCESS_TEST_TIME, lat_hit, thr_hit,
-                sum_hit / RSEC_ACCESS_TEST_TIME, log_index_set.first,
-                log_index_set.last, log_index_set.index_distance,
-                log_index_set.real_distance, real_process_mr_number);
-            if (fp)
-                RSEC_FPRINT(
-                    fp,
-                    "%d\t%d\tnotenough\t%s \t %0.2f\t%d/%d\tevict "
-                    "lat:\t%0.2f\t "
-                    "%llx\t%lx\t%lx\t%0.2f(%0.2f-%0.2f)\t%0.2f(%0.2f-%0.2f)"
-                    "\tindex:\t%ld\t%ld\t%ld\t%ld\t%d\n",
-                    running_times, access_target,
-                    rsec_experiment_evict_mode[test_mode],
-                    ((float)count) / RSEC_ACCESS_TEST_TIME, count,
-                    RSEC_ACCESS_TEST_TIME,
-                    RSEC_NS_TO_US(total_evict_lat / RSEC_ACCESS_TEST_TIME),
-                    (long long unsigned int)
-                    reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->addr,
-                    (long unsigned int)
-                    reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->rkey,
-                    (unsigned long)sub_evict_mr_list[0]->rkey, lat_evict,
-                    thr_evict, sum_evict / RSEC_ACCESS_TEST_TIME, lat_hit,
-                    thr_hit, sum_hit / RSEC_ACCESS_TEST_TIME,
-                    log_index_set.first, log_index_set.last,
-                    log_index_set.index_distance, log_index_set.real_distance,
-                    real_process_mr_number);
-        }
-
-        if (sub_evict_mr_list) {
-            free(sub_evict_mr_list[0]);
-            free(sub_evict_mr_list);
-        }
-        if (input_wr_list) {
-            for (i = 0; i < total_wr_length; i++) free(input_wr_list[i]);
-            free(input_wr_list);
         }
+        rsec_sweep_update(running_times, count, num_trials);
+        rsec_sample_drain(samples, sample_stat);
+        rsec_sample_print(sample_stat, running_times);
+        rsec_classify_print(calib_entry->cls, running_times);
+        if (rsec_calib_end_iteration(calib_entry))
+            RSEC_PRINT("%d\tthreshold drift: evict %0.2f hit %0.2f\n",
+                       running_times, calib_entry->lat_evict,
+                       calib_entry->lat_hit);
+        memset(&record, 0, sizeof(struct rsec_log_record));
+        record.running_time = running_times;
+        record.access_target = access_target;
+        if (custom_evict_number != real_process_mr_number)
+            record.status = RSEC_LOG_STATUS_NOTENOUGH;
+        else if (thr_flag)
+            record.status = RSEC_LOG_STATUS_FAIL;
+        else
+            record.status = RSEC_LOG_STATUS_SUCCESS;
+        record.test_mode = test_mode;
+        record.count = count;
+        record.num_trials = num_trials;
+        record.evict_lat_us = RSEC_NS_TO_US(total_evict_lat / num_trials);
+        record.addr = reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->addr;
+        record.rkey = reload_mr_list[RSEC_EXP_MODE_CACHE_TARGET]->rkey;
+        record.evict_rkey = sub_evict_mr_list[0]->rkey;
+        record.lat_evict = lat_evict;
+        record.thr_evict = thr_evict;
+        record.avg_evict = sum_evict / num_trials;
+        record.lat_hit = lat_hit;
+        record.thr_hit = thr_hit;
+        record.avg_hit = sum_hit / num_trials;
+        record.index_first = log_index_set.first;
+        record.index_last = log_index_set.last;
+        record.index_distance = log_index_set.index_distance;
+        record.real_distance = log_index_set.real_distance;
+        record.num_evict_mr = real_process_mr_number;
+        sweep_point = rsec_sweep_point(running_times);
+        record.point = sweep_point ? sweep_point->id : -1;
+        record.value_size = RSEC_VALUE_SIZE;
+        record.evict_target = custom_evict_number;
+        record.stride_strategy = custom_stride_strategy;
+        record.stride_distance = custom_stride_distance;
+        record.strategy = custom_strategy;
+        rsec_log_format(line, RSEC_LOG_LINE_LENGTH, &record);
+        RSEC_PRINT("%s", line);
+        if (log) rsec_log_push(log, &record);
+
+        rsec_evict_print_chunks(evict, running_times);
+        // cached engines are released by the cache
+        if (evict_entry == NULL) rsec_evict_free(evict);
     }
+    rsec_evict_cache_free(evict_cache);
+    rsec_arena_destroy(arena);
+    rsec_calib_free(calib);
+    rsec_strategy_cleanup();
+    rsec_sweep_print();
+    rsec_time_report();
+    snprintf(line, RSEC_LOG_LINE_LENGTH, RSEC_SAMPLE_FILE_STRING, file_name);
+    rsec_sample_export(sample_stat, line);
+    rsec_sample_stat_free(sample_stat);
+    memcached_cleanup_published();
     memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
     sprintf(memcached_string, RSEC_TERMINATE_STRING, input_arg->machine_id);
-    memcached_publish(memcached_string, &input_arg->machine_id, sizeof(int));
-    if (fp) close_log(fp);
-    //if (fp_each_log) fclose(fp_each_log);
+    memcached_publish_expire(memcached_string, &input_arg->machine_id,
+                             sizeof(int), RSEC_MEMCACHED_TRIAL_EXPIRATION);
+    if (log) close_log(log);
     free(memcached_string);
 }
@@ -86,6 +86,14 @@ struct ibv_device *ib_get_device(struct ib_inf *inf, int port) {
                        device_attr.phys_port_cnt);
         if (ibv_query_port(ctx, port, &port_attr))
             die_printf("%s: can't query port %d\n", __func__, port);
+        if (port_attr.link_layer == IBV_LINK_LAYER_ETHERNET)
+            inf->network_mode = RSEC_NETWORK_ROCE;
+        else
+            inf->network_mode = RSEC_NETWORK_IB;
+        inf->active_mtu = port_attr.active_mtu;
+        RSEC_PRINT("NETWORK_MODE: %s\tactive MTU: %d\n",
+                   rsec_network_mode_text[inf->network_mode],
+                   128 << inf->active_mtu);
         inf->device_id = i;
         inf->dev_port_id = port;
         return dev_list[i];
@@ -96,19 +104,74 @@ struct ibv_device *ib_get_device(struct ib_inf *inf, int port) {
 /**
  * ib_get_gid - setup RDMA gid
  */
-union ibv_gid ib_get_gid(struct ibv_context *context, int port_index) {
+union ibv_gid ib_get_gid(struct ibv_context *context, int port_index,
+                         int sgid_index) {
     union ibv_gid ret_gid;
     int ret;
-    ret = ibv_query_gid(context, port_index, RSEC_SGID_INDEX, &ret_gid);
+    ret = ibv_query_gid(context, port_index, sgid_index, &ret_gid);
     if (ret) fprintf(stderr, "get GID fail\n");
 
-    fprintf(stderr, "GID: Interface id = %lld subnet prefix = %lld\n",
-            (long long)ret_gid.global.interface_id,
+    fprintf(stderr, "GID[%d]: Interface id = %lld subnet prefix = %lld\n",
+            sgid_index, (long long)ret_gid.global.interface_id,
             (long long)ret_gid.global.subnet_prefix);
 
     return ret_gid;
 }
 
+/**
+ * ib_find_sgid_index - pick the GID used by RoCE
+ * Walks the GID table of the port and returns the first RoCE v2 entry with an
+ * IPv4-mapped address (::ffff:a.b.c.d), or the first RoCE v2 entry if there
+ * is none. The GID type is only exported through sysfs by older rdma-core.
+ * @context: device context
+ * @port_index: port
+ */
+int ib_find_sgid_index(struct ibv_context *context, int port_index) {
+    static const uint8_t ipv4_prefix[12] = {0, 0, 0, 0, 0,    0,
+                                            0, 0, 0, 0, 0xff, 0xff};
+    struct ibv_port_attr port_attr;
+    union ibv_gid gid;
+    char path[PATH_MAX], type[32];
+    int i, sgid_index = -1;
+    FILE *fp;
+    if (RSEC_SGID_INDEX != RSEC_SGID_INDEX_AUTO) return RSEC_SGID_INDEX;
+    if (ibv_query_port(context, port_index, &port_attr))
+        die_printf("%s: can't query port %d\n", __func__, port_index);
+
+    for (i = 0; i < port_attr.gid_tbl_len; i++) {
+        if (ibv_query_gid(context, port_index, i, &gid)) continue;
+        if (!gid.global.subnet_prefix && !gid.global.interface_id) continue;
+        snprintf(path, PATH_MAX, RSEC_GID_TYPE_STRING,
+                 ibv_get_device_name(context->device), port_index, i);
+        fp = fopen(path, "r");
+        if (fp == NULL) continue;
+        if (fgets(type, sizeof(type), fp) == NULL) type[0] = 0;
+        fclose(fp);
+        if (strncmp(type, "RoCE v2", strlen("RoCE v2"))) continue;
+        if (!memcmp(gid.raw, ipv4_prefix, sizeof(ipv4_prefix))) {
+            sgid_index = i;
+            break;
+        }
+        if (sgid_index < 0) sgid_index = i;
+    }
+    if (sgid_index < 0)
+        die_printf("%s: no RoCE v2 GID on port %d, set RSEC_SGID_INDEX\n",
+                   __func__, port_index);
+    RSEC_PRINT("SGID_INDEX: %d\n", sgid_index);
+    return sgid_index;
+}
+
+/**
+ * ib_get_path_mtu - path MTU of a connection: the smaller active MTU of the
+ * two ports
+ * @inf: RDMA context
+ * @dest: remote QP information
+ */
+static enum ibv_mtu ib_get_path_mtu(struct ib_inf *inf,
+                                    struct ib_qp_attr *dest) {
+    return RSEC_MIN(inf->active_mtu, (enum ibv_mtu)dest->mtu);
+}
+
 /**
  * ib_get_local_lid - get RDMA lid
  */
@@ -138,7 +201,8 @@ void ib_create_rcqps(struct ib_inf *inf, int role_int) {
             inf->ctx, RSEC_CQ_DEPTH * inf->num_local_rcqps, NULL, NULL, 0);
 
     for (i = 0; i < inf->num_local_rcqps; i++) {
-        inf->conn_cq[i] = ibv_create_cq(inf->ctx, RSEC_CQ_DEPTH, NULL, NULL, 0);
+        // reload latency is taken from completion timestamps [rsec_hwts.h]
+        inf->conn_cq[i] = ib_create_ts_cq(inf, i);
         assert(inf->conn_cq[i] != NULL);
         struct ibv_qp_init_attr create_attr;
         memset(&create_attr, 0, sizeof(struct ibv_qp_init_attr));
@@ -272,8 +336,8 @@ void ib_create_udqps(struct ib_inf *inf)
 }
 
 /**
- * ib_create_attackqps - setup different QP if users want to attack QP
- * [deprecated]
+ * ib_create_attackqps - setup the attack QPs, each with its own CQ; the
+ * multi-QP eviction engines (rsec_evict.c) stripe eviction sets over them
  */
 void ib_create_attackqps(struct ib_inf *inf) {
     int i;
@@ -420,7 +484,10 @@ struct ib_inf *ib_setup(int id, int port, int num_rcqp_to_server,
                                                 sizeof(struct ibv_qp *));
         inf->conn_cq = (struct ibv_cq **)malloc(inf->num_local_rcqps *
                                                 sizeof(struct ibv_cq *));
-        assert(inf->conn_qp != NULL && inf->conn_cq != NULL);
+        inf->conn_cq_ex = (struct ibv_cq_ex **)malloc(
+            inf->num_local_rcqps * sizeof(struct ibv_cq_ex *));
+        assert(inf->conn_qp != NULL && inf->conn_cq != NULL &&
+               inf->conn_cq_ex != NULL);
         ib_create_rcqps(inf, role_int);
     }
     // Create counter
@@ -438,8 +505,10 @@ struct ib_inf *ib_setup(int id, int port, int num_rcqp_to_server,
     inf->num_loopback = num_loopback;
 
     // setup gid which would be used by RoCE
-    if (RSEC_NETWORK_MODE == RSEC_NETWORK_ROCE) {
-        inf->local_gid = ib_get_gid(inf->ctx, inf->port_index);
+    if (inf->network_mode == RSEC_NETWORK_ROCE) {
+        inf->sgid_index = ib_find_sgid_index(inf->ctx, inf->port_index);
+        inf->local_gid =
+            ib_get_gid(inf->ctx, inf->port_index, inf->sgid_index);
     }
 
     return inf;
@@ -530,8 +599,35 @@ int ib_post_recv_connect_qp(struct ib_inf *context,
     return i;
 }
 
+/**
+ * ib_get_published_qp_batch - fetch packed qp records of several machines
+ * All records are fetched with one multi-get per registry poll.
+ * @batch_names: keys of the packed records
+ * @num_batches: number of records
+ * @num_qps: number of qps in each record
+ * @qp_attr_list: return num_batches * num_qps qp information
+ */
+static void ib_get_published_qp_batch(const char *const *batch_names,
+                                      int num_batches, int num_qps,
+                                      struct ib_qp_attr **qp_attr_list) {
+    void **values = malloc(sizeof(void *) * num_batches);
+    int *lengths = malloc(sizeof(int) * num_batches);
+    int i, j;
+    memcached_wait_published_multi(batch_names, num_batches, values, lengths,
+                                   RSEC_MEMCACHED_WAIT_FOREVER);
+    for (i = 0; i < num_batches; i++) {
+        struct ib_qp_attr *batch = values[i];
+        assert(lengths[i] == sizeof(struct ib_qp_attr) * num_qps);
+        for (j = 0; j < num_qps; j++) qp_attr_list[i * num_qps + j] = &batch[j];
+    }
+    free(values);
+    free(lengths);
+}
+
 /**
  * ib_complete_setup - finalize all RDMA configurations
+ * Every machine publishes its RC/UD (and attack) qps as one packed record,
+ * then fetches the records of all machines in one round trip.
  */
 struct ib_inf *ib_complete_setup(struct configuration_params *input_arg,
                                  int role_int, char *role_str) {
@@ -539,6 +635,8 @@ struct ib_inf *ib_complete_setup(struct configuration_params *input_arg,
     struct ib_inf *node_share_inf;
     int i, j;
     int cumulative_id = 0, total_machines, total_qp_count = 0;
+    char srv_name[RSEC_MAX_QP_NAME];
+    char **batch_names;
 
     total_machines = input_arg->num_servers + input_arg->num_clients;
     machine_id = input_arg->machine_id;
@@ -553,24 +651,23 @@ struct ib_inf *ib_complete_setup(struct configuration_params *input_arg,
     node_share_inf->device_id = input_arg->device_id;
     node_share_inf->role = role_int;
 
+    batch_names = malloc(sizeof(char *) * total_machines);
+    for (cumulative_id = 0; cumulative_id < total_machines; cumulative_id++)
+        batch_names[cumulative_id] = malloc(RSEC_MAX_QP_NAME);
+
     // post all rc qps
-    for (i = 0; i < node_share_inf->num_local_rcqps; i++) {
-        char srv_name[RSEC_MAX_QP_NAME];
-        sprintf(srv_name, "machine-rc-%d-%d", machine_id, i);
-        memcached_publish_rcqp(node_share_inf, i, srv_name);
-        // RSEC_PRINT("publish %s\n", srv_name);
-    }
+    sprintf(srv_name, RSEC_RC_QP_BATCH_STRING, machine_id);
+    memcached_publish_qp_batch(node_share_inf, node_share_inf->conn_qp,
+                               node_share_inf->num_local_rcqps, RSEC_RC_SL,
+                               srv_name);
     // get all published rc qps
-    for (cumulative_id = 0; cumulative_id < total_machines; cumulative_id++) {
-        for (i = 0; i < node_share_inf->num_local_rcqps; i++) {
-            char srv_name[RSEC_MAX_QP_NAME];
-            sprintf(srv_name, "machine-rc-%d-%d", cumulative_id, i);
-            node_share_inf->all_rcqps[total_qp_count] =
-                memcached_get_published_qp(srv_name);
-            total_qp_count++;
-        }
-        RSEC_PRINT("get machine %d/%d\n", cumulative_id, total_machines);
-    }
+    for (cumulative_id = 0; cumulative_id < total_machines; cumulative_id++)
+        sprintf(batch_names[cumulative_id], RSEC_RC_QP_BATCH_STRING,
+                cumulative_id);
+    ib_get_published_qp_batch((const char *const *)batch_names,
+                              total_machines, node_share_inf->num_local_rcqps,
+                              node_share_inf->all_rcqps);
+    RSEC_PRINT("get machine %d/%d\n", total_machines, total_machines);
     // connected all rc queue pairs
     total_qp_count = 0;
     for (i = 0; i < total_machines; i++) {
@@ -596,24 +693,21 @@ struct ib_inf *ib_complete_setup(struct configuration_params *input_arg,
         }
     }
 
-    total_qp_count = 0;
     // post all ud qp
-    for (i = 0; i < node_share_inf->num_local_udqps; i++) {
-        char srv_name[RSEC_MAX_QP_NAME];
-        sprintf(srv_name, "machine-ud-%d-%d", machine_id, i);
-        memcached_publish_udqp(node_share_inf, i, srv_name);
-    }
+    sprintf(srv_name, RSEC_UD_QP_BATCH_STRING, machine_id);
+    memcached_publish_qp_batch(node_share_inf, node_share_inf->dgram_qp,
+                               node_share_inf->num_local_udqps, RSEC_UD_SL,
+                               srv_name);
     // get all published ud qps
-    for (cumulative_id = 0; cumulative_id < total_machines; cumulative_id++) {
-        for (i = 0; i < node_share_inf->num_local_udqps; i++) {
-            char srv_name[RSEC_MAX_QP_NAME];
-            sprintf(srv_name, "machine-ud-%d-%d", cumulative_id, i);
-            node_share_inf->all_udqps[total_qp_count] =
-                memcached_get_published_qp(srv_name);
-            total_qp_count++;
-        }
-        // dbg_printf("get machine UD %d\n", cumulative_id);
-    }
+    for (cumulative_id = 0; cumulative_id < total_machines; cumulative_id++)
+        sprintf(batch_names[cumulative_id], RSEC_UD_QP_BATCH_STRING,
+                cumulative_id);
+    ib_get_published_qp_batch((const char *const *)batch_names,
+                              total_machines, node_share_inf->num_local_udqps,
+                              node_share_inf->all_udqps);
+    for (cumulative_id = 0; cumulative_id < total_machines; cumulative_id++)
+        free(batch_names[cumulative_id]);
+    free(batch_names);
     // connected all UD queue pairs
     RSEC_PRINT("done %s\n", role_str);
     // post_recv for local UD
@@ -645,57 +739,53 @@ struct ib_inf *ib_complete_setup(struct configuration_params *input_arg,
 
     if (input_arg->num_attack_qps) {
         int server_flag = 0;
+        const char *remote_batch_name;
         if (input_arg->machine_id == 0)
             server_flag = 1;
         else
             server_flag = 0;
-        for (i = 0; i < node_share_inf->num_attack_rcqps; i++) {
-            char srv_name[RSEC_MAX_QP_NAME];
-            if (server_flag)  // server
-                sprintf(srv_name, RSEC_ATTACK_QP_STRING_SERVER, i);
-            else
-                sprintf(srv_name, RSEC_ATTACK_QP_STRING_ATTACKER, i);
-            memcached_publish_attackqp(node_share_inf, i, srv_name);
-        }
+        if (server_flag)  // server
+            sprintf(srv_name, RSEC_ATTACK_QP_BATCH_STRING_SERVER);
+        else
+            sprintf(srv_name, RSEC_ATTACK_QP_BATCH_STRING_ATTACKER);
+        memcached_publish_qp_batch(node_share_inf, node_share_inf->attack_qp,
+                                   node_share_inf->num_attack_rcqps,
+                                   RSEC_RC_SL, srv_name);
 
         // get all published attack qps
-        for (i = 0; i < node_share_inf->num_attack_rcqps; i++) {
-            char srv_name[RSEC_MAX_QP_NAME];
-            if (server_flag)
-                sprintf(srv_name, RSEC_ATTACK_QP_STRING_ATTACKER, i);
-            else
-                sprintf(srv_name, RSEC_ATTACK_QP_STRING_SERVER, i);
-            node_share_inf->attack_rcqps[i] =
-                memcached_get_published_qp(srv_name);
-        }
+        if (server_flag)
+            remote_batch_name = RSEC_ATTACK_QP_BATCH_STRING_ATTACKER;
+        else
+            remote_batch_name = RSEC_ATTACK_QP_BATCH_STRING_SERVER;
+        ib_get_published_qp_batch(&remote_batch_name, 1,
+                                  node_share_inf->num_attack_rcqps,
+                                  node_share_inf->attack_rcqps);
         RSEC_PRINT("get machine attacker qp %d\n", input_arg->num_attack_qps);
         // connected all attack queue pairs
         for (i = 0; i < node_share_inf->num_attack_rcqps; i++) {
             struct ib_qp_attr *dest = node_share_inf->attack_rcqps[i];
             struct ibv_qp_attr attr = {
                 .qp_state = IBV_QPS_RTR,
-                .path_mtu = (RSEC_NETWORK_MODE == RSEC_NETWORK_ROCE)
-                                ? IBV_MTU_1024
-                                : IBV_MTU_4096,
+                .path_mtu = ib_get_path_mtu(node_share_inf, dest),
                 .dest_qp_num = dest->qpn,
                 .rq_psn = RSEC_UD_PSN,
                 .max_dest_rd_atomic = 10,
                 .min_rnr_timer = 12,
                 .ah_attr = {
                     .is_global =
-                        (RSEC_NETWORK_MODE == RSEC_NETWORK_ROCE) ? 1 : 0,
-                    .dlid = (RSEC_NETWORK_MODE == RSEC_NETWORK_ROCE)
+                        (node_share_inf->network_mode == RSEC_NETWORK_ROCE),
+                    .dlid = (node_share_inf->network_mode == RSEC_NETWORK_ROCE)
                                 ? 0
                                 : dest->lid,
                     .sl = dest->sl,
                     .src_path_bits = 0,
                     .port_num = node_share_inf->port_index}};
-            if (RSEC_NETWORK_MODE == RSEC_NETWORK_ROCE) {
+            if (node_share_inf->network_mode == RSEC_NETWORK_ROCE) {
                 attr.ah_attr.grh.dgid.global.interface_id =
                     dest->remote_gid.global.interface_id;
                 attr.ah_attr.grh.dgid.global.subnet_prefix =
                     dest->remote_gid.global.subnet_prefix;
-                attr.ah_attr.grh.sgid_index = RSEC_SGID_INDEX;
+                attr.ah_attr.grh.sgid_index = node_share_inf->sgid_index;
                 attr.ah_attr.grh.hop_limit = 1;
             }
             if (ibv_modify_qp(node_share_inf->attack_qp[i], &attr,
@@ -739,25 +829,24 @@ int ib_connect_qp(struct ib_inf *inf, int qp_index, struct ib_qp_attr *dest)
 {
     struct ibv_qp_attr attr = {
         .qp_state = IBV_QPS_RTR,
-        .path_mtu = (RSEC_NETWORK_MODE == RSEC_NETWORK_ROCE) ? IBV_MTU_1024
-                                                             : IBV_MTU_4096,
+        .path_mtu = ib_get_path_mtu(inf, dest),
         .dest_qp_num = dest->qpn,
         .rq_psn = RSEC_UD_PSN,
         .max_dest_rd_atomic = 10,
         .min_rnr_timer = 12,
         .ah_attr = {
-            .is_global = (RSEC_NETWORK_MODE == RSEC_NETWORK_ROCE) ? 1 : 0,
-            .dlid = (RSEC_NETWORK_MODE == RSEC_NETWORK_ROCE) ? 0 : dest->lid,
+            .is_global = (inf->network_mode == RSEC_NETWORK_ROCE),
+            .dlid = (inf->network_mode == RSEC_NETWORK_ROCE) ? 0 : dest->lid,
             .sl = dest->sl,
             .src_path_bits = 0,
             .port_num = inf->port_index}};
-    if (RSEC_NETWORK_MODE == RSEC_NETWORK_ROCE) {
+    if (inf->network_mode == RSEC_NETWORK_ROCE) {
         // attr.ah_attr.grh.dgid.global.interface_id =
         // dest->remote_gid.global.interface_id;
         // attr.ah_attr.grh.dgid.global.subnet_prefix =
         // dest->remote_gid.global.subnet_prefix;
         attr.ah_attr.grh.dgid = dest->remote_gid;
-        attr.ah_attr.grh.sgid_index = RSEC_SGID_INDEX;
+        attr.ah_attr.grh.sgid_index = inf->sgid_index;
         attr.ah_attr.grh.hop_limit = 1;
     }
     if (ibv_modify_qp(inf->conn_qp[qp_index], &attr,
@@ -790,12 +879,18 @@ int ib_connect_qp(struct ib_inf *inf, int qp_index, struct ib_qp_attr *dest)
 struct ibv_ah *ib_create_ah_for_ud(struct ib_inf *inf, int ah_index,
                                    struct ib_qp_attr *dest) {
     struct ibv_ah_attr ah_attr = {
-        .is_global = (RSEC_NETWORK_MODE == RSEC_NETWORK_ROCE) ? 1 : 0,
-        .dlid = (RSEC_NETWORK_MODE == RSEC_NETWORK_ROCE) ? 0 : dest->lid,
+        .is_global = (inf->network_mode == RSEC_NETWORK_ROCE),
+        .dlid = (inf->network_mode == RSEC_NETWORK_ROCE) ? 0 : dest->lid,
         .sl = RSEC_UD_SL,
         .src_path_bits = 0,
         .port_num = inf->port_index};
-    struct ibv_ah *tar_ah = ibv_create_ah(inf->pd, &ah_attr);
+    struct ibv_ah *tar_ah;
+    if (inf->network_mode == RSEC_NETWORK_ROCE) {
+        ah_attr.grh.dgid = dest->remote_gid;
+        ah_attr.grh.sgid_index = inf->sgid_index;
+        ah_attr.grh.hop_limit = 1;
+    }
+    tar_ah = ibv_create_ah(inf->pd, &ah_attr);
     return tar_ah;
 }
 
@@ -841,7 +936,10 @@ int userspace_one_write(struct ibv_qp *qp, struct ibv_mr *local_mr,
     wr.wr_id = 0;
     wr.wr.rdma.remote_addr = remote_mr->addr + offset;
     wr.wr.rdma.rkey = remote_mr->rkey;
-    ret = ibv_post_send(qp, &wr, &bad_send_wr);
+    if (rnic_sim_enabled)
+        ret = rnic_sim_post_send(qp, &wr);
+    else
+        ret = ibv_post_send(qp, &wr, &bad_send_wr);
     CPE(ret, "ibv_post_send error", ret);
     return 0;
 }
@@ -852,7 +950,10 @@ int userspace_one_write(struct ibv_qp *qp, struct ibv_mr *local_mr,
 int userspace_one_preset(struct ibv_qp *qp, struct ibv_send_wr *wr) {
     struct ibv_send_wr *bad_send_wr;
     int ret;
-    ret = ibv_post_send(qp, wr, &bad_send_wr);
+    if (rnic_sim_enabled)
+        ret = rnic_sim_post_send(qp, wr);
+    else
+        ret = ibv_post_send(qp, wr, &bad_send_wr);
     CPE(ret, "ibv_post_send error", ret);
     return 0;
 }
@@ -897,7 +998,10 @@ int userspace_one_read(struct ibv_qp *qp, struct ibv_mr *local_mr,
     wr.send_flags = IBV_SEND_SIGNALED;
     wr.wr.rdma.remote_addr = remote_mr->addr + offset;
     wr.wr.rdma.rkey = remote_mr->rkey;
-    ret = ibv_post_send(qp, &wr, &bad_send_wr);
+    if (rnic_sim_enabled)
+        ret = rnic_sim_post_send(qp, &wr);
+    else
+        ret = ibv_post_send(qp, &wr, &bad_send_wr);
     CPE(ret, "ibv_post_send error", ret);
     return 0;
 }
@@ -907,7 +1011,29 @@ int userspace_one_read(struct ibv_qp *qp, struct ibv_mr *local_mr,
  */
 int userspace_one_poll(struct ibv_cq *cq, int tar_mem) {
     struct ibv_wc wc[RSEC_CQ_DEPTH];
-    return ib_poll_cq(cq, tar_mem, wc);
+    int sim_comps = 0;
+    if (rnic_sim_enabled) sim_comps = rnic_sim_poll_cq(cq, tar_mem, wc);
+    if (sim_comps == tar_mem) return 0;
+    return ib_poll_cq(cq, tar_mem - sim_comps, &wc[sim_comps]);
+}
+
+/**
+ * userspace_one_try_poll: poll target CQ without waiting
+ * Returns the number of completions (at most tar_mem) already available.
+ */
+int userspace_one_try_poll(struct ibv_cq *cq, int tar_mem,
+                           struct ibv_wc *input_wc) {
+    int i, ret, comps = 0;
+    if (rnic_sim_enabled) comps = rnic_sim_poll_cq(cq, tar_mem, input_wc);
+    if (comps < tar_mem) {
+        ret = ibv_poll_cq(cq, tar_mem - comps, &input_wc[comps]);
+        CPE(ret < 0, "ibv_poll_cq error", ret);
+        comps += ret;
+    }
+    for (i = 0; i < comps; i++)
+        if (input_wc[i].status != IBV_WC_SUCCESS)
+            die_printf("Bad wc status %d\n", input_wc[i].status);
+    return comps;
 }
 
 /**
@@ -915,6 +1041,9 @@ int userspace_one_poll(struct ibv_cq *cq, int tar_mem) {
  */
 inline int userspace_one_poll_wr(struct ibv_cq *cq, int tar_mem,
                                  struct ibv_wc *input_wc) {
-    ib_poll_cq(cq, tar_mem, input_wc);
+    int sim_comps = 0;
+    if (rnic_sim_enabled) sim_comps = rnic_sim_poll_cq(cq, tar_mem, input_wc);
+    if (sim_comps < tar_mem)
+        ib_poll_cq(cq, tar_mem - sim_comps, &input_wc[sim_comps]);
     return tar_mem;
 }
@@ -2,13 +2,22 @@
 #define RSEC_IBSETUP_HEADER
 #include <infiniband/verbs.h>
 #include "rsec_struct.h"
+#include "mock_verbs.h"
 
+// network mode is detected from the link layer of the port (ib_get_device)
 #define RSEC_NETWORK_IB 1
 #define RSEC_NETWORK_ROCE 2
-#define RSEC_NETWORK_MODE RSEC_NETWORK_IB
-//#define RSEC_NETWORK_MODE RSEC_NETWORK_ROCE
+static const char *const rsec_network_mode_text[] = {
+    "------RSEC STRING------", "RSEC_NETWORK_IB", "RSEC_NETWORK_ROCE"};
 
-#define RSEC_SGID_INDEX 3
+// AUTO picks a RoCE v2 GID (IPv4-mapped first), any other value forces it
+#define RSEC_SGID_INDEX_AUTO -1
+#define RSEC_SGID_INDEX RSEC_SGID_INDEX_AUTO
+#define RSEC_GID_TYPE_STRING \
+    "/sys/class/infiniband/%s/ports/%d/gid_attrs/types/%d"
+
+#define RSEC_RC_QP_BATCH_STRING "machine-rc-%d"
+#define RSEC_UD_QP_BATCH_STRING "machine-ud-%d"
 
 #define RSEC_ID_COMBINATION(qp_index, i) ((qp_index << 16) + i)
 #define RSEC_ID_TO_QP(wr_id) (wr_id >> 16)
@@ -22,7 +31,9 @@ struct ib_post_recv_inf {
 typedef struct ib_post_recv_inf ib_post_recv_inf;
 
 int test(int);
-union ibv_gid ib_get_gid(struct ibv_context *context, int port_index);
+union ibv_gid ib_get_gid(struct ibv_context *context, int port_index,
+                         int sgid_index);
+int ib_find_sgid_index(struct ibv_context *context, int port_index);
 struct ibv_device *ib_get_device(struct ib_inf *inf, int port);
 void ib_create_udqps(struct ib_inf *inf);
 struct ib_inf *ib_setup(int id, int port, int num_rcqp_to_server,
@@ -58,6 +69,8 @@ int userspace_one_write(struct ibv_qp *qp, struct ibv_mr *local_mr,
                         int request_size, struct ib_mr_attr *remote_mr,
                         unsigned long long offset);
 int userspace_one_poll(struct ibv_cq *cq, int tar_mem);
+int userspace_one_try_poll(struct ibv_cq *cq, int tar_mem,
+                           struct ibv_wc *input_wc);
 inline int userspace_one_poll_wr(struct ibv_cq *cq, int tar_mem,
                                  struct ibv_wc *input_wc);
 
@@ -27,8 +27,15 @@ int main(int argc, char *argv[]) {
     int device_id = 0;
     int num_loopback = -1;
     int interaction_mode = 0;
+    unsigned int epoch = 0;
+    int registry_mode = RSEC_REGISTRY_MEMCACHED;
+    int data_path = RSEC_DATA_PATH_VERBS;
+    int verbs_mode = RSEC_VERBS_HW;
     struct configuration_params *param_arr;
     pthread_t *thread_arr;
+    char *config_file = NULL, *sweep_file = NULL, *strategy_list = NULL;
+    char **config_options = malloc(sizeof(char *) * argc);
+    int num_config_options = 0;
 
     static struct option opts[] = {
         {.name = "master", .has_arg = 1, .val = 'h'},
@@ -41,11 +48,21 @@ int main(int argc, char *argv[]) {
         {.name = "device-id", .has_arg = 1, .val = 'd'},
         {.name = "num-loopbackset", .has_arg = 1, .val = 'L'},
         {.name = "interaction", .has_arg = 1, .val = 'M'},
+        {.name = "epoch", .has_arg = 1, .val = 'E'},
+        {.name = "registry", .has_arg = 1, .val = 'R'},
+        {.name = "data-path", .has_arg = 1, .val = 'N'},
+        {.name = "verbs", .has_arg = 1, .val = 'V'},
+        {.name = "decode", .has_arg = 1, .val = 'D'},
+        {.name = "config", .has_arg = 1, .val = 'F'},
+        {.name = "option", .has_arg = 1, .val = 'O'},
+        {.name = "sweep", .has_arg = 1, .val = 'W'},
+        {.name = "strategy", .has_arg = 1, .val = 'P'},
         {0}};
 
     /* Parse and check arguments */
     while (1) {
-        c = getopt_long(argc, argv, "h:b:c:m:s:C:S:I:d:L:M:", opts, NULL);
+        c = getopt_long(argc, argv, "h:b:c:m:s:C:S:I:d:L:M:E:R:N:V:D:F:O:W:P:",
+                        opts, NULL);
         if (c == -1) {
             break;
         }
@@ -81,41 +98,69 @@ int main(int argc, char *argv[]) {
             case 'M':
                 interaction_mode = atoi(optarg);
                 break;
+            case 'E':
+                epoch = strtoul(optarg, NULL, 10);
+                break;
+            case 'R':
+                registry_mode = atoi(optarg);
+                break;
+            case 'N':
+                data_path = atoi(optarg);
+                break;
+            case 'V':
+                verbs_mode = atoi(optarg);
+                break;
+            case 'D':
+                // print a binary attacker log and exit [rsec_log.h]
+                return rsec_log_decode(optarg) ? EXIT_FAILURE : EXIT_SUCCESS;
+            case 'F':
+                config_file = optarg;
+                break;
+            case 'O':
+                // applied after the file, in command line order
+                config_options[num_config_options++] = optarg;
+                break;
+            case 'W':
+                sweep_file = optarg;
+                break;
+            case 'P':
+                strategy_list = optarg;
+                break;
             default:
                 printf("Invalid argument %d\n", c);
                 assert(0);
         }
     }
+    /* Experiment configuration [rsec_config.h] */
+    if (config_file && rsec_config_load(config_file))
+        die_printf("invalid configuration file %s\n", config_file);
+    for (i = 0; i < num_config_options; i++)
+        if (rsec_config_set_option(config_options[i]))
+            die_printf("invalid option %s\n", config_options[i]);
+    free(config_options);
+    if (strategy_list && rsec_strategy_load(strategy_list))
+        die_printf("invalid strategy %s\n", strategy_list);
+    if (sweep_file && rsec_sweep_load(sweep_file, epoch))
+        die_printf("invalid sweep file %s\n", sweep_file);
+    rsec_config_validate();
+    rsec_config_print();
+    rsec_strategy_print();
+    rsec_sweep_print();
+
     /* Common checks for all (master, workers, clients */
     assert(base_port_index >= 0 && base_port_index <= 8);
     if (interaction_mode) RSEC_PRINT("[INTERACTION MODE]\n");
     /* Common sanity checks for worker process and per-machine client process */
     assert((is_client + is_server) == 0);
     assert((num_loopback) >= 0);
-    if (RSEC_PAGE_SIZE > RSEC_MR_SIZE)
-        assert(RSEC_PAGE_SIZE % RSEC_MR_SIZE == 0);
-    else
-        assert(RSEC_MR_SIZE % RSEC_PAGE_SIZE == 0);
 
     if (RSEC_EXP_MODE == RSEC_EXP_MODE_CACHE) {
-        assert(RSEC_RELOAD_MR_NUMBER == 2);
-        assert(RSEC_PROBE_GET_THRESHOLD_TRY_NUMBER >= 100);
-        assert(RSEC_CACHE_SET_N_HEIGHT_LEFT - RSEC_CACHE_SET_N_HEIGHT_RIGHT >=
-               0);
-        assert(RSEC_CACHE_SLOT_M_WIDTH_LEFT - RSEC_CACHE_SLOT_M_WIDTH_RIGHT >=
-               0);
-        assert(RSEC_CACHE_SET_IGNORE_BITS == RSEC_CACHE_SET_N_HEIGHT_RIGHT);
         RSEC_PRINT("SET_UNIT_SIZE: %d:%d %x\tSET_MASK:%llx\n",
                    RSEC_CACHE_SET_N_HEIGHT_LEFT, RSEC_CACHE_SET_UNIT_SIZE,
                    RSEC_CACHE_SET_UNIT_SIZE, RSEC_CACHE_SET_MASK);
     }
     RSEC_PRINT("EXPERIMENT_MODE: %s\n",
                rsec_experiment_mode_text[RSEC_EXP_MODE]);
-
-    assert(RSEC_RELOAD_MR_NUMBER <= RSEC_CQ_DEPTH);
-    assert(RSEC_ACCESS_MR_NUMBER <= RSEC_CQ_DEPTH);
-    assert(RSEC_EVICT_QP_NUMBER <= RSEC_ATTACK_QP_NUMBER);
-    assert(RSEC_DATA_SIZE % RSEC_AES_BLOCK_SIZE == 0);
     if (is_client == 1) {
         assert(num_clients >= 1);
         assert(num_servers >= 1);
@@ -135,7 +180,6 @@ int main(int argc, char *argv[]) {
     RSEC_PRINT("access MR/test times/mode:%d/%d/%s\n", RSEC_ACCESS_MR_RANGE,
                RSEC_ACCESS_TEST_TIME,
                rsec_operation_mode_text[RSEC_ACCESS_MODE]);
-    assert(RSEC_ACCESS_MODE == RSEC_OPERATION_READ);
     /* Launch a single server thread or multiple client threads */
     // printf("main: Using %d %d threads\n", num_threads, machine_id);
     param_arr = malloc(num_threads * sizeof(struct configuration_params));
@@ -150,6 +194,10 @@ int main(int argc, char *argv[]) {
         param_arr[0].device_id = device_id;
         param_arr[0].num_loopback = num_loopback;
         param_arr[0].interaction_mode = interaction_mode;
+        param_arr[0].epoch = epoch;
+        param_arr[0].registry_mode = registry_mode;
+        param_arr[0].data_path = data_path;
+        param_arr[0].verbs_mode = verbs_mode;
 
         if (is_client >= 0) run_client(&param_arr[0]);
         if (is_server >= 0) run_server(&param_arr[0]);
@@ -3,6 +3,8 @@ source ./setup.json
 #count=$(ps -aux | grep mit_insmod.sh| wc -l)
 #if [ "$count" != "1" ]; then pgrep --exact mit_insmod.sh | xargs kill -9; fi
 ps aux | grep $path | awk '{print $2}' | xargs kill -9
+rm -f /dev/shm/rsec-registry-* /dev/shm/rsec-rnic-sim-* \
+	/dev/shm/rsec-mock-verbs-*
 for VARIABLE in "${pass_others[@]}"
 do
         VARI="$prefix$VARIABLE"
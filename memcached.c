@@ -2,10 +2,96 @@
 
 /**
  * memcached.c: this code interacts with MEMCACHED server.
+ * The memcached_* API is the front end of the registry: it scopes keys and
+ * forwards them to the selected backend (MEMCACHED server by default).
  * Part of the code borrows the ideas from libhrd -
  * https://github.com/efficient/rdma_bench/tree/master/libhrd
  */
 __thread memcached_st *memc = NULL;
+/* result reused by every memcached_get_published_into */
+__thread memcached_result_st *memc_result = NULL;
+/* deletes are pipelined on a separate no-reply connection */
+__thread memcached_st *memc_gc = NULL;
+/* keys published by this thread with memcached_publish */
+__thread GArray *memcached_published_keys = NULL;
+unsigned int memcached_epoch = 0;
+static const struct registry_backend memcached_backend;
+static const struct registry_backend *registry = &memcached_backend;
+
+/**
+ * memcached_set_backend - select the registry backend
+ * It has to be called before any key is published or fetched.
+ * @registry_mode: RSEC_REGISTRY_MEMCACHED or RSEC_REGISTRY_SHM
+ */
+void memcached_set_backend(int registry_mode) {
+    switch (registry_mode) {
+        case RSEC_REGISTRY_MEMCACHED:
+            registry = &memcached_backend;
+            break;
+        case RSEC_REGISTRY_SHM:
+            registry = &registry_shm_backend;
+            break;
+        default:
+            die_printf("[%s] unknown registry mode %d\n", __func__,
+                       registry_mode);
+    }
+    RSEC_PRINT("REGISTRY_MODE: %s\n", rsec_registry_mode_text[registry_mode]);
+}
+
+/**
+ * memcached_set_epoch - set the run epoch which scopes every registry key
+ * epoch 0 keeps keys unscoped
+ * @epoch: run epoch
+ */
+void memcached_set_epoch(unsigned int epoch) {
+    memcached_epoch = epoch;
+    if (epoch) RSEC_PRINT("registry epoch: %u\n", epoch);
+}
+
+/**
+ * memcached_scope_key - get the key which is really stored in memcached
+ * @key: key
+ * @scoped_key: buffer of RSEC_MEMCACHED_MAX_KEY bytes
+ */
+static const char *memcached_scope_key(const char *key, char *scoped_key) {
+    if (!memcached_epoch) return key;
+    snprintf(scoped_key, RSEC_MEMCACHED_MAX_KEY, RSEC_MEMCACHED_EPOCH_STRING,
+             memcached_epoch, key);
+    return scoped_key;
+}
+
+/**
+ * memcached_scope_keys - scope a list of keys
+ * The returned list is released with memcached_free_keys.
+ * @keys: key list
+ * @num_keys: length of key list
+ */
+static char **memcached_scope_keys(const char *const *keys, int num_keys) {
+    char **scoped_keys = malloc(sizeof(char *) * num_keys);
+    int i;
+    assert(scoped_keys);
+    for (i = 0; i < num_keys; i++) {
+        scoped_keys[i] = malloc(RSEC_MEMCACHED_MAX_KEY);
+        assert(scoped_keys[i]);
+        // memcached_scope_key only writes scoped_keys[i] with an epoch
+        if (memcached_epoch)
+            memcached_scope_key(keys[i], scoped_keys[i]);
+        else
+            snprintf(scoped_keys[i], RSEC_MEMCACHED_MAX_KEY, "%s", keys[i]);
+    }
+    return scoped_keys;
+}
+
+/**
+ * memcached_free_keys - release a list from memcached_scope_keys
+ * @keys: key list
+ * @num_keys: length of key list
+ */
+static void memcached_free_keys(char **keys, int num_keys) {
+    int i;
+    for (i = 0; i < num_keys; i++) free(keys[i]);
+    free(keys);
+}
 
 /**
  * memcached_create_memc - create memcached contextn
@@ -29,12 +115,40 @@ memcached_st *memcached_create_memc(void) {
 
 /**
  * memcached_publish - publish memcached entry
+ * The key expires after RSEC_MEMCACHED_SETUP_EXPIRATION and is removed by
+ * memcached_cleanup_published.
  * @key: key
  * @value: value
  * @len: size of the value
  */
 void memcached_publish(const char *key, void *value, int len) {
+    char *tracked_key;
+    memcached_publish_expire(key, value, len, RSEC_MEMCACHED_SETUP_EXPIRATION);
+
+    if (memcached_published_keys == NULL)
+        memcached_published_keys = g_array_new(FALSE, FALSE, sizeof(char *));
+    tracked_key = strdup(key);
+    g_array_append_val(memcached_published_keys, tracked_key);
+}
+
+/**
+ * memcached_publish_expire - publish memcached entry with an expiration
+ * The key is not tracked by memcached_cleanup_published.
+ * @key: key
+ * @value: value
+ * @len: size of the value
+ * @expiration: expiration in seconds (0 means never)
+ */
+void memcached_publish_expire(const char *key, void *value, int len,
+                              int expiration) {
+    char scoped_key[RSEC_MEMCACHED_MAX_KEY];
     assert(key != NULL && value != NULL && len > 0);
+    registry->set(memcached_scope_key(key, scoped_key), value, len,
+                  expiration);
+}
+
+static void memcached_backend_set(const char *key, const void *value, int len,
+                                  int expiration) {
     memcached_return rc;
 
     if (memc == NULL) {
@@ -42,7 +156,7 @@ void memcached_publish(const char *key, void *value, int len) {
     }
 
     rc = memcached_set(memc, key, strlen(key), (const char *)value, len,
-                       (time_t)0, (uint32_t)0);
+                       (time_t)expiration, (uint32_t)0);
     if (rc != MEMCACHED_SUCCESS) {
         char *registry_ip = MEMCACHED_IP;
         fprintf(stderr,
@@ -54,39 +168,67 @@ void memcached_publish(const char *key, void *value, int len) {
 }
 
 /**
- * memcached_publish_rcqp - publish queue pair information
+ * memcached_form_qp_attr - fill the published information of a queue pair
  * @inf: RDMA context
- * @num: index
- * @qp_name: key - name of this qp
+ * @qp: queue pair
+ * @sl: service level
+ * @qp_name: name of this qp
+ * @qp_attr: return qp information
  */
-void memcached_publish_rcqp(struct ib_inf *inf, int num, const char *qp_name) {
-    assert(inf != NULL);
-    assert(num >= 0 && num < inf->num_local_rcqps);
-
+static void memcached_form_qp_attr(struct ib_inf *inf, struct ibv_qp *qp,
+                                   int sl, const char *qp_name,
+                                   struct ib_qp_attr *qp_attr) {
+    int len;
     assert(qp_name != NULL && strlen(qp_name) < RSEC_MAX_QP_NAME - 1);
     assert(strstr(qp_name, RSEC_RESERVED_NAME_PREFIX) == NULL);
 
-    int len = strlen(qp_name);
-    int i;
+    len = strlen(qp_name);
+    memset(qp_attr, 0, sizeof(struct ib_qp_attr));
+    memcpy(qp_attr->name, qp_name, len);
+    qp_attr->name[len] = 0; /* Add the null terminator */
+    qp_attr->lid = ib_get_local_lid(qp->context, inf->dev_port_id);
+    qp_attr->qpn = qp->qp_num;
+    qp_attr->sl = sl;
+
+    qp_attr->mtu = inf->active_mtu;
+
+    if (inf->network_mode == RSEC_NETWORK_ROCE) {
+        qp_attr->remote_gid = inf->local_gid;
+    }
+}
+
+/**
+ * memcached_check_name - make sure a registry key is valid
+ * @name: key
+ */
+static void memcached_check_name(const char *name) {
+    int len, i;
+    assert(name != NULL && strlen(name) < RSEC_MAX_QP_NAME - 1);
+    assert(strstr(name, RSEC_RESERVED_NAME_PREFIX) == NULL);
+
+    len = strlen(name);
     for (i = 0; i < len; i++) {
-        if (qp_name[i] == ' ') {
+        if (name[i] == ' ') {
             fprintf(stderr, "Space not allowed in QP name\n");
             exit(-1);
         }
     }
+}
+
+/**
+ * memcached_publish_rcqp - publish queue pair information
+ * @inf: RDMA context
+ * @num: index
+ * @qp_name: key - name of this qp
+ */
+void memcached_publish_rcqp(struct ib_inf *inf, int num, const char *qp_name) {
     struct ib_qp_attr qp_attr;
-    memcpy(qp_attr.name, qp_name, len);
-    qp_attr.name[len] = 0; /* Add the null terminator */
-    // qp_attr.buf_addr = (uint64_t)inf->rcqp_buf[num];
-    // qp_attr.rkey = (uint32_t)inf->rcqp_buf_mr[num]->rkey;
-    qp_attr.lid =
-        ib_get_local_lid(inf->conn_qp[num]->context, inf->dev_port_id);
-    qp_attr.qpn = inf->conn_qp[num]->qp_num;
-    qp_attr.sl = RSEC_RC_SL;
-
-    if (RSEC_NETWORK_MODE == RSEC_NETWORK_ROCE) {
-        qp_attr.remote_gid = inf->local_gid;
-    }
+    assert(inf != NULL);
+    assert(num >= 0 && num < inf->num_local_rcqps);
+    memcached_check_name(qp_name);
+
+    memcached_form_qp_attr(inf, inf->conn_qp[num], RSEC_RC_SL, qp_name,
+                           &qp_attr);
     // printf("rc_publish: %d %s %d %d %lu %lu\n",
     //        num, qp_name, qp_attr.lid, qp_attr.qpn, qp_attr.buf_addr,
     // qp_attr.rkey);
@@ -101,32 +243,13 @@ void memcached_publish_rcqp(struct ib_inf *inf, int num, const char *qp_name) {
  */
 void memcached_publish_attackqp(struct ib_inf *inf, int num,
                                 const char *qp_name) {
+    struct ib_qp_attr qp_attr;
     assert(inf != NULL);
     assert(num >= 0 && num < inf->num_attack_rcqps);
+    memcached_check_name(qp_name);
 
-    assert(qp_name != NULL && strlen(qp_name) < RSEC_MAX_QP_NAME - 1);
-    assert(strstr(qp_name, RSEC_RESERVED_NAME_PREFIX) == NULL);
-
-    int len = strlen(qp_name);
-    int i;
-    for (i = 0; i < len; i++) {
-        if (qp_name[i] == ' ') {
-            fprintf(stderr, "Space not allowed in QP name\n");
-            exit(-1);
-        }
-    }
-    struct ib_qp_attr qp_attr;
-    memcpy(qp_attr.name, qp_name, len);
-    qp_attr.name[len] = 0; /* Add the null terminator */
-    qp_attr.lid =
-        ib_get_local_lid(inf->attack_qp[num]->context, inf->dev_port_id);
-    qp_attr.qpn = inf->attack_qp[num]->qp_num;
-    qp_attr.sl = RSEC_RC_SL;
-
-    if (RSEC_NETWORK_MODE == RSEC_NETWORK_ROCE) {
-        qp_attr.remote_gid = inf->local_gid;
-    }
-
+    memcached_form_qp_attr(inf, inf->attack_qp[num], RSEC_RC_SL, qp_name,
+                           &qp_attr);
     memcached_publish(qp_attr.name, &qp_attr, sizeof(struct ib_qp_attr));
 }
 
@@ -137,28 +260,43 @@ void memcached_publish_attackqp(struct ib_inf *inf, int num,
  * @qp_name: key - name of this qp (use different key-prefix with regular qp)
  */
 void memcached_publish_udqp(struct ib_inf *inf, int num, const char *qp_name) {
+    struct ib_qp_attr qp_attr;
     assert(inf != NULL);
     assert(num >= 0 && num < inf->num_local_udqps);
+    memcached_check_name(qp_name);
 
-    assert(qp_name != NULL && strlen(qp_name) < RSEC_MAX_QP_NAME - 1);
-    assert(strstr(qp_name, RSEC_RESERVED_NAME_PREFIX) == NULL);
+    memcached_form_qp_attr(inf, inf->dgram_qp[num], RSEC_UD_SL, qp_name,
+                           &qp_attr);
+    memcached_publish(qp_attr.name, &qp_attr, sizeof(struct ib_qp_attr));
+}
 
-    int len = strlen(qp_name);
+/**
+ * memcached_publish_qp_batch - publish a list of queue pairs as one packed
+ * record (an array of struct ib_qp_attr) so that peers fetch all of them in a
+ * single round trip
+ * @inf: RDMA context
+ * @qp_list: queue pairs
+ * @num: length of qp_list
+ * @sl: service level
+ * @batch_name: key of the packed record - entry i is named batch_name-i
+ */
+void memcached_publish_qp_batch(struct ib_inf *inf, struct ibv_qp **qp_list,
+                                int num, int sl, const char *batch_name) {
+    struct ib_qp_attr *qp_attr_list;
+    char qp_name[RSEC_MAX_QP_NAME];
     int i;
-    for (i = 0; i < len; i++) {
-        if (qp_name[i] == ' ') {
-            fprintf(stderr, "Space not allowed in QP name\n");
-            exit(-1);
-        }
+    assert(inf != NULL && qp_list != NULL && num > 0);
+    memcached_check_name(batch_name);
+
+    qp_attr_list = malloc(sizeof(struct ib_qp_attr) * num);
+    assert(qp_attr_list);
+    for (i = 0; i < num; i++) {
+        snprintf(qp_name, RSEC_MAX_QP_NAME - 1, "%s-%d", batch_name, i);
+        memcached_form_qp_attr(inf, qp_list[i], sl, qp_name, &qp_attr_list[i]);
     }
-    struct ib_qp_attr qp_attr;
-    memcpy(qp_attr.name, qp_name, len);
-    qp_attr.name[len] = 0; /* Add the null terminator */
-    qp_attr.lid =
-        ib_get_local_lid(inf->dgram_qp[num]->context, inf->dev_port_id);
-    qp_attr.qpn = inf->dgram_qp[num]->qp_num;
-    qp_attr.sl = RSEC_UD_SL;
-    memcached_publish(qp_attr.name, &qp_attr, sizeof(struct ib_qp_attr));
+    memcached_publish(batch_name, qp_attr_list,
+                      sizeof(struct ib_qp_attr) * num);
+    free(qp_attr_list);
 }
 
 /**
@@ -167,7 +305,12 @@ void memcached_publish_udqp(struct ib_inf *inf, int num, const char *qp_name) {
  * @value: return addr
  */
 int memcached_get_published(const char *key, void **value) {
+    char scoped_key[RSEC_MEMCACHED_MAX_KEY];
     assert(key != NULL);
+    return registry->get(memcached_scope_key(key, scoped_key), value);
+}
+
+static int memcached_backend_get(const char *key, void **value) {
     if (memc == NULL) {
         memc = memcached_create_memc();
     }
@@ -195,26 +338,370 @@ int memcached_get_published(const char *key, void **value) {
 }
 
 /**
- * memcached_get_published_qp - get QP information based on key
- * @qp_name: key
+ * memcached_get_published_into - get value based on key into a caller buffer
+ * Nothing is allocated, so it can be used in the trial loop.
+ * Returns the value length or -1 if the key is not published yet.
+ * @key: key
+ * @buf: return buffer
+ * @size: size of buf - a longer value is an error
  */
-struct ib_qp_attr *memcached_get_published_qp(const char *qp_name) {
-    struct ib_qp_attr *ret;
-    assert(qp_name != NULL && strlen(qp_name) < RSEC_MAX_QP_NAME - 1);
-    assert(strstr(qp_name, RSEC_RESERVED_NAME_PREFIX) == NULL);
+int memcached_get_published_into(const char *key, void *buf, int size) {
+    char scoped_key[RSEC_MEMCACHED_MAX_KEY];
+    assert(key != NULL && buf != NULL && size > 0);
+    return registry->get_into(memcached_scope_key(key, scoped_key), buf, size);
+}
 
-    int len = strlen(qp_name);
+static int memcached_backend_get_into(const char *key, void *buf, int size) {
+    memcached_return rc;
+    memcached_result_st *result;
+    size_t key_length = strlen(key);
+    int ret_len = -1;
+    if (memc == NULL) {
+        memc = memcached_create_memc();
+    }
+    if (memc_result == NULL) {
+        memc_result = memcached_result_create(memc, NULL);
+        assert(memc_result);
+    }
+
+    rc = memcached_mget(memc, &key, &key_length, 1);
+    if (rc != MEMCACHED_SUCCESS) {
+        char *registry_ip = MEMCACHED_IP;
+        fprintf(stderr,
+                "Error finding value for key \"%s\": %s. "
+                "Reg IP = %s\n",
+                key, memcached_strerror(memc, rc), registry_ip);
+        exit(-1);
+    }
+    // the result buffer is reused, fetch until the end of the response
+    while ((result = memcached_fetch_result(memc, memc_result, &rc)) !=
+           NULL) {
+        ret_len = (int)memcached_result_length(result);
+        if (ret_len > size)
+            die_printf("[%s] value of %s is %d bytes (buffer %d)\n",
+                       __func__, key, ret_len, size);
+        memcpy(buf, memcached_result_value(result), ret_len);
+    }
+    return ret_len;
+}
+
+/**
+ * memcached_get_published_multi - get values of several keys in one round trip
+ * Keys which are not published yet are left as NULL.
+ * Returns the number of keys found.
+ * @keys: key list
+ * @num_keys: length of key list
+ * @values: return addr of each key
+ * @lengths: return value length of each key (can be NULL)
+ */
+int memcached_get_published_multi(const char *const *keys, int num_keys,
+                                  void **values, int *lengths) {
+    char **scoped_keys;
+    int found;
+    assert(keys != NULL && values != NULL && num_keys > 0);
+
+    scoped_keys = memcached_scope_keys(keys, num_keys);
+    found = registry->mget((const char *const *)scoped_keys, num_keys, values,
+                           lengths);
+    memcached_free_keys(scoped_keys, num_keys);
+    return found;
+}
+
+static int memcached_backend_mget(const char *const *keys, int num_keys,
+                                  void **values, int *lengths) {
+    memcached_return rc;
+    memcached_result_st *result;
+    size_t *key_length;
+    GHashTable *key_index;
+    char return_key[RSEC_MEMCACHED_MAX_KEY];
+    int i, found = 0;
+    if (memc == NULL) {
+        memc = memcached_create_memc();
+    }
+
+    key_length = malloc(sizeof(size_t) * num_keys);
+    key_index = g_hash_table_new(g_str_hash, g_str_equal);
+    for (i = 0; i < num_keys; i++) {
+        values[i] = NULL;
+        if (lengths) lengths[i] = -1;
+        key_length[i] = strlen(keys[i]);
+        g_hash_table_insert(key_index, (gpointer)keys[i],
+                            GINT_TO_POINTER(i + 1));
+    }
+
+    rc = memcached_mget(memc, keys, key_length, num_keys);
+    if (rc != MEMCACHED_SUCCESS) {
+        char *registry_ip = MEMCACHED_IP;
+        fprintf(stderr,
+                "Error issuing multi-get of %d keys (\"%s\"...): %s. "
+                "Reg IP = %s\n",
+                num_keys, keys[0], memcached_strerror(memc, rc), registry_ip);
+        exit(-1);
+    }
+    while ((result = memcached_fetch_result(memc, NULL, &rc)) != NULL) {
+        size_t return_key_length = memcached_result_key_length(result);
+        size_t value_length = memcached_result_length(result);
+        assert(return_key_length < RSEC_MEMCACHED_MAX_KEY);
+        memcpy(return_key, memcached_result_key_value(result),
+               return_key_length);
+        return_key[return_key_length] = 0;
+        i = GPOINTER_TO_INT(g_hash_table_lookup(key_index, return_key)) - 1;
+        if (i >= 0 && values[i] == NULL && value_length > 0) {
+            values[i] = malloc(value_length);
+            assert(values[i]);
+            memcpy(values[i], memcached_result_value(result), value_length);
+            if (lengths) lengths[i] = (int)value_length;
+            found++;
+        }
+        memcached_result_free(result);
+    }
+    g_hash_table_destroy(key_index);
+    free(key_length);
+    return found;
+}
+
+/**
+ * memcached_delete_published - delete a list of keys
+ * Deletes are buffered on a no-reply connection and flushed once, so a whole
+ * list costs about one round trip. Missing keys are ignored.
+ * @keys: key list
+ * @num_keys: length of key list
+ */
+void memcached_delete_published(const char *const *keys, int num_keys) {
+    char **scoped_keys;
+    if (num_keys <= 0) return;
+    scoped_keys = memcached_scope_keys(keys, num_keys);
+    registry->delete((const char *const *)scoped_keys, num_keys);
+    memcached_free_keys(scoped_keys, num_keys);
+}
+
+/**
+ * memcached_delete_key - delete one key
+ * Fast path of the trial loop: the key is scoped into a stack buffer.
+ * @key: key
+ */
+void memcached_delete_key(const char *key) {
+    char scoped_key[RSEC_MEMCACHED_MAX_KEY];
+    const char *scoped = memcached_scope_key(key, scoped_key);
+    registry->delete(&scoped, 1);
+}
+
+static void memcached_backend_delete(const char *const *keys, int num_keys) {
     int i;
+    if (memc_gc == NULL) {
+        memc_gc = memcached_create_memc();
+        memcached_behavior_set(memc_gc, MEMCACHED_BEHAVIOR_NOREPLY, 1);
+        memcached_behavior_set(memc_gc, MEMCACHED_BEHAVIOR_BUFFER_REQUESTS, 1);
+    }
+    for (i = 0; i < num_keys; i++)
+        memcached_delete(memc_gc, keys[i], strlen(keys[i]), (time_t)0);
+    memcached_flush_buffers(memc_gc);
+}
+
+static const struct registry_backend memcached_backend = {
+    .name = "memcached",
+    .set = memcached_backend_set,
+    .get = memcached_backend_get,
+    .get_into = memcached_backend_get_into,
+    .mget = memcached_backend_mget,
+    .delete = memcached_backend_delete,
+};
+
+/**
+ * memcached_cleanup_published - delete every key this thread published with
+ * memcached_publish
+ * It should only be called once all peers have consumed those keys.
+ */
+void memcached_cleanup_published(void) {
+    int i;
+    if (memcached_published_keys == NULL) return;
+    memcached_delete_published(
+        (const char *const *)memcached_published_keys->data,
+        memcached_published_keys->len);
+    RSEC_PRINT("cleanup %d published keys\n", memcached_published_keys->len);
+    for (i = 0; i < memcached_published_keys->len; i++)
+        free(g_array_index(memcached_published_keys, char *, i));
+    g_array_free(memcached_published_keys, TRUE);
+    memcached_published_keys = NULL;
+}
+
+/**
+ * memcached_deadline - get the absolute deadline of a wait
+ * @deadline: return deadline
+ * @timeout_us: timeout in us, RSEC_MEMCACHED_WAIT_FOREVER means no deadline
+ */
+static void memcached_deadline(struct timespec *deadline, long timeout_us) {
+    if (timeout_us < 0) return;
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeout_us / (1000 * 1000);
+    deadline->tv_nsec += (timeout_us % (1000 * 1000)) * 1000;
+    if (deadline->tv_nsec >= 1000 * 1000 * 1000) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000 * 1000 * 1000;
+    }
+}
+
+/**
+ * memcached_backoff - back off between two registry polls
+ * The first RSEC_MEMCACHED_BACKOFF_SPIN retries are issued right away since
+ * most keys show up within a few round trips. After that, the sleep doubles
+ * from RSEC_MEMCACHED_BACKOFF_MIN_US up to RSEC_MEMCACHED_BACKOFF_MAX_US so
+ * waiting participants neither saturate the registry nor burn a core.
+ * Returns 1 if the deadline has passed.
+ * @tries: number of failed polls so far
+ * @deadline: absolute deadline
+ * @timeout_us: timeout in us, RSEC_MEMCACHED_WAIT_FOREVER means no deadline
+ */
+static int memcached_backoff(int tries, struct timespec *deadline,
+                             long timeout_us) {
+    long sleep_us;
+    struct timespec now;
+    if (timeout_us >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > deadline->tv_sec ||
+            (now.tv_sec == deadline->tv_sec &&
+             now.tv_nsec >= deadline->tv_nsec))
+            return 1;
+    }
+    if (tries < RSEC_MEMCACHED_BACKOFF_SPIN) return 0;
+    tries = RSEC_MIN(tries - RSEC_MEMCACHED_BACKOFF_SPIN, 20);
+    sleep_us = RSEC_MIN((long)RSEC_MEMCACHED_BACKOFF_MIN_US << tries,
+                        RSEC_MEMCACHED_BACKOFF_MAX_US);
+    usleep(sleep_us);
+    return 0;
+}
+
+/**
+ * memcached_wait_published - wait until a key is published and get its value
+ * Returns the value length, or RSEC_MEMCACHED_TIMEOUT if the key didn't show
+ * up before the deadline.
+ * @key: key
+ * @value: return addr
+ * @timeout_us: timeout in us, RSEC_MEMCACHED_WAIT_FOREVER means no deadline
+ */
+int memcached_wait_published(const char *key, void **value, long timeout_us) {
+    struct timespec deadline;
     int ret_len;
-    for (i = 0; i < len; i++) {
-        if (qp_name[i] == ' ') {
-            fprintf(stderr, "Space not allowed in QP name\n");
-            exit(-1);
+    int tries = 0;
+    memcached_deadline(&deadline, timeout_us);
+    while (1) {
+        ret_len = memcached_get_published(key, value);
+        if (ret_len > 0) return ret_len;
+        if (memcached_backoff(tries, &deadline, timeout_us)) break;
+        tries++;
+    }
+    *value = NULL;
+    return RSEC_MEMCACHED_TIMEOUT;
+}
+
+/**
+ * memcached_wait_published_multi - wait until all keys are published
+ * All keys which are still missing are fetched with one multi-get per poll,
+ * and polls are separated by the same backoff as memcached_wait_published.
+ * Returns @num_keys, or RSEC_MEMCACHED_TIMEOUT if some keys didn't show up
+ * before the deadline (found values are still returned).
+ * @keys: key list
+ * @num_keys: length of key list
+ * @values: return addr of each key, NULL if not found
+ * @lengths: return value length of each key (can be NULL)
+ * @timeout_us: timeout in us, RSEC_MEMCACHED_WAIT_FOREVER means no deadline
+ */
+int memcached_wait_published_multi(const char *const *keys, int num_keys,
+                                   void **values, int *lengths,
+                                   long timeout_us) {
+    struct timespec deadline;
+    const char **missing_keys = malloc(sizeof(char *) * num_keys);
+    int *missing_index = malloc(sizeof(int) * num_keys);
+    void **missing_values = malloc(sizeof(void *) * num_keys);
+    int *missing_lengths = malloc(sizeof(int) * num_keys);
+    int i, num_missing;
+    int tries = 0;
+    int ret = RSEC_MEMCACHED_TIMEOUT;
+    memcached_deadline(&deadline, timeout_us);
+    for (i = 0; i < num_keys; i++) {
+        values[i] = NULL;
+        if (lengths) lengths[i] = -1;
+    }
+    while (1) {
+        num_missing = 0;
+        for (i = 0; i < num_keys; i++) {
+            if (values[i]) continue;
+            missing_keys[num_missing] = keys[i];
+            missing_index[num_missing] = i;
+            num_missing++;
+        }
+        if (num_missing == 0) {
+            ret = num_keys;
+            break;
         }
+        if (tries && memcached_backoff(tries - 1, &deadline, timeout_us))
+            break;
+        memcached_get_published_multi(missing_keys, num_missing,
+                                      missing_values, missing_lengths);
+        for (i = 0; i < num_missing; i++) {
+            if (!missing_values[i]) continue;
+            values[missing_index[i]] = missing_values[i];
+            if (lengths) lengths[missing_index[i]] = missing_lengths[i];
+        }
+        tries++;
     }
-    do {
-        ret_len = memcached_get_published(qp_name, (void **)&ret);
-    } while (ret_len <= 0);
+    free(missing_keys);
+    free(missing_index);
+    free(missing_values);
+    free(missing_lengths);
+    return ret;
+}
+
+/**
+ * memcached_wait_published_into - wait until a key is published and copy its
+ * value into a caller buffer
+ * Returns the value length, or RSEC_MEMCACHED_TIMEOUT.
+ * @key: key
+ * @buf: return buffer
+ * @size: size of buf
+ * @timeout_us: timeout in us, RSEC_MEMCACHED_WAIT_FOREVER means no deadline
+ */
+int memcached_wait_published_into(const char *key, void *buf, int size,
+                                  long timeout_us) {
+    struct timespec deadline;
+    int ret_len;
+    int tries = 0;
+    memcached_deadline(&deadline, timeout_us);
+    while (1) {
+        ret_len = memcached_get_published_into(key, buf, size);
+        if (ret_len > 0) return ret_len;
+        if (memcached_backoff(tries, &deadline, timeout_us)) break;
+        tries++;
+    }
+    return RSEC_MEMCACHED_TIMEOUT;
+}
+
+/**
+ * memcached_wait_signal - wait for a signal (a RSEC_SIGNAL_SIZE value)
+ * Fast path of the trial loop: the value goes through a stack buffer.
+ * @key: key
+ */
+unsigned long memcached_wait_signal(const char *key) {
+    unsigned long signal_value;
+    int ret_len;
+    memcached_check_name(key);
+    ret_len = memcached_wait_published_into(key, &signal_value,
+                                            RSEC_SIGNAL_SIZE,
+                                            RSEC_MEMCACHED_WAIT_FOREVER);
+    assert(ret_len == RSEC_SIGNAL_SIZE);
+    return signal_value;
+}
+
+/**
+ * memcached_get_published_qp - get QP information based on key
+ * @qp_name: key
+ */
+struct ib_qp_attr *memcached_get_published_qp(const char *qp_name) {
+    struct ib_qp_attr *ret;
+    int ret_len;
+    memcached_check_name(qp_name);
+    ret_len = memcached_wait_published(qp_name, (void **)&ret,
+                                       RSEC_MEMCACHED_WAIT_FOREVER);
     /*
      * The registry lookup returns only if we get a unique QP for @qp_name, or
      * if the memcached lookup succeeds but we don't have an entry for @qp_name.
@@ -230,21 +717,10 @@ struct ib_qp_attr *memcached_get_published_qp(const char *qp_name) {
  */
 struct ib_mr_attr *memcached_get_published_mr(const char *mr_name) {
     struct ib_mr_attr *ret;
-    assert(mr_name != NULL && strlen(mr_name) < RSEC_MAX_QP_NAME - 1);
-    assert(strstr(mr_name, RSEC_RESERVED_NAME_PREFIX) == NULL);
-
-    int len = strlen(mr_name);
-    int i;
     int ret_len;
-    for (i = 0; i < len; i++) {
-        if (mr_name[i] == ' ') {
-            fprintf(stderr, "Space not allowed in QP name\n");
-            exit(-1);
-        }
-    }
-    do {
-        ret_len = memcached_get_published(mr_name, (void **)&ret);
-    } while (ret_len <= 0);
+    memcached_check_name(mr_name);
+    ret_len = memcached_wait_published(mr_name, (void **)&ret,
+                                       RSEC_MEMCACHED_WAIT_FOREVER);
     /*
      * The registry lookup returns only if we get a unique QP for @qp_name, or
      * if the memcached lookup succeeds but we don't have an entry for @qp_name.
@@ -261,21 +737,10 @@ struct ib_mr_attr *memcached_get_published_mr(const char *mr_name) {
  */
 void *memcached_get_published_size(const char *tar_name, int size) {
     void *ret;
-    assert(tar_name != NULL && strlen(tar_name) < RSEC_MAX_QP_NAME - 1);
-    assert(strstr(tar_name, RSEC_RESERVED_NAME_PREFIX) == NULL);
-
-    int len = strlen(tar_name);
-    int i;
     int ret_len;
-    for (i = 0; i < len; i++) {
-        if (tar_name[i] == ' ') {
-            fprintf(stderr, "Space not allowed in QP name\n");
-            exit(-1);
-        }
-    }
-    do {
-        ret_len = memcached_get_published(tar_name, (void **)&ret);
-    } while (ret_len <= 0);
+    memcached_check_name(tar_name);
+    ret_len = memcached_wait_published(tar_name, &ret,
+                                       RSEC_MEMCACHED_WAIT_FOREVER);
     /*
      * The registry lookup returns only if we get a unique QP for @qp_name, or
      * if the memcached lookup succeeds but we don't have an entry for @qp_name.
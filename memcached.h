@@ -5,15 +5,65 @@
 #include "ibsetup.h"
 #include <libmemcached/memcached.h>
 
+/**
+ * Registry backends: every key/value exchange of this program goes through
+ * the memcached_* functions below, which scope the key by the run epoch and
+ * hand it to the selected backend.
+ * RSEC_REGISTRY_MEMCACHED talks to the memcached server at MEMCACHED_IP.
+ * RSEC_REGISTRY_SHM uses a shared memory segment and only works when all
+ * roles run on the same host.
+ */
+#define RSEC_REGISTRY_MEMCACHED 1
+#define RSEC_REGISTRY_SHM 2
+static const char *const rsec_registry_mode_text[] = {
+    "------RSEC STRING------", "RSEC_REGISTRY_MEMCACHED", "RSEC_REGISTRY_SHM"};
+
+struct registry_backend {
+    const char *name;
+    /* keys below are already scoped by the epoch */
+    void (*set)(const char *key, const void *value, int len, int expiration);
+    /* returns the value length (value is malloc'd) or -1 if not found */
+    int (*get)(const char *key, void **value);
+    /* same as get but copies into buf (at most size bytes) */
+    int (*get_into)(const char *key, void *buf, int size);
+    /* returns the number of keys found, missing values are NULL */
+    int (*mget)(const char *const *keys, int num_keys, void **values,
+                int *lengths);
+    void (*delete)(const char *const *keys, int num_keys);
+};
+
+extern const struct registry_backend registry_shm_backend;
+extern unsigned int memcached_epoch;
+
+void memcached_set_backend(int registry_mode);
+
 void memcached_publish_rcqp(struct ib_inf *inf, int num, const char *qp_name);
 void memcached_publish_attackqp(struct ib_inf *inf, int num,
                                 const char *qp_name);
 void memcached_publish_udqp(struct ib_inf *inf, int num, const char *qp_name);
 struct ib_qp_attr *memcached_get_published_qp(const char *qp_name);
 int memcached_get_published(const char *key, void **value);
+int memcached_get_published_into(const char *key, void *buf, int size);
+int memcached_wait_published_into(const char *key, void *buf, int size,
+                                  long timeout_us);
+unsigned long memcached_wait_signal(const char *key);
 void *memcached_get_published_size(const char *tar_name, int size);
 memcached_st *memcached_create_memc(void);
 void memcached_publish(const char *key, void *value, int len);
+void memcached_publish_expire(const char *key, void *value, int len,
+                              int expiration);
+void memcached_set_epoch(unsigned int epoch);
+void memcached_delete_published(const char *const *keys, int num_keys);
+void memcached_delete_key(const char *key);
+void memcached_cleanup_published(void);
 struct ib_mr_attr *memcached_get_published_mr(const char *mr_name);
+void memcached_publish_qp_batch(struct ib_inf *inf, struct ibv_qp **qp_list,
+                                int num, int sl, const char *batch_name);
+int memcached_get_published_multi(const char *const *keys, int num_keys,
+                                  void **values, int *lengths);
+int memcached_wait_published(const char *key, void **value, long timeout_us);
+int memcached_wait_published_multi(const char *const *keys, int num_keys,
+                                   void **values, int *lengths,
+                                   long timeout_us);
 
 #endif
@@ -0,0 +1,598 @@
+#define _GNU_SOURCE
+#define RSEC_MOCK_VERBS_IMPL
+#include "rsec.h"
+#include <sys/prctl.h>
+#include <sys/uio.h>
+
+/**
+ * mock_verbs.c: this code implements the subset of verbs used by Pythia on
+ * top of shared memory, so that server, client and attacker can run as
+ * processes on one host.
+ * 1. QPs and MRs are entries of a shared table; qpn/rkey are table indexes
+ * 2. RDMA READ/WRITE are done by the initiator with process_vm_readv/writev on
+ *    the process owning the remote MR (one-sided like the real thing)
+ * 3. SEND (RC and UD) consumes a receive posted on the destination QP and
+ *    queues the receive completion in the shared QP entry
+ * 4. send completions are kept in the local CQ
+ * Every completion carries a deadline and poll only returns it once due.
+ * When the mock is not selected (RSEC_VERBS_HW), every call is forwarded.
+ */
+
+#define MOCK_VERBS_MAGIC 0x4d4f434bu
+#define MOCK_VERBS_RKEY(index, pid) (((index) << 8) | ((pid)&0xff))
+#define MOCK_VERBS_RKEY_TO_INDEX(rkey) ((rkey) >> 8)
+
+struct mock_verbs_mr_entry {
+    int32_t pid;
+    uint32_t access;
+    uint64_t addr;
+    uint64_t length;
+};
+
+struct mock_verbs_recv {
+    uint64_t wr_id;
+    uint64_t addr;
+    uint32_t length;
+};
+
+struct mock_verbs_cqe {
+    uint64_t wr_id;
+    uint64_t deadline;
+    uint32_t byte_len;
+    uint32_t qp_num;
+    uint32_t src_qp;
+    enum ibv_wc_status status;
+    enum ibv_wc_opcode opcode;
+};
+
+struct mock_verbs_qp_entry {
+    pthread_spinlock_t lock;
+    int32_t pid;
+    enum ibv_qp_type qp_type;
+    enum ibv_qp_state state;
+    uint32_t dest_qpn;
+    /* receives posted on this QP */
+    uint32_t recv_head, recv_count;
+    struct mock_verbs_recv recv[RSEC_CQ_DEPTH];
+    /* receive completions waiting for the owner's recv CQ */
+    uint32_t cqe_head;
+    volatile uint32_t cqe_count;
+    struct mock_verbs_cqe cqe[RSEC_CQ_DEPTH];
+};
+
+struct mock_verbs_shm {
+    volatile uint32_t magic;
+    uint32_t num_qps;
+    uint32_t num_mrs;
+    struct mock_verbs_mr_entry mr[MOCK_VERBS_MAX_MRS];
+    struct mock_verbs_qp_entry qp[MOCK_VERBS_MAX_QPS];
+};
+
+/* local CQ: send completions plus the QPs whose receives land here */
+struct mock_verbs_cq {
+    struct ibv_cq cq;
+    uint32_t head, count, depth;
+    struct mock_verbs_cqe *cqe;
+    GArray *recv_qpns;
+};
+
+int mock_verbs_enabled = 0;
+struct mock_verbs_shm *mock_verbs_shm = NULL;
+struct mock_verbs_params mock_verbs_params;
+struct ibv_device mock_verbs_device[MOCK_VERBS_NUM_DEVICES];
+struct ibv_device *mock_verbs_device_list[MOCK_VERBS_NUM_DEVICES + 1];
+
+/**
+ * mock_verbs_init - select the verbs provider of this process
+ * @verbs_mode: RSEC_VERBS_HW or RSEC_VERBS_MOCK
+ * @params: completion latency of the mock
+ */
+void mock_verbs_init(int verbs_mode, const struct mock_verbs_params *params) {
+    char shm_name[RSEC_MAX_QP_NAME];
+    int i, creator;
+    assert(verbs_mode == RSEC_VERBS_HW || verbs_mode == RSEC_VERBS_MOCK);
+    RSEC_PRINT("VERBS_MODE: %s\n", rsec_verbs_mode_text[verbs_mode]);
+    if (verbs_mode != RSEC_VERBS_MOCK) return;
+#ifndef RSEC_MOCK_VERBS
+    die_printf("[%s] mock verbs are not built in, rebuild with make MOCK=1\n",
+               __func__);
+#endif
+    assert(params->latency_ns >= 0 && params->byte_ns_shift >= 0 &&
+           params->byte_ns_shift <= MOCK_VERBS_MAX_BYTE_NS_SHIFT);
+    memcpy(&mock_verbs_params, params, sizeof(struct mock_verbs_params));
+
+    snprintf(shm_name, RSEC_MAX_QP_NAME, MOCK_VERBS_SHM_STRING,
+             memcached_epoch);
+    mock_verbs_shm = rsec_shm_attach(shm_name, sizeof(struct mock_verbs_shm),
+                                     &creator);
+    if (creator) {
+        for (i = 0; i < MOCK_VERBS_MAX_QPS; i++)
+            pthread_spin_init(&mock_verbs_shm->qp[i].lock,
+                              PTHREAD_PROCESS_SHARED);
+        __sync_synchronize();
+        mock_verbs_shm->magic = MOCK_VERBS_MAGIC;
+    } else {
+        while (mock_verbs_shm->magic != MOCK_VERBS_MAGIC) RSEC_CPU_RELAX();
+    }
+    for (i = 0; i < MOCK_VERBS_NUM_DEVICES; i++) {
+        memset(&mock_verbs_device[i], 0, sizeof(struct ibv_device));
+        snprintf(mock_verbs_device[i].name, IBV_SYSFS_NAME_MAX,
+                 "mock_verbs%d", i);
+        mock_verbs_device_list[i] = &mock_verbs_device[i];
+    }
+    mock_verbs_device_list[MOCK_VERBS_NUM_DEVICES] = NULL;
+    // peers copy from/to our memory with process_vm_readv/writev
+    prctl(PR_SET_PTRACER, PR_SET_PTRACER_ANY, 0, 0, 0);
+    mock_verbs_enabled = 1;
+    RSEC_PRINT("mock verbs %s %s\n", creator ? "create" : "attach", shm_name);
+}
+
+/**
+ * mock_verbs_now - current time in ns
+ */
+static uint64_t mock_verbs_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 * 1000 * 1000 + now.tv_nsec;
+}
+
+/**
+ * mock_verbs_deadline - completion time of a request issued now
+ * @length: payload size
+ */
+static uint64_t mock_verbs_deadline(uint32_t length) {
+    return mock_verbs_now() + mock_verbs_params.latency_ns +
+           (length >> mock_verbs_params.byte_ns_shift);
+}
+
+/**
+ * mock_verbs_copy - copy between local memory and memory of a process
+ * Returns 0 on success.
+ * @pid: process owning the remote memory
+ * @local: local address
+ * @remote: remote address
+ * @length: size
+ * @to_remote: 1 writes local to remote, 0 reads remote to local
+ */
+static int mock_verbs_copy(pid_t pid, void *local, uint64_t remote,
+                           size_t length, int to_remote) {
+    struct iovec local_iov = {.iov_base = local, .iov_len = length};
+    struct iovec remote_iov = {.iov_base = (void *)remote, .iov_len = length};
+    ssize_t ret;
+    if (!length) return 0;
+    if (pid == getpid()) {
+        if (to_remote)
+            memcpy((void *)remote, local, length);
+        else
+            memcpy(local, (void *)remote, length);
+        return 0;
+    }
+    if (to_remote)
+        ret = process_vm_writev(pid, &local_iov, 1, &remote_iov, 1, 0);
+    else
+        ret = process_vm_readv(pid, &local_iov, 1, &remote_iov, 1, 0);
+    return ret != (ssize_t)length;
+}
+
+/**
+ * mock_verbs_qp_entry - get the shared entry of a qpn
+ * @qpn: queue pair number
+ */
+static struct mock_verbs_qp_entry *mock_verbs_qp_entry(uint32_t qpn) {
+    uint32_t index = qpn - MOCK_VERBS_QPN_BASE;
+    if (qpn < MOCK_VERBS_QPN_BASE || index >= mock_verbs_shm->num_qps)
+        return NULL;
+    return &mock_verbs_shm->qp[index];
+}
+
+/**
+ * mock_verbs_push_cqe - queue a send completion on a local CQ
+ * @cq: completion queue
+ * @cqe: completion
+ */
+static void mock_verbs_push_cqe(struct ibv_cq *cq, struct mock_verbs_cqe *cqe) {
+    struct mock_verbs_cq *mock_cq = (struct mock_verbs_cq *)cq;
+    if (mock_cq->count == mock_cq->depth)
+        die_printf("[%s] mock CQ overflow (%d)\n", __func__, mock_cq->depth);
+    memcpy(&mock_cq->cqe[(mock_cq->head + mock_cq->count) % mock_cq->depth],
+           cqe, sizeof(struct mock_verbs_cqe));
+    mock_cq->count++;
+}
+
+/**
+ * mock_verbs_rdma - execute one RDMA READ/WRITE
+ * Returns the completion status.
+ * @wr: work request
+ * @length: return payload size
+ */
+static enum ibv_wc_status mock_verbs_rdma(struct ibv_send_wr *wr,
+                                          uint32_t *length) {
+    uint32_t index = MOCK_VERBS_RKEY_TO_INDEX(wr->wr.rdma.rkey);
+    struct mock_verbs_mr_entry *mr;
+    uint64_t remote = wr->wr.rdma.remote_addr;
+    int to_remote = wr->opcode == IBV_WR_RDMA_WRITE;
+    int i;
+
+    *length = 0;
+    for (i = 0; i < wr->num_sge; i++) *length += wr->sg_list[i].length;
+    if (index >= mock_verbs_shm->num_mrs) return IBV_WC_REM_ACCESS_ERR;
+    mr = &mock_verbs_shm->mr[index];
+    if (wr->wr.rdma.rkey != MOCK_VERBS_RKEY(index, mr->pid))
+        return IBV_WC_REM_ACCESS_ERR;
+    if (remote < mr->addr || remote + *length > mr->addr + mr->length)
+        return IBV_WC_REM_ACCESS_ERR;
+    if (!(mr->access &
+          (to_remote ? IBV_ACCESS_REMOTE_WRITE : IBV_ACCESS_REMOTE_READ)))
+        return IBV_WC_REM_ACCESS_ERR;
+    for (i = 0; i < wr->num_sge; i++) {
+        if (mock_verbs_copy(mr->pid, (void *)wr->sg_list[i].addr, remote,
+                            wr->sg_list[i].length, to_remote))
+            return IBV_WC_REM_OP_ERR;
+        remote += wr->sg_list[i].length;
+    }
+    return IBV_WC_SUCCESS;
+}
+
+/**
+ * mock_verbs_send - execute one SEND into a receive of the destination QP
+ * Returns the completion status.
+ * @qp: local queue pair
+ * @wr: work request
+ * @length: return payload size
+ */
+static enum ibv_wc_status mock_verbs_send(struct ibv_qp *qp,
+                                          struct ibv_send_wr *wr,
+                                          uint32_t *length) {
+    struct mock_verbs_qp_entry *local = mock_verbs_qp_entry(qp->qp_num);
+    struct mock_verbs_qp_entry *dest;
+    struct mock_verbs_recv *recv;
+    struct mock_verbs_cqe *cqe;
+    uint32_t offset = 0;
+    int i, ud = qp->qp_type == IBV_QPT_UD;
+
+    *length = 0;
+    for (i = 0; i < wr->num_sge; i++) *length += wr->sg_list[i].length;
+    dest = mock_verbs_qp_entry(ud ? wr->wr.ud.remote_qpn : local->dest_qpn);
+    if (dest == NULL || dest->state < IBV_QPS_RTR)
+        return ud ? IBV_WC_SUCCESS : IBV_WC_RETRY_EXC_ERR;
+
+    pthread_spin_lock(&dest->lock);
+    if (dest->recv_count == 0 || dest->cqe_count == RSEC_CQ_DEPTH) {
+        pthread_spin_unlock(&dest->lock);
+        // UD silently drops, RC runs out of RNR retries
+        return ud ? IBV_WC_SUCCESS : IBV_WC_RNR_RETRY_EXC_ERR;
+    }
+    recv = &dest->recv[dest->recv_head];
+    dest->recv_head = (dest->recv_head + 1) % RSEC_CQ_DEPTH;
+    dest->recv_count--;
+    if (ud) offset = MOCK_VERBS_UD_GRH_SIZE;
+    cqe = &dest->cqe[(dest->cqe_head + dest->cqe_count) % RSEC_CQ_DEPTH];
+    memset(cqe, 0, sizeof(struct mock_verbs_cqe));
+    cqe->wr_id = recv->wr_id;
+    cqe->opcode = IBV_WC_RECV;
+    cqe->qp_num = dest - mock_verbs_shm->qp + MOCK_VERBS_QPN_BASE;
+    cqe->src_qp = qp->qp_num;
+    cqe->byte_len = *length + offset;
+    cqe->status = IBV_WC_SUCCESS;
+    if (*length + offset > recv->length) {
+        cqe->status = IBV_WC_LOC_LEN_ERR;
+    } else {
+        for (i = 0; i < wr->num_sge; i++) {
+            if (mock_verbs_copy(dest->pid, (void *)wr->sg_list[i].addr,
+                                recv->addr + offset, wr->sg_list[i].length,
+                                1)) {
+                cqe->status = IBV_WC_LOC_PROT_ERR;
+                break;
+            }
+            offset += wr->sg_list[i].length;
+        }
+    }
+    cqe->deadline = mock_verbs_deadline(*length);
+    __sync_synchronize();
+    dest->cqe_count++;
+    pthread_spin_unlock(&dest->lock);
+    return IBV_WC_SUCCESS;
+}
+
+struct ibv_device **mock_ibv_get_device_list(int *num_devices) {
+    if (!mock_verbs_enabled) return ibv_get_device_list(num_devices);
+    if (num_devices) *num_devices = MOCK_VERBS_NUM_DEVICES;
+    return mock_verbs_device_list;
+}
+
+const char *mock_ibv_get_device_name(struct ibv_device *device) {
+    if (!mock_verbs_enabled) return ibv_get_device_name(device);
+    return device->name;
+}
+
+struct ibv_context *mock_ibv_open_device(struct ibv_device *device) {
+    struct ibv_context *context;
+    if (!mock_verbs_enabled) return ibv_open_device(device);
+    context = calloc(1, sizeof(struct ibv_context));
+    assert(context);
+    context->device = device;
+    return context;
+}
+
+int mock_ibv_query_device(struct ibv_context *context,
+                          struct ibv_device_attr *device_attr) {
+    if (!mock_verbs_enabled) return ibv_query_device(context, device_attr);
+    memset(device_attr, 0, sizeof(struct ibv_device_attr));
+    device_attr->phys_port_cnt = 2;
+    device_attr->max_qp = MOCK_VERBS_MAX_QPS;
+    device_attr->max_qp_wr = RSEC_CQ_DEPTH;
+    device_attr->max_sge = RSEC_QP_MAX_SGE;
+    device_attr->max_cq = MOCK_VERBS_MAX_QPS * 2;
+    device_attr->max_cqe = RSEC_CQ_DEPTH * 16;
+    device_attr->max_mr = MOCK_VERBS_MAX_MRS;
+    return 0;
+}
+
+int mock_ibv_query_port(struct ibv_context *context, uint8_t port_num,
+                        struct ibv_port_attr *port_attr) {
+    if (!mock_verbs_enabled)
+        return ibv_query_port(context, port_num, port_attr);
+    memset(port_attr, 0, sizeof(struct ibv_port_attr));
+    port_attr->state = IBV_PORT_ACTIVE;
+    port_attr->max_mtu = IBV_MTU_4096;
+    port_attr->active_mtu = IBV_MTU_4096;
+    port_attr->lid = getpid() & 0xffff;
+    port_attr->link_layer = IBV_LINK_LAYER_INFINIBAND;
+    return 0;
+}
+
+int mock_ibv_query_gid(struct ibv_context *context, uint8_t port_num,
+                       int index, union ibv_gid *gid) {
+    if (!mock_verbs_enabled)
+        return ibv_query_gid(context, port_num, index, gid);
+    memset(gid, 0, sizeof(union ibv_gid));
+    gid->global.subnet_prefix = 0xfe80;
+    gid->global.interface_id = getpid();
+    return 0;
+}
+
+struct ibv_pd *mock_ibv_alloc_pd(struct ibv_context *context) {
+    struct ibv_pd *pd;
+    if (!mock_verbs_enabled) return ibv_alloc_pd(context);
+    pd = calloc(1, sizeof(struct ibv_pd));
+    assert(pd);
+    pd->context = context;
+    return pd;
+}
+
+struct ibv_mr *mock_ibv_reg_mr(struct ibv_pd *pd, void *addr, size_t length,
+                               int access) {
+    struct mock_verbs_mr_entry *entry;
+    struct ibv_mr *mr;
+    uint32_t index;
+    if (!mock_verbs_enabled) return ibv_reg_mr(pd, addr, length, access);
+    index = __sync_fetch_and_add(&mock_verbs_shm->num_mrs, 1);
+    if (index >= MOCK_VERBS_MAX_MRS)
+        die_printf("[%s] too many MRs (%d)\n", __func__, MOCK_VERBS_MAX_MRS);
+    entry = &mock_verbs_shm->mr[index];
+    entry->pid = getpid();
+    entry->access = access;
+    entry->addr = (uintptr_t)addr;
+    entry->length = length;
+
+    mr = calloc(1, sizeof(struct ibv_mr));
+    assert(mr);
+    mr->context = pd->context;
+    mr->pd = pd;
+    mr->addr = addr;
+    mr->length = length;
+    mr->handle = index;
+    mr->lkey = mr->rkey = MOCK_VERBS_RKEY(index, entry->pid);
+    return mr;
+}
+
+struct ibv_cq *mock_ibv_create_cq(struct ibv_context *context, int cqe,
+                                  void *cq_context,
+                                  struct ibv_comp_channel *channel,
+                                  int comp_vector) {
+    struct mock_verbs_cq *mock_cq;
+    if (!mock_verbs_enabled)
+        return ibv_create_cq(context, cqe, cq_context, channel, comp_vector);
+    mock_cq = calloc(1, sizeof(struct mock_verbs_cq));
+    assert(mock_cq);
+    mock_cq->cq.context = context;
+    mock_cq->cq.cq_context = cq_context;
+    mock_cq->cq.cqe = cqe;
+    mock_cq->depth = cqe;
+    mock_cq->cqe = malloc(sizeof(struct mock_verbs_cqe) * cqe);
+    assert(mock_cq->cqe);
+    mock_cq->recv_qpns = g_array_new(FALSE, FALSE, sizeof(uint32_t));
+    return &mock_cq->cq;
+}
+
+struct ibv_qp *mock_ibv_create_qp(struct ibv_pd *pd,
+                                  struct ibv_qp_init_attr *qp_init_attr) {
+    struct mock_verbs_qp_entry *entry;
+    struct mock_verbs_cq *recv_cq;
+    struct ibv_qp *qp;
+    uint32_t index;
+    if (!mock_verbs_enabled) return ibv_create_qp(pd, qp_init_attr);
+    index = __sync_fetch_and_add(&mock_verbs_shm->num_qps, 1);
+    if (index >= MOCK_VERBS_MAX_QPS)
+        die_printf("[%s] too many QPs (%d)\n", __func__, MOCK_VERBS_MAX_QPS);
+    entry = &mock_verbs_shm->qp[index];
+    entry->pid = getpid();
+    entry->qp_type = qp_init_attr->qp_type;
+    entry->state = IBV_QPS_RESET;
+
+    qp = calloc(1, sizeof(struct ibv_qp));
+    assert(qp);
+    qp->context = pd->context;
+    qp->pd = pd;
+    qp->send_cq = qp_init_attr->send_cq;
+    qp->recv_cq = qp_init_attr->recv_cq;
+    qp->qp_type = qp_init_attr->qp_type;
+    qp->state = IBV_QPS_RESET;
+    qp->qp_num = index + MOCK_VERBS_QPN_BASE;
+    if (qp->recv_cq) {
+        recv_cq = (struct mock_verbs_cq *)qp->recv_cq;
+        g_array_append_val(recv_cq->recv_qpns, qp->qp_num);
+    }
+    return qp;
+}
+
+int mock_ibv_modify_qp(struct ibv_qp *qp, struct ibv_qp_attr *attr,
+                       int attr_mask) {
+    struct mock_verbs_qp_entry *entry;
+    if (!mock_verbs_enabled) return ibv_modify_qp(qp, attr, attr_mask);
+    entry = mock_verbs_qp_entry(qp->qp_num);
+    if (attr_mask & IBV_QP_DEST_QPN) entry->dest_qpn = attr->dest_qp_num;
+    if (attr_mask & IBV_QP_STATE) {
+        __sync_synchronize();
+        entry->state = attr->qp_state;
+        qp->state = attr->qp_state;
+    }
+    return 0;
+}
+
+struct ibv_ah *mock_ibv_create_ah(struct ibv_pd *pd,
+                                  struct ibv_ah_attr *attr) {
+    struct ibv_ah *ah;
+    if (!mock_verbs_enabled) return ibv_create_ah(pd, attr);
+    ah = calloc(1, sizeof(struct ibv_ah));
+    assert(ah);
+    ah->context = pd->context;
+    ah->pd = pd;
+    return ah;
+}
+
+int mock_ibv_post_send(struct ibv_qp *qp, struct ibv_send_wr *wr,
+                       struct ibv_send_wr **bad_wr) {
+    struct mock_verbs_cqe cqe;
+    enum ibv_wc_status status;
+    uint32_t length;
+    if (!mock_verbs_enabled) return ibv_post_send(qp, wr, bad_wr);
+    if (qp->state != IBV_QPS_RTS) {
+        *bad_wr = wr;
+        return EINVAL;
+    }
+    for (; wr; wr = wr->next) {
+        switch (wr->opcode) {
+            case IBV_WR_RDMA_READ:
+            case IBV_WR_RDMA_WRITE:
+                if (qp->qp_type != IBV_QPT_RC) goto bad;
+                status = mock_verbs_rdma(wr, &length);
+                cqe.opcode = wr->opcode == IBV_WR_RDMA_READ
+                                 ? IBV_WC_RDMA_READ
+                                 : IBV_WC_RDMA_WRITE;
+                break;
+            case IBV_WR_SEND:
+                status = mock_verbs_send(qp, wr, &length);
+                cqe.opcode = IBV_WC_SEND;
+                break;
+            default:
+                goto bad;
+        }
+        if (!(wr->send_flags & IBV_SEND_SIGNALED) && status == IBV_WC_SUCCESS)
+            continue;
+        cqe.wr_id = wr->wr_id;
+        cqe.deadline = mock_verbs_deadline(length);
+        cqe.byte_len = length;
+        cqe.qp_num = qp->qp_num;
+        cqe.src_qp = 0;
+        cqe.status = status;
+        mock_verbs_push_cqe(qp->send_cq, &cqe);
+    }
+    return 0;
+bad:
+    *bad_wr = wr;
+    return EINVAL;
+}
+
+int mock_ibv_post_recv(struct ibv_qp *qp, struct ibv_recv_wr *wr,
+                       struct ibv_recv_wr **bad_wr) {
+    struct mock_verbs_qp_entry *entry;
+    struct mock_verbs_recv *recv;
+    if (!mock_verbs_enabled) return ibv_post_recv(qp, wr, bad_wr);
+    entry = mock_verbs_qp_entry(qp->qp_num);
+    pthread_spin_lock(&entry->lock);
+    for (; wr; wr = wr->next) {
+        if (entry->recv_count == RSEC_CQ_DEPTH || wr->num_sge != 1) {
+            pthread_spin_unlock(&entry->lock);
+            *bad_wr = wr;
+            return ENOMEM;
+        }
+        recv = &entry->recv[(entry->recv_head + entry->recv_count) %
+                            RSEC_CQ_DEPTH];
+        recv->wr_id = wr->wr_id;
+        recv->addr = wr->sg_list[0].addr;
+        recv->length = wr->sg_list[0].length;
+        entry->recv_count++;
+    }
+    pthread_spin_unlock(&entry->lock);
+    return 0;
+}
+
+/**
+ * mock_verbs_fill_wc - translate a due completion into a work completion
+ * @wc: return work completion
+ * @cqe: completion
+ */
+static void mock_verbs_fill_wc(struct ibv_wc *wc, struct mock_verbs_cqe *cqe) {
+    memset(wc, 0, sizeof(struct ibv_wc));
+    wc->wr_id = cqe->wr_id;
+    wc->status = cqe->status;
+    wc->opcode = cqe->opcode;
+    wc->byte_len = cqe->byte_len;
+    wc->qp_num = cqe->qp_num;
+    wc->src_qp = cqe->src_qp;
+}
+
+int mock_ibv_poll_cq(struct ibv_cq *cq, int num_entries, struct ibv_wc *wc) {
+    struct mock_verbs_cq *mock_cq = (struct mock_verbs_cq *)cq;
+    struct mock_verbs_qp_entry *entry;
+    struct mock_verbs_cqe *cqe;
+    uint64_t now;
+    int i, comps = 0;
+    if (!mock_verbs_enabled) return ibv_poll_cq(cq, num_entries, wc);
+    now = mock_verbs_now();
+    while (comps < num_entries && mock_cq->count) {
+        cqe = &mock_cq->cqe[mock_cq->head];
+        if (cqe->deadline > now) break;
+        mock_verbs_fill_wc(&wc[comps++], cqe);
+        mock_cq->head = (mock_cq->head + 1) % mock_cq->depth;
+        mock_cq->count--;
+    }
+    for (i = 0; i < mock_cq->recv_qpns->len && comps < num_entries; i++) {
+        entry = mock_verbs_qp_entry(
+            g_array_index(mock_cq->recv_qpns, uint32_t, i));
+        if (!entry->cqe_count) continue;
+        pthread_spin_lock(&entry->lock);
+        while (comps < num_entries && entry->cqe_count) {
+            cqe = &entry->cqe[entry->cqe_head];
+            if (cqe->deadline > now) break;
+            mock_verbs_fill_wc(&wc[comps++], cqe);
+            entry->cqe_head = (entry->cqe_head + 1) % RSEC_CQ_DEPTH;
+            entry->cqe_count--;
+        }
+        pthread_spin_unlock(&entry->lock);
+    }
+    return comps;
+}
+
+struct ibv_cq_ex *mock_ibv_create_cq_ex(struct ibv_context *context,
+                                        struct ibv_cq_init_attr_ex *cq_attr) {
+    if (!mock_verbs_enabled) return ibv_create_cq_ex(context, cq_attr);
+    errno = EOPNOTSUPP;
+    return NULL;
+}
+
+int mock_ibv_query_device_ex(struct ibv_context *context,
+                             const struct ibv_query_device_ex_input *input,
+                             struct ibv_device_attr_ex *attr) {
+    if (!mock_verbs_enabled)
+        return ibv_query_device_ex(context, input, attr);
+    memset(attr, 0, sizeof(struct ibv_device_attr_ex));
+    return mock_ibv_query_device(context, &attr->orig_attr);
+}
+
+int mock_ibv_query_rt_values_ex(struct ibv_context *context,
+                                struct ibv_values_ex *values) {
+    if (!mock_verbs_enabled) return ibv_query_rt_values_ex(context, values);
+    return EOPNOTSUPP;
+}
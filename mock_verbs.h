@@ -0,0 +1,117 @@
+#ifndef RSEC_MOCK_VERBS_HEADER
+#define RSEC_MOCK_VERBS_HEADER
+
+#include <infiniband/verbs.h>
+
+/**
+ * mock_verbs.h: verbs layer for running all roles as processes on one host.
+ * Build with `make MOCK=1` (RSEC_MOCK_VERBS) to route the verbs used by this
+ * program through mock_verbs.c, then select the provider at run time with
+ * -V (RSEC_VERBS_HW forwards every call to libibverbs, RSEC_VERBS_MOCK uses
+ * the mock). QPs and MRs of all processes live in one shared memory segment;
+ * RDMA READ/WRITE and SEND copy data with process_vm_readv/writev and every
+ * completion shows up after the latency of struct mock_verbs_params (the
+ * mock_* options of rsec_config, MOCK_VERBS_DEFAULT_* by default).
+ */
+
+#define RSEC_VERBS_HW 1
+#define RSEC_VERBS_MOCK 2
+static const char *const rsec_verbs_mode_text[] = {
+    "------RSEC STRING------", "RSEC_VERBS_HW", "RSEC_VERBS_MOCK"};
+
+#define MOCK_VERBS_SHM_STRING "/rsec-mock-verbs-%u"
+#define MOCK_VERBS_NUM_DEVICES 4
+#define MOCK_VERBS_MAX_QPS 4096
+#define MOCK_VERBS_MAX_MRS (1 << 16)
+#define MOCK_VERBS_QPN_BASE 0x100
+#define MOCK_VERBS_UD_GRH_SIZE 40
+// completion latency (ns): base + 1ns per (1 << BYTE_NS_SHIFT) bytes
+#define MOCK_VERBS_DEFAULT_LATENCY_NS 2000
+#define MOCK_VERBS_DEFAULT_BYTE_NS_SHIFT 4
+#define MOCK_VERBS_MAX_BYTE_NS_SHIFT 31
+
+struct mock_verbs_params {
+    int latency_ns;
+    int byte_ns_shift;
+};
+
+extern int mock_verbs_enabled;
+
+void mock_verbs_init(int verbs_mode, const struct mock_verbs_params *params);
+
+struct ibv_device **mock_ibv_get_device_list(int *num_devices);
+const char *mock_ibv_get_device_name(struct ibv_device *device);
+struct ibv_context *mock_ibv_open_device(struct ibv_device *device);
+int mock_ibv_query_device(struct ibv_context *context,
+                          struct ibv_device_attr *device_attr);
+int mock_ibv_query_port(struct ibv_context *context, uint8_t port_num,
+                        struct ibv_port_attr *port_attr);
+int mock_ibv_query_gid(struct ibv_context *context, uint8_t port_num,
+                       int index, union ibv_gid *gid);
+struct ibv_pd *mock_ibv_alloc_pd(struct ibv_context *context);
+struct ibv_mr *mock_ibv_reg_mr(struct ibv_pd *pd, void *addr, size_t length,
+                               int access);
+struct ibv_cq *mock_ibv_create_cq(struct ibv_context *context, int cqe,
+                                  void *cq_context,
+                                  struct ibv_comp_channel *channel,
+                                  int comp_vector);
+struct ibv_qp *mock_ibv_create_qp(struct ibv_pd *pd,
+                                  struct ibv_qp_init_attr *qp_init_attr);
+int mock_ibv_modify_qp(struct ibv_qp *qp, struct ibv_qp_attr *attr,
+                       int attr_mask);
+struct ibv_ah *mock_ibv_create_ah(struct ibv_pd *pd,
+                                  struct ibv_ah_attr *attr);
+int mock_ibv_post_send(struct ibv_qp *qp, struct ibv_send_wr *wr,
+                       struct ibv_send_wr **bad_wr);
+int mock_ibv_post_recv(struct ibv_qp *qp, struct ibv_recv_wr *wr,
+                       struct ibv_recv_wr **bad_wr);
+int mock_ibv_poll_cq(struct ibv_cq *cq, int num_entries, struct ibv_wc *wc);
+// extended verbs are not emulated: callers fall back to the regular ones
+struct ibv_cq_ex *mock_ibv_create_cq_ex(struct ibv_context *context,
+                                        struct ibv_cq_init_attr_ex *cq_attr);
+int mock_ibv_query_device_ex(struct ibv_context *context,
+                             const struct ibv_query_device_ex_input *input,
+                             struct ibv_device_attr_ex *attr);
+int mock_ibv_query_rt_values_ex(struct ibv_context *context,
+                                struct ibv_values_ex *values);
+
+#if defined(RSEC_MOCK_VERBS) && !defined(RSEC_MOCK_VERBS_IMPL)
+#undef ibv_get_device_list
+#undef ibv_get_device_name
+#undef ibv_open_device
+#undef ibv_query_device
+#undef ibv_query_port
+#undef ibv_query_gid
+#undef ibv_alloc_pd
+#undef ibv_reg_mr
+#undef ibv_create_cq
+#undef ibv_create_qp
+#undef ibv_modify_qp
+#undef ibv_create_ah
+#undef ibv_post_send
+#undef ibv_post_recv
+#undef ibv_poll_cq
+#undef ibv_create_cq_ex
+#undef ibv_query_device_ex
+#undef ibv_query_rt_values_ex
+#define ibv_get_device_list mock_ibv_get_device_list
+#define ibv_get_device_name mock_ibv_get_device_name
+#define ibv_open_device mock_ibv_open_device
+#define ibv_query_device mock_ibv_query_device
+#define ibv_query_port mock_ibv_query_port
+#define ibv_query_gid mock_ibv_query_gid
+#define ibv_alloc_pd mock_ibv_alloc_pd
+#define ibv_reg_mr mock_ibv_reg_mr
+#define ibv_create_cq mock_ibv_create_cq
+#define ibv_create_qp mock_ibv_create_qp
+#define ibv_modify_qp mock_ibv_modify_qp
+#define ibv_create_ah mock_ibv_create_ah
+#define ibv_post_send mock_ibv_post_send
+#define ibv_post_recv mock_ibv_post_recv
+#define ibv_poll_cq mock_ibv_poll_cq
+#define ibv_create_cq_ex mock_ibv_create_cq_ex
+#define ibv_query_device_ex mock_ibv_query_device_ex
+#define ibv_query_rt_values_ex mock_ibv_query_rt_values_ex
+#endif
+
+#endif
@@ -0,0 +1,255 @@
+#include "memcached.h"
+
+/**
+ * registry_shm.c: registry backend for roles co-located on one host.
+ * The registry is a POSIX shared memory segment (one per run epoch) holding an
+ * open-addressing hash table with linear probing. Small values are stored in
+ * the slot itself, larger ones (e.g., packed QP records) in a bump-allocated
+ * heap behind the table. A process-shared mutex protects the whole segment;
+ * every operation is a handful of memory accesses, so rendezvous takes well
+ * below a microsecond and no external service is needed.
+ */
+
+#define RSEC_REGISTRY_SHM_MAGIC 0x52534543u
+#define RSEC_REGISTRY_SHM_EMPTY 0
+#define RSEC_REGISTRY_SHM_USED 1
+
+struct registry_shm_slot {
+    uint32_t state;
+    uint32_t hash;
+    int len;
+    int capacity;      /* heap space owned by this slot, 0 if inline */
+    uint64_t offset;   /* heap offset of the value if not inline */
+    time_t expire;     /* absolute expiration, 0 means never */
+    char key[RSEC_MEMCACHED_MAX_KEY];
+    char value[RSEC_REGISTRY_SHM_INLINE_SIZE];
+};
+
+struct registry_shm_header {
+    volatile uint32_t magic;
+    pthread_mutex_t lock;
+    uint64_t num_slots;
+    uint64_t heap_used;
+    uint64_t heap_size;
+};
+
+struct registry_shm_header *registry_shm = NULL;
+struct registry_shm_slot *registry_shm_slots;
+char *registry_shm_heap;
+
+/**
+ * registry_shm_open - create or attach the registry segment of this epoch
+ * The creator initializes the table and publishes the magic number last, so
+ * other processes only use the segment after it is ready.
+ */
+static void registry_shm_open(void) {
+    char shm_name[RSEC_MAX_QP_NAME];
+    size_t table_size = sizeof(struct registry_shm_header) +
+                        sizeof(struct registry_shm_slot) *
+                            RSEC_REGISTRY_SHM_SLOTS;
+    size_t total_size = table_size + RSEC_REGISTRY_SHM_HEAP_SIZE;
+    pthread_mutexattr_t attr;
+    void *segment;
+    int creator;
+    assert((RSEC_REGISTRY_SHM_SLOTS & (RSEC_REGISTRY_SHM_SLOTS - 1)) == 0);
+
+    snprintf(shm_name, RSEC_MAX_QP_NAME, RSEC_REGISTRY_SHM_STRING,
+             memcached_epoch);
+    segment = rsec_shm_attach(shm_name, total_size, &creator);
+
+    registry_shm_slots = (struct registry_shm_slot
+                              *)((char *)segment +
+                                 sizeof(struct registry_shm_header));
+    registry_shm_heap = (char *)segment + table_size;
+    if (creator) {
+        struct registry_shm_header *header = segment;
+        // ftruncate already zeroed the table, i.e., every slot is empty
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutex_init(&header->lock, &attr);
+        pthread_mutexattr_destroy(&attr);
+        header->num_slots = RSEC_REGISTRY_SHM_SLOTS;
+        header->heap_used = 0;
+        header->heap_size = RSEC_REGISTRY_SHM_HEAP_SIZE;
+        __sync_synchronize();
+        header->magic = RSEC_REGISTRY_SHM_MAGIC;
+    } else {
+        struct registry_shm_header *header = segment;
+        while (header->magic != RSEC_REGISTRY_SHM_MAGIC) RSEC_CPU_RELAX();
+        __sync_synchronize();
+    }
+    registry_shm = segment;
+    RSEC_PRINT("registry: %s %s\n", creator ? "create" : "attach", shm_name);
+}
+
+/**
+ * registry_shm_lookup - find the slot of a key (lock must be held)
+ * Returns the slot holding @key, or the empty slot where it would go.
+ * @key: key
+ * @hash: hash of key
+ */
+static struct registry_shm_slot *registry_shm_lookup(const char *key,
+                                                     uint32_t hash) {
+    uint64_t mask = registry_shm->num_slots - 1;
+    uint64_t i = hash & mask, probe;
+    struct registry_shm_slot *slot;
+    for (probe = 0; probe < registry_shm->num_slots; probe++) {
+        slot = &registry_shm_slots[(i + probe) & mask];
+        if (slot->state == RSEC_REGISTRY_SHM_EMPTY) return slot;
+        if (slot->hash == hash && !strcmp(slot->key, key)) return slot;
+    }
+    die_printf("[%s] registry is full (%d slots)\n", __func__,
+               RSEC_REGISTRY_SHM_SLOTS);
+    return NULL;
+}
+
+/**
+ * registry_shm_remove - delete a used slot with backward-shift deletion so
+ * that no tombstone is needed (lock must be held)
+ * @slot: slot to delete
+ */
+static void registry_shm_remove(struct registry_shm_slot *slot) {
+    uint64_t mask = registry_shm->num_slots - 1;
+    uint64_t hole = slot - registry_shm_slots, next, home;
+    struct registry_shm_slot *entry;
+    next = hole;
+    while (1) {
+        next = (next + 1) & mask;
+        entry = &registry_shm_slots[next];
+        if (entry->state == RSEC_REGISTRY_SHM_EMPTY) break;
+        home = entry->hash & mask;
+        // entry can fill the hole only if its home is not in (hole, next]
+        if (((next - home) & mask) < ((next - hole) & mask)) continue;
+        memcpy(&registry_shm_slots[hole], entry,
+               sizeof(struct registry_shm_slot));
+        hole = next;
+    }
+    registry_shm_slots[hole].state = RSEC_REGISTRY_SHM_EMPTY;
+}
+
+/**
+ * registry_shm_value - get the value storage of a slot
+ * @slot: slot
+ */
+static char *registry_shm_value(struct registry_shm_slot *slot) {
+    if (slot->len <= RSEC_REGISTRY_SHM_INLINE_SIZE) return slot->value;
+    return registry_shm_heap + slot->offset;
+}
+
+/**
+ * registry_shm_expired - check whether a used slot has expired
+ * @slot: slot
+ */
+static int registry_shm_expired(struct registry_shm_slot *slot) {
+    return slot->expire && slot->expire <= time(NULL);
+}
+
+static void registry_shm_set(const char *key, const void *value, int len,
+                             int expiration) {
+    uint32_t hash = rsec_fnv1a(key, strlen(key));
+    struct registry_shm_slot *slot;
+    if (registry_shm == NULL) registry_shm_open();
+    assert(strlen(key) < RSEC_MEMCACHED_MAX_KEY);
+
+    pthread_mutex_lock(&registry_shm->lock);
+    slot = registry_shm_lookup(key, hash);
+    if (slot->state == RSEC_REGISTRY_SHM_EMPTY) {
+        slot->state = RSEC_REGISTRY_SHM_USED;
+        slot->hash = hash;
+        slot->capacity = 0;
+        strcpy(slot->key, key);
+    }
+    if (len > RSEC_REGISTRY_SHM_INLINE_SIZE && len > slot->capacity) {
+        // heap space of a smaller old value is not reclaimed
+        if (registry_shm->heap_used + len > registry_shm->heap_size)
+            die_printf("[%s] registry heap is full (%d bytes)\n", __func__,
+                       RSEC_REGISTRY_SHM_HEAP_SIZE);
+        slot->offset = registry_shm->heap_used;
+        slot->capacity = len;
+        registry_shm->heap_used += (len + 7) & ~7;
+    }
+    slot->len = len;
+    slot->expire = expiration ? time(NULL) + expiration : 0;
+    memcpy(registry_shm_value(slot), value, len);
+    pthread_mutex_unlock(&registry_shm->lock);
+}
+
+static int registry_shm_get(const char *key, void **value) {
+    uint32_t hash = rsec_fnv1a(key, strlen(key));
+    struct registry_shm_slot *slot;
+    int len = -1;
+    if (registry_shm == NULL) registry_shm_open();
+
+    *value = NULL;
+    pthread_mutex_lock(&registry_shm->lock);
+    slot = registry_shm_lookup(key, hash);
+    if (slot->state == RSEC_REGISTRY_SHM_USED) {
+        if (registry_shm_expired(slot)) {
+            registry_shm_remove(slot);
+        } else {
+            len = slot->len;
+            *value = malloc(len);
+            assert(*value);
+            memcpy(*value, registry_shm_value(slot), len);
+        }
+    }
+    pthread_mutex_unlock(&registry_shm->lock);
+    return len;
+}
+
+static int registry_shm_get_into(const char *key, void *buf, int size) {
+    uint32_t hash = rsec_fnv1a(key, strlen(key));
+    struct registry_shm_slot *slot;
+    int len = -1;
+    if (registry_shm == NULL) registry_shm_open();
+
+    pthread_mutex_lock(&registry_shm->lock);
+    slot = registry_shm_lookup(key, hash);
+    if (slot->state == RSEC_REGISTRY_SHM_USED) {
+        if (registry_shm_expired(slot)) {
+            registry_shm_remove(slot);
+        } else {
+            len = slot->len;
+            if (len <= size) memcpy(buf, registry_shm_value(slot), len);
+        }
+    }
+    pthread_mutex_unlock(&registry_shm->lock);
+    if (len > size)
+        die_printf("[%s] value of %s is %d bytes (buffer %d)\n", __func__,
+                   key, len, size);
+    return len;
+}
+
+static int registry_shm_mget(const char *const *keys, int num_keys,
+                             void **values, int *lengths) {
+    int i, len, found = 0;
+    for (i = 0; i < num_keys; i++) {
+        len = registry_shm_get(keys[i], &values[i]);
+        if (lengths) lengths[i] = len;
+        if (values[i]) found++;
+    }
+    return found;
+}
+
+static void registry_shm_delete(const char *const *keys, int num_keys) {
+    struct registry_shm_slot *slot;
+    int i;
+    if (registry_shm == NULL) registry_shm_open();
+
+    pthread_mutex_lock(&registry_shm->lock);
+    for (i = 0; i < num_keys; i++) {
+        slot = registry_shm_lookup(keys[i],
+                                   rsec_fnv1a(keys[i], strlen(keys[i])));
+        if (slot->state == RSEC_REGISTRY_SHM_USED) registry_shm_remove(slot);
+    }
+    pthread_mutex_unlock(&registry_shm->lock);
+}
+
+const struct registry_backend registry_shm_backend = {
+    .name = "shm",
+    .set = registry_shm_set,
+    .get = registry_shm_get,
+    .get_into = registry_shm_get_into,
+    .mget = registry_shm_mget,
+    .delete = registry_shm_delete,
+};
@@ -0,0 +1,269 @@
+#include "rsec.h"
+#include "rnic_sim.h"
+
+/**
+ * rnic_sim.c: this code models the translation caches of the RNIC.
+ * 1. MPT cache - one entry per memory region (rkey)
+ * 2. MTT cache - one entry per translated page, the set is selected by
+ *    RSEC_CACHE_SET_MASK like on the real device
+ * Both caches are set-associative with LRU replacement and share one entry
+ * array in the segment (MTT sets first). The jitter comes from
+ * a per-thread generator seeded at init, so a run is reproduced exactly with
+ * the same seed and the same request sequence.
+ */
+
+#define RNIC_SIM_MAGIC 0x534e4943u
+
+struct rnic_sim_entry {
+    uint64_t tag; /* 0 means invalid */
+    uint64_t last_use;
+};
+
+struct rnic_sim_cache {
+    volatile uint32_t magic;
+    pthread_mutex_t lock;
+    uint64_t clock;
+    /* parameters of the creator, checked by the other processes */
+    struct rnic_sim_params params;
+    struct rnic_sim_entry entry[];
+};
+
+/* a completion which becomes visible at deadline */
+struct rnic_sim_completion {
+    uint64_t wr_id;
+    enum ibv_wc_opcode opcode;
+    uint32_t byte_len;
+    uint32_t qp_num;
+    uint64_t deadline;
+};
+
+/* pending completions of one CQ (a ring of RSEC_CQ_DEPTH entries) */
+struct rnic_sim_cq {
+    struct rnic_sim_completion comp[RSEC_CQ_DEPTH];
+    int head;
+    int count;
+};
+
+int rnic_sim_enabled = 0;
+struct rnic_sim_cache *rnic_sim_cache = NULL;
+struct rnic_sim_params rnic_sim_params;
+/* first way of set 0 of each cache */
+struct rnic_sim_entry *rnic_sim_mtt, *rnic_sim_mpt;
+unsigned int rnic_sim_seed;
+/* per-thread generator state and time at which the modeled NIC is idle */
+__thread uint64_t rnic_sim_rand_state = 0;
+__thread uint64_t rnic_sim_busy_until = 0;
+/* per-thread pending completions - cq -> struct rnic_sim_cq */
+__thread GHashTable *rnic_sim_pending = NULL;
+
+/**
+ * rnic_sim_init - select the data path of the userspace_one_* helpers
+ * @data_path: RSEC_DATA_PATH_VERBS or RSEC_DATA_PATH_SIM
+ * @seed: jitter seed
+ * @params: latencies and cache geometry
+ */
+void rnic_sim_init(int data_path, unsigned int seed,
+                   const struct rnic_sim_params *params) {
+    char shm_name[RSEC_MAX_QP_NAME];
+    pthread_mutexattr_t attr;
+    size_t num_entries;
+    int creator;
+    assert(data_path == RSEC_DATA_PATH_VERBS ||
+           data_path == RSEC_DATA_PATH_SIM);
+    RSEC_PRINT("DATA_PATH: %s\n", rsec_data_path_text[data_path]);
+    if (data_path != RSEC_DATA_PATH_SIM) return;
+
+    assert(params->mtt_sets >= 1 && params->mtt_ways >= 1 &&
+           params->mpt_sets >= 1 && params->mpt_ways >= 1 &&
+           params->jitter_ns >= 1);
+    memcpy(&rnic_sim_params, params, sizeof(struct rnic_sim_params));
+    num_entries = (size_t)params->mtt_sets * params->mtt_ways +
+                  (size_t)params->mpt_sets * params->mpt_ways;
+    snprintf(shm_name, RSEC_MAX_QP_NAME, RNIC_SIM_SHM_STRING, memcached_epoch);
+    rnic_sim_cache = rsec_shm_attach(
+        shm_name,
+        sizeof(struct rnic_sim_cache) +
+            num_entries * sizeof(struct rnic_sim_entry),
+        &creator);
+    if (creator) {
+        memcpy(&rnic_sim_cache->params, params, sizeof(struct rnic_sim_params));
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutex_init(&rnic_sim_cache->lock, &attr);
+        pthread_mutexattr_destroy(&attr);
+        __sync_synchronize();
+        rnic_sim_cache->magic = RNIC_SIM_MAGIC;
+    } else {
+        while (rnic_sim_cache->magic != RNIC_SIM_MAGIC) RSEC_CPU_RELAX();
+        if (memcmp(&rnic_sim_cache->params, params,
+                   sizeof(struct rnic_sim_params)))
+            die_printf("[%s] %s uses other sim_* parameters\n", __func__,
+                       shm_name);
+    }
+    rnic_sim_mtt = rnic_sim_cache->entry;
+    rnic_sim_mpt = rnic_sim_mtt + (size_t)params->mtt_sets * params->mtt_ways;
+    rnic_sim_seed = seed;
+    rnic_sim_enabled = 1;
+    RSEC_PRINT("rnic sim %s: MTT %dx%d MPT %dx%d latency %d+%d/%d ns seed %u\n",
+               creator ? "create" : "attach", params->mtt_sets,
+               params->mtt_ways, params->mpt_sets, params->mpt_ways,
+               params->base_ns, params->mtt_miss_ns, params->mpt_miss_ns,
+               seed);
+}
+
+/**
+ * rnic_sim_now - current time in ns
+ */
+static uint64_t rnic_sim_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 * 1000 * 1000 + now.tv_nsec;
+}
+
+/**
+ * rnic_sim_jitter - next jitter value of this thread (xorshift64)
+ */
+static uint64_t rnic_sim_jitter(void) {
+    uint64_t x = rnic_sim_rand_state;
+    if (!x) x = ((uint64_t)rnic_sim_seed << 32) ^ RNIC_SIM_SEED ^ 1;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    rnic_sim_rand_state = x;
+    return x % rnic_sim_params.jitter_ns;
+}
+
+/**
+ * rnic_sim_lookup - look up one set (lock must be held)
+ * Returns 1 on hit. On miss, the entry is installed over the LRU way.
+ * @set: ways of the set
+ * @num_ways: associativity
+ * @tag: tag (non-zero)
+ */
+static int rnic_sim_lookup(struct rnic_sim_entry *set, int num_ways,
+                           uint64_t tag) {
+    int i, victim = 0;
+    uint64_t now = ++rnic_sim_cache->clock;
+    for (i = 0; i < num_ways; i++) {
+        if (set[i].tag == tag) {
+            set[i].last_use = now;
+            return 1;
+        }
+        if (set[i].last_use < set[victim].last_use) victim = i;
+    }
+    set[victim].tag = tag;
+    set[victim].last_use = now;
+    return 0;
+}
+
+/**
+ * rnic_sim_latency - model the latency of one RDMA request
+ * @rkey: remote key
+ * @remote_addr: remote address
+ * @length: request size
+ */
+static uint64_t rnic_sim_latency(uint32_t rkey, uint64_t remote_addr,
+                                 uint32_t length) {
+    struct rnic_sim_params *params = &rnic_sim_params;
+    uint64_t latency = params->base_ns + (length >> RNIC_SIM_BYTE_NS_SHIFT);
+    uint64_t page, last_page, set;
+    int mpt_set = (rkey >> 8) % params->mpt_sets;
+
+    last_page = (remote_addr + RSEC_MAX(length, 1) - 1) >> RNIC_SIM_PAGE_SHIFT;
+    pthread_mutex_lock(&rnic_sim_cache->lock);
+    if (!rnic_sim_lookup(rnic_sim_mpt + mpt_set * params->mpt_ways,
+                         params->mpt_ways, (uint64_t)rkey + 1))
+        latency += params->mpt_miss_ns;
+    for (page = remote_addr >> RNIC_SIM_PAGE_SHIFT; page <= last_page;
+         page++) {
+        set = (((page << RNIC_SIM_PAGE_SHIFT) & RSEC_CACHE_SET_MASK) >>
+               RSEC_CACHE_SET_N_HEIGHT_RIGHT) %
+              params->mtt_sets;
+        if (!rnic_sim_lookup(rnic_sim_mtt + set * params->mtt_ways,
+                             params->mtt_ways,
+                             ((uint64_t)rkey << 40 ^ page) + 1))
+            latency += params->mtt_miss_ns;
+    }
+    pthread_mutex_unlock(&rnic_sim_cache->lock);
+    return latency + rnic_sim_jitter();
+}
+
+/**
+ * rnic_sim_post_send - simulated ibv_post_send for RDMA READ/WRITE chains
+ * Requests of this thread are served one after another; a signaled request
+ * queues a completion on the send CQ of @qp.
+ * @qp: queue pair
+ * @wr: work request chain
+ */
+int rnic_sim_post_send(struct ibv_qp *qp, struct ibv_send_wr *wr) {
+    struct rnic_sim_completion *comp;
+    struct rnic_sim_cq *pending;
+    uint32_t length;
+    int i;
+    if (rnic_sim_pending == NULL)
+        rnic_sim_pending = g_hash_table_new(g_direct_hash, g_direct_equal);
+    pending = g_hash_table_lookup(rnic_sim_pending, qp->send_cq);
+    if (pending == NULL) {
+        pending = malloc(sizeof(struct rnic_sim_cq));
+        assert(pending);
+        pending->head = pending->count = 0;
+        g_hash_table_insert(rnic_sim_pending, qp->send_cq, pending);
+    }
+
+    rnic_sim_busy_until = RSEC_MAX(rnic_sim_busy_until, rnic_sim_now());
+    for (; wr; wr = wr->next) {
+        assert(wr->opcode == IBV_WR_RDMA_READ ||
+               wr->opcode == IBV_WR_RDMA_WRITE);
+        length = 0;
+        for (i = 0; i < wr->num_sge; i++) length += wr->sg_list[i].length;
+        rnic_sim_busy_until += rnic_sim_latency(
+            wr->wr.rdma.rkey, wr->wr.rdma.remote_addr, length);
+        if (!(wr->send_flags & IBV_SEND_SIGNALED)) continue;
+        if (pending->count == RSEC_CQ_DEPTH)
+            die_printf("[%s] simulated CQ overflow\n", __func__);
+        comp = &pending->comp[(pending->head + pending->count) % RSEC_CQ_DEPTH];
+        pending->count++;
+        comp->wr_id = wr->wr_id;
+        comp->opcode = wr->opcode == IBV_WR_RDMA_READ ? IBV_WC_RDMA_READ
+                                                      : IBV_WC_RDMA_WRITE;
+        comp->byte_len = length;
+        comp->qp_num = qp->qp_num;
+        comp->deadline = rnic_sim_busy_until;
+    }
+    return 0;
+}
+
+/**
+ * rnic_sim_poll_cq - deliver simulated completions of a CQ
+ * Waits until the last delivered completion is due, like a busy poll on the
+ * real CQ. Returns the number of completions delivered (at most @num_comps);
+ * the caller polls the real CQ for the rest.
+ * @cq: completion queue
+ * @num_comps: number of completions wanted
+ * @wc: return completions
+ */
+int rnic_sim_poll_cq(struct ibv_cq *cq, int num_comps, struct ibv_wc *wc) {
+    struct rnic_sim_completion *comp;
+    struct rnic_sim_cq *pending;
+    uint64_t deadline = 0;
+    int comps = 0;
+    if (rnic_sim_pending == NULL) return 0;
+    pending = g_hash_table_lookup(rnic_sim_pending, cq);
+    if (pending == NULL) return 0;
+
+    while (comps < num_comps && pending->count) {
+        comp = &pending->comp[pending->head];
+        pending->head = (pending->head + 1) % RSEC_CQ_DEPTH;
+        pending->count--;
+        memset(&wc[comps], 0, sizeof(struct ibv_wc));
+        wc[comps].wr_id = comp->wr_id;
+        wc[comps].status = IBV_WC_SUCCESS;
+        wc[comps].opcode = comp->opcode;
+        wc[comps].byte_len = comp->byte_len;
+        wc[comps].qp_num = comp->qp_num;
+        deadline = comp->deadline;
+        comps++;
+    }
+    while (comps && rnic_sim_now() < deadline) RSEC_CPU_RELAX();
+    return comps;
+}
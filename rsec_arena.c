@@ -0,0 +1,84 @@
+#include "rsec.h"
+
+/**
+ * rsec_arena.c: blocks form a list; allocation bumps the current block and
+ * moves on to the next one (allocating it only the first time) when it is
+ * full.
+ */
+
+/**
+ * rsec_arena_new_block - allocate a block with at least @size bytes
+ */
+static struct rsec_arena_block *rsec_arena_new_block(size_t size) {
+    struct rsec_arena_block *block =
+        malloc(sizeof(struct rsec_arena_block) + size);
+    assert(block);
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+/**
+ * rsec_arena_create - create an arena
+ * @block_size: size of each block, RSEC_ARENA_BLOCK_SIZE if zero
+ */
+struct rsec_arena *rsec_arena_create(size_t block_size) {
+    struct rsec_arena *arena = malloc(sizeof(struct rsec_arena));
+    assert(arena);
+    arena->block_size = block_size ? block_size : RSEC_ARENA_BLOCK_SIZE;
+    arena->first = arena->current = rsec_arena_new_block(arena->block_size);
+    arena->num_blocks = 1;
+    return arena;
+}
+
+/**
+ * rsec_arena_alloc - allocate from the arena
+ * The memory stays valid until the next rsec_arena_reset.
+ * @arena: arena
+ * @size: size in bytes
+ */
+void *rsec_arena_alloc(struct rsec_arena *arena, size_t size) {
+    struct rsec_arena_block *block = arena->current;
+    void *ret;
+    size = RSEC_ROUND_UP(RSEC_MAX(size, 1), RSEC_ARENA_ALIGN);
+    while (block->used + size > block->size) {
+        if (block->next == NULL || block->next->size < size) {
+            // a new block goes right after the current one
+            struct rsec_arena_block *new_block =
+                rsec_arena_new_block(RSEC_MAX(arena->block_size, size));
+            new_block->next = block->next;
+            block->next = new_block;
+            arena->num_blocks++;
+        }
+        block = block->next;
+        block->used = 0;
+    }
+    arena->current = block;
+    ret = block->data + block->used;
+    block->used += size;
+    return ret;
+}
+
+/**
+ * rsec_arena_reset - release everything allocated from the arena
+ * @arena: arena
+ */
+void rsec_arena_reset(struct rsec_arena *arena) {
+    arena->first->used = 0;
+    arena->current = arena->first;
+}
+
+/**
+ * rsec_arena_destroy - free the arena and all of its blocks
+ * @arena: arena
+ */
+void rsec_arena_destroy(struct rsec_arena *arena) {
+    struct rsec_arena_block *block, *next;
+    if (arena == NULL) return;
+    for (block = arena->first; block; block = next) {
+        next = block->next;
+        free(block);
+    }
+    free(arena);
+}
@@ -0,0 +1,36 @@
+#ifndef RSEC_ARENA_HEADER
+#define RSEC_ARENA_HEADER
+
+#include <stddef.h>
+
+/**
+ * rsec_arena.h: bump-pointer allocator for the objects of one running_time.
+ * Nothing is freed individually; rsec_arena_reset at the start of every
+ * running_time releases everything at once. Blocks are kept across resets,
+ * so once the arena has grown to the size of one iteration the trial loop
+ * stops calling malloc.
+ */
+
+#define RSEC_ARENA_BLOCK_SIZE (1 << 20)
+#define RSEC_ARENA_ALIGN 16
+
+struct rsec_arena_block {
+    struct rsec_arena_block *next;
+    size_t size;
+    size_t used;
+    char data[] __attribute__((aligned(RSEC_ARENA_ALIGN)));
+};
+
+struct rsec_arena {
+    struct rsec_arena_block *first;
+    struct rsec_arena_block *current;
+    size_t block_size;
+    size_t num_blocks;
+};
+
+struct rsec_arena *rsec_arena_create(size_t block_size);
+void *rsec_arena_alloc(struct rsec_arena *arena, size_t size);
+void rsec_arena_reset(struct rsec_arena *arena);
+void rsec_arena_destroy(struct rsec_arena *arena);
+
+#endif
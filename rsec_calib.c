@@ -0,0 +1,154 @@
+#include "rsec.h"
+
+/**
+ * rsec_calib.c: this code decides when the attacker has to run the full
+ * threshold calibration and keeps the threshold of every struct
+ * rsec_calib_key up to date in between.
+ */
+
+/**
+ * rsec_calib_key_hash - FNV-1a over the key bytes
+ */
+static guint rsec_calib_key_hash(gconstpointer data) {
+    return rsec_fnv1a(data, sizeof(struct rsec_calib_key));
+}
+
+/**
+ * rsec_calib_key_equal - keys are compared byte by byte
+ */
+static gboolean rsec_calib_key_equal(gconstpointer a, gconstpointer b) {
+    return !memcmp(a, b, sizeof(struct rsec_calib_key));
+}
+
+/**
+ * rsec_calib_entry_free - release an entry and its classifier
+ */
+static void rsec_calib_entry_free(gpointer data) {
+    struct rsec_calib_entry *entry = data;
+    rsec_classify_free(entry->cls);
+    free(entry);
+}
+
+/**
+ * rsec_calib_setup - create an empty threshold cache
+ */
+struct rsec_calib_inf *rsec_calib_setup(void) {
+    struct rsec_calib_inf *calib = malloc(sizeof(struct rsec_calib_inf));
+    assert(calib);
+    memset(calib, 0, sizeof(struct rsec_calib_inf));
+    calib->mode = RSEC_CALIB_MODE;
+    calib->table = g_hash_table_new_full(
+        rsec_calib_key_hash, rsec_calib_key_equal, NULL, rsec_calib_entry_free);
+    RSEC_PRINT("CALIB_MODE: %s\n", rsec_calib_mode_text[calib->mode]);
+    return calib;
+}
+
+/**
+ * rsec_calib_lookup - get (or create) the entry of an iteration
+ * @calib: threshold cache
+ * @key: configuration of the iteration, its bucket is set from target_addr
+ * @target_addr: address of the reload target
+ */
+struct rsec_calib_entry *rsec_calib_lookup(struct rsec_calib_inf *calib,
+                                           struct rsec_calib_key *key,
+                                           unsigned long long target_addr) {
+    struct rsec_calib_entry *entry;
+    key->bucket = (target_addr & RSEC_CACHE_SET_MASK) >>
+                  RSEC_CACHE_SET_N_HEIGHT_RIGHT;
+    calib->num_lookups++;
+    entry = g_hash_table_lookup(calib->table, key);
+    if (entry == NULL) {
+        entry = malloc(sizeof(struct rsec_calib_entry));
+        assert(entry);
+        memset(entry, 0, sizeof(struct rsec_calib_entry));
+        memcpy(&entry->key, key, sizeof(struct rsec_calib_key));
+        entry->cls = rsec_classify_setup(RSEC_CLASSIFY_MODEL);
+        g_hash_table_insert(calib->table, &entry->key, entry);
+    }
+    return entry;
+}
+
+/**
+ * rsec_calib_need - whether this iteration has to run rsec_get_threshold
+ * The classifier of the entry is reset and trained again by the calibration.
+ * @calib: threshold cache
+ * @entry: entry from rsec_calib_lookup
+ */
+int rsec_calib_need(struct rsec_calib_inf *calib,
+                    struct rsec_calib_entry *entry) {
+    if (calib->mode == RSEC_CALIB_MODE_CACHED && entry->valid) return 0;
+    calib->num_calibrations++;
+    rsec_classify_reset(entry->cls);
+    return 1;
+}
+
+/**
+ * rsec_calib_set - store the result of a full calibration
+ * @entry: entry from rsec_calib_lookup
+ * @lat_evict: average latency of a MISS reload
+ * @lat_hit: average latency of a HIT reload
+ */
+void rsec_calib_set(struct rsec_calib_entry *entry, double lat_evict,
+                    double lat_hit) {
+    entry->lat_evict = lat_evict;
+    entry->lat_hit = lat_hit;
+    entry->valid = 1;
+    entry->age = 0;
+    entry->window_trials = entry->window_correct = 0;
+    entry->base_accuracy = -1;
+}
+
+/**
+ * rsec_calib_update - add one labelled trial
+ * The latency of its class moves towards the sample and the classifier
+ * trains on it.
+ * @entry: entry from rsec_calib_lookup
+ * @label: RSEC_CLASSIFY_HIT (the client accessed the target) or
+ * RSEC_CLASSIFY_MISS
+ * @lat_reload: reload latency (ns)
+ * @correct: whether the trial was classified correctly
+ */
+void rsec_calib_update(struct rsec_calib_entry *entry, int label,
+                       double lat_reload, int correct) {
+    double *lat;
+    if (!entry->valid) return;
+    entry->window_trials++;
+    entry->window_correct += correct;
+    rsec_classify_train(entry->cls, label, lat_reload);
+    lat = label == RSEC_CLASSIFY_MISS ? &entry->lat_evict : &entry->lat_hit;
+    *lat += RSEC_CALIB_EWMA_ALPHA * (lat_reload - *lat);
+}
+
+/**
+ * rsec_calib_end_iteration - run the drift detector after the trials
+ * Returns 1 if the entry drifted and is calibrated again next time.
+ * @entry: entry from rsec_calib_lookup
+ */
+int rsec_calib_end_iteration(struct rsec_calib_entry *entry) {
+    double accuracy;
+    int drift = 0;
+    if (!entry->valid || !entry->window_trials) return 0;
+    accuracy = (double)entry->window_correct / entry->window_trials;
+    entry->window_trials = entry->window_correct = 0;
+    entry->age++;
+    if (entry->base_accuracy < 0) entry->base_accuracy = accuracy;
+    if (accuracy < entry->base_accuracy - RSEC_CALIB_DRIFT_ACCURACY_DROP ||
+        entry->lat_evict < entry->lat_hit + RSEC_CALIB_MIN_GAP_NS ||
+        entry->age >= RSEC_CALIB_MAX_AGE)
+        drift = 1;
+    if (drift) entry->valid = 0;
+    return drift;
+}
+
+/**
+ * rsec_calib_free - print the cache statistics and release it
+ * @calib: threshold cache
+ */
+void rsec_calib_free(struct rsec_calib_inf *calib) {
+    if (calib == NULL) return;
+    RSEC_PRINT("calibrated %d of %d iterations (%u entries)\n",
+               calib->num_calibrations, calib->num_lookups,
+               g_hash_table_size(calib->table));
+    g_hash_table_destroy(calib->table);
+    free(calib);
+}
@@ -0,0 +1,86 @@
+#ifndef RSEC_CALIB_HEADER
+#define RSEC_CALIB_HEADER
+
+#include <glib.h>
+#include <stdint.h>
+
+/**
+ * rsec_calib.h: threshold cache of the attacker.
+ * A full calibration (rsec_get_threshold) costs 2 x
+ * RSEC_PROBE_GET_THRESHOLD_TRY_NUMBER evict + handshake + reload rounds. With
+ * RSEC_CALIB_MODE_CACHED its result is kept per struct rsec_calib_key
+ * (eviction set and reload size, cache set of the reload target, and the
+ * eviction mode, stride strategy and strategy a sweep may change) and refined
+ * with the labelled trials of every iteration: the EWMA of the hit and evict
+ * latency, and the classifier of the entry (rsec_classify.h) that makes the
+ * decisions. An entry is calibrated again only when it drifts:
+ * 1. the trial accuracy dropped RSEC_CALIB_DRIFT_ACCURACY_DROP below the
+ *    accuracy of the first iteration after calibration
+ * 2. the evict latency is no longer RSEC_CALIB_MIN_GAP_NS above the hit one
+ * 3. RSEC_CALIB_MAX_AGE iterations passed since the last calibration
+ * The attacker tells the client whether this iteration calibrates through
+ * RSEC_SYNC_SLOT_CALIBRATE.
+ */
+
+#define RSEC_CALIB_MODE_ALWAYS 1
+#define RSEC_CALIB_MODE_CACHED 2
+#define RSEC_CALIB_MODE RSEC_CALIB_MODE_CACHED
+static const char *const rsec_calib_mode_text[] = {
+    "------RSEC STRING------", "RSEC_CALIB_MODE_ALWAYS",
+    "RSEC_CALIB_MODE_CACHED"};
+
+#define RSEC_CALIB_BUCKET_BITS \
+    (RSEC_CACHE_SET_N_HEIGHT_LEFT - RSEC_CACHE_SET_N_HEIGHT_RIGHT)
+#define RSEC_CALIB_EWMA_ALPHA 0.05
+#define RSEC_CALIB_DRIFT_ACCURACY_DROP 0.1
+#define RSEC_CALIB_MIN_GAP_NS RSEC_ESTIMATED_EVICT_FETCH_LATENCY
+#define RSEC_CALIB_MAX_AGE 50
+
+/* compared byte by byte, set every field */
+struct rsec_calib_key {
+    int evict_size;
+    int bucket;  // set by rsec_calib_lookup
+    int reload_size;
+    int test_mode;
+    int stride_strategy;
+    int strategy;
+};
+
+struct rsec_calib_entry {
+    struct rsec_calib_key key;
+    int valid;
+    int age;
+
+    /* labelled latency (ns) */
+    double lat_hit;
+    double lat_evict;
+    struct rsec_classify_inf *cls;
+
+    /* accuracy of the current iteration and the reference after calibration */
+    int window_trials;
+    int window_correct;
+    double base_accuracy;
+};
+
+struct rsec_calib_inf {
+    int mode;
+    /* struct rsec_calib_key -> struct rsec_calib_entry */
+    GHashTable *table;
+    int num_lookups;
+    int num_calibrations;
+};
+
+struct rsec_calib_inf *rsec_calib_setup(void);
+struct rsec_calib_entry *rsec_calib_lookup(struct rsec_calib_inf *calib,
+                                           struct rsec_calib_key *key,
+                                           unsigned long long target_addr);
+int rsec_calib_need(struct rsec_calib_inf *calib,
+                    struct rsec_calib_entry *entry);
+void rsec_calib_set(struct rsec_calib_entry *entry, double lat_evict,
+                    double lat_hit);
+void rsec_calib_update(struct rsec_calib_entry *entry, int label,
+                       double lat_reload, int correct);
+int rsec_calib_end_iteration(struct rsec_calib_entry *entry);
+void rsec_calib_free(struct rsec_calib_inf *calib);
+
+#endif
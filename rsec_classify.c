@@ -0,0 +1,263 @@
+#include "rsec.h"
+#include <math.h>
+
+/**
+ * rsec_classify.c: hit/miss classifiers of the reload latency.
+ * All models keep the per-class mean and variance; the histogram and KNN
+ * models keep their own sample state on top of it. A class without samples
+ * never wins a prediction.
+ */
+
+/**
+ * rsec_classify_setup - create an untrained classifier
+ * @model: RSEC_CLASSIFY_MODEL_*
+ */
+struct rsec_classify_inf *rsec_classify_setup(int model) {
+    struct rsec_classify_inf *cls = malloc(sizeof(struct rsec_classify_inf));
+    int c;
+    assert(cls);
+    assert(model >= RSEC_CLASSIFY_MODEL_MIDPOINT &&
+           model <= RSEC_CLASSIFY_MODEL_KNN);
+    memset(cls, 0, sizeof(struct rsec_classify_inf));
+    cls->model = model;
+    for (c = 0; c < RSEC_CLASSIFY_NUM_CLASSES; c++) {
+        if (model == RSEC_CLASSIFY_MODEL_HISTOGRAM) {
+            cls->hist[c] = malloc(sizeof(uint32_t) * RSEC_CLASSIFY_HIST_BINS);
+            assert(cls->hist[c]);
+        }
+        if (model == RSEC_CLASSIFY_MODEL_KNN) {
+            cls->knn[c] = malloc(sizeof(double) * RSEC_CLASSIFY_KNN_WINDOW);
+            assert(cls->knn[c]);
+        }
+    }
+    rsec_classify_reset(cls);
+    return cls;
+}
+
+/**
+ * rsec_classify_reset - drop every trained sample
+ * @cls: classifier
+ */
+void rsec_classify_reset(struct rsec_classify_inf *cls) {
+    int c;
+    for (c = 0; c < RSEC_CLASSIFY_NUM_CLASSES; c++) {
+        cls->count[c] = 0;
+        cls->mean[c] = cls->m2[c] = 0;
+        cls->conf_sum[c] = 0;
+        cls->conf_count[c] = 0;
+        if (cls->hist[c])
+            memset(cls->hist[c], 0,
+                   sizeof(uint32_t) * RSEC_CLASSIFY_HIST_BINS);
+    }
+    cls->cut_bin = 0;
+    cls->dirty = 1;
+}
+
+/**
+ * rsec_classify_bin - histogram bin of a latency
+ */
+static int rsec_classify_bin(double lat) {
+    double bin = (lat - RSEC_CLASSIFY_HIST_MIN_NS) / RSEC_CLASSIFY_HIST_BIN_NS;
+    if (bin < 0) return 0;
+    if (bin >= RSEC_CLASSIFY_HIST_BINS) return RSEC_CLASSIFY_HIST_BINS - 1;
+    return (int)bin;
+}
+
+/**
+ * rsec_classify_train - add one labelled sample
+ * @cls: classifier
+ * @label: RSEC_CLASSIFY_HIT or RSEC_CLASSIFY_MISS
+ * @lat: reload latency (ns)
+ */
+void rsec_classify_train(struct rsec_classify_inf *cls, int label,
+                         double lat) {
+    double delta;
+    assert(label == RSEC_CLASSIFY_HIT || label == RSEC_CLASSIFY_MISS);
+    if (cls->knn[label])
+        cls->knn[label][cls->count[label] % RSEC_CLASSIFY_KNN_WINDOW] = lat;
+    if (cls->hist[label]) {
+        cls->hist[label][rsec_classify_bin(lat)]++;
+        cls->dirty = 1;
+    }
+    cls->count[label]++;
+    delta = lat - cls->mean[label];
+    cls->mean[label] += delta / cls->count[label];
+    cls->m2[label] += delta * (lat - cls->mean[label]);
+}
+
+/**
+ * rsec_classify_midpoint - cut between the class means
+ * Confidence grows linearly to 1 at the mean of the predicted class.
+ */
+static int rsec_classify_midpoint(struct rsec_classify_inf *cls, double lat,
+                                  double *confidence) {
+    double cut = (cls->mean[RSEC_CLASSIFY_HIT] +
+                  cls->mean[RSEC_CLASSIFY_MISS]) / 2;
+    double half_gap = fabs(cls->mean[RSEC_CLASSIFY_MISS] - cut);
+    if (half_gap > 0)
+        *confidence = 0.5 + 0.5 * RSEC_MIN(fabs(lat - cut) / half_gap, 1);
+    else
+        *confidence = 0.5;
+    return lat < cut ? RSEC_CLASSIFY_HIT : RSEC_CLASSIFY_MISS;
+}
+
+/**
+ * rsec_classify_histogram - cut at the bin edge with the fewest training
+ * errors (middle of the best run), confidence from the counts of the bin
+ */
+static int rsec_classify_histogram(struct rsec_classify_inf *cls, double lat,
+                                   double *confidence) {
+    uint32_t *hit = cls->hist[RSEC_CLASSIFY_HIT];
+    uint32_t *miss = cls->hist[RSEC_CLASSIFY_MISS];
+    int64_t errors, best;
+    int bin, first = 0, last = 0, label;
+    if (cls->dirty) {
+        // cut at bin b: hits at or above b and misses below b are wrong
+        errors = best = cls->count[RSEC_CLASSIFY_HIT];
+        for (bin = 1; bin <= RSEC_CLASSIFY_HIST_BINS; bin++) {
+            errors += (int64_t)miss[bin - 1] - hit[bin - 1];
+            if (errors < best) {
+                best = errors;
+                first = last = bin;
+            } else if (errors == best && last == bin - 1) {
+                last = bin;
+            }
+        }
+        cls->cut_bin = (first + last) / 2;
+        cls->dirty = 0;
+    }
+    bin = rsec_classify_bin(lat);
+    label = bin < cls->cut_bin ? RSEC_CLASSIFY_HIT : RSEC_CLASSIFY_MISS;
+    *confidence = (cls->hist[label][bin] + 1.0) / (hit[bin] + miss[bin] + 2.0);
+    return label;
+}
+
+/**
+ * rsec_classify_gmm - maximum posterior of two Gaussians weighted by the
+ * class frequencies
+ */
+static int rsec_classify_gmm(struct rsec_classify_inf *cls, double lat,
+                             double *confidence) {
+    double log_p[RSEC_CLASSIFY_NUM_CLASSES], var, total;
+    int c, label;
+    total = cls->count[RSEC_CLASSIFY_HIT] + cls->count[RSEC_CLASSIFY_MISS];
+    for (c = 0; c < RSEC_CLASSIFY_NUM_CLASSES; c++) {
+        var = cls->count[c] > 1 ? cls->m2[c] / (cls->count[c] - 1) : 0;
+        var = RSEC_MAX(var, RSEC_CLASSIFY_MIN_VAR);
+        log_p[c] = log(cls->count[c] / total) - 0.5 * log(var) -
+                   (lat - cls->mean[c]) * (lat - cls->mean[c]) / (2 * var);
+    }
+    label = log_p[RSEC_CLASSIFY_HIT] > log_p[RSEC_CLASSIFY_MISS]
+                ? RSEC_CLASSIFY_HIT
+                : RSEC_CLASSIFY_MISS;
+    *confidence = 1 / (1 + exp(log_p[!label] - log_p[label]));
+    return label;
+}
+
+/**
+ * rsec_classify_knn - majority vote of the nearest samples
+ */
+static int rsec_classify_knn(struct rsec_classify_inf *cls, double lat,
+                             double *confidence) {
+    double best_dist[RSEC_CLASSIFY_KNN_K], dist;
+    int best_label[RSEC_CLASSIFY_KNN_K], votes = 0;
+    int c, i, j, n, k = 0, label;
+    for (c = 0; c < RSEC_CLASSIFY_NUM_CLASSES; c++) {
+        n = RSEC_MIN(cls->count[c], RSEC_CLASSIFY_KNN_WINDOW);
+        for (i = 0; i < n; i++) {
+            dist = fabs(cls->knn[c][i] - lat);
+            if (k == RSEC_CLASSIFY_KNN_K && dist >= best_dist[k - 1]) continue;
+            if (k < RSEC_CLASSIFY_KNN_K) k++;
+            // insertion into the sorted neighbor list
+            for (j = k - 1; j > 0 && best_dist[j - 1] > dist; j--) {
+                best_dist[j] = best_dist[j - 1];
+                best_label[j] = best_label[j - 1];
+            }
+            best_dist[j] = dist;
+            best_label[j] = c;
+        }
+    }
+    for (i = 0; i < k; i++) votes += best_label[i] == RSEC_CLASSIFY_MISS;
+    label = 2 * votes >= k ? RSEC_CLASSIFY_MISS : RSEC_CLASSIFY_HIT;
+    *confidence = (double)(label == RSEC_CLASSIFY_MISS ? votes : k - votes) / k;
+    return label;
+}
+
+/**
+ * rsec_classify_predict - classify one reload
+ * Returns RSEC_CLASSIFY_HIT or RSEC_CLASSIFY_MISS.
+ * @cls: classifier
+ * @lat: reload latency (ns)
+ * @confidence: return confidence of the answer, can be NULL
+ */
+int rsec_classify_predict(struct rsec_classify_inf *cls, double lat,
+                          double *confidence) {
+    double conf;
+    int label;
+    if (!cls->count[RSEC_CLASSIFY_HIT] || !cls->count[RSEC_CLASSIFY_MISS]) {
+        label = cls->count[RSEC_CLASSIFY_HIT] ? RSEC_CLASSIFY_HIT
+                                              : RSEC_CLASSIFY_MISS;
+        conf = 0.5;
+    } else {
+        switch (cls->model) {
+            case RSEC_CLASSIFY_MODEL_MIDPOINT:
+                label = rsec_classify_midpoint(cls, lat, &conf);
+                break;
+            case RSEC_CLASSIFY_MODEL_HISTOGRAM:
+                label = rsec_classify_histogram(cls, lat, &conf);
+                break;
+            case RSEC_CLASSIFY_MODEL_GMM:
+                label = rsec_classify_gmm(cls, lat, &conf);
+                break;
+            case RSEC_CLASSIFY_MODEL_KNN:
+                label = rsec_classify_knn(cls, lat, &conf);
+                break;
+            default:
+                die_printf("[%s] model %d error\n", __func__, cls->model);
+        }
+    }
+    cls->conf_sum[label] += conf;
+    cls->conf_count[label]++;
+    if (confidence) *confidence = conf;
+    return label;
+}
+
+/**
+ * rsec_classify_print - print the training size and the average confidence
+ * of each class since the last print
+ * @cls: classifier
+ * @iteration: current iteration
+ */
+void rsec_classify_print(struct rsec_classify_inf *cls, int iteration) {
+    int c;
+    RSEC_PRINT(
+        "%d\tclassify %s:\ttrained %lu/%lu\tconfidence hit %0.3f(%d) miss "
+        "%0.3f(%d)\n",
+        iteration, rsec_classify_model_text[cls->model],
+        (unsigned long)cls->count[RSEC_CLASSIFY_HIT],
+        (unsigned long)cls->count[RSEC_CLASSIFY_MISS],
+        cls->conf_sum[RSEC_CLASSIFY_HIT] /
+            RSEC_MAX(cls->conf_count[RSEC_CLASSIFY_HIT], 1),
+        cls->conf_count[RSEC_CLASSIFY_HIT],
+        cls->conf_sum[RSEC_CLASSIFY_MISS] /
+            RSEC_MAX(cls->conf_count[RSEC_CLASSIFY_MISS], 1),
+        cls->conf_count[RSEC_CLASSIFY_MISS]);
+    for (c = 0; c < RSEC_CLASSIFY_NUM_CLASSES; c++) {
+        cls->conf_sum[c] = 0;
+        cls->conf_count[c] = 0;
+    }
+}
+
+/**
+ * rsec_classify_free - release a classifier
+ * @cls: classifier
+ */
+void rsec_classify_free(struct rsec_classify_inf *cls) {
+    int c;
+    if (cls == NULL) return;
+    for (c = 0; c < RSEC_CLASSIFY_NUM_CLASSES; c++) {
+        free(cls->hist[c]);
+        free(cls->knn[c]);
+    }
+    free(cls);
+}
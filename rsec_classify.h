@@ -0,0 +1,73 @@
+#ifndef RSEC_CLASSIFY_HEADER
+#define RSEC_CLASSIFY_HEADER
+
+#include <stdint.h>
+
+/**
+ * rsec_classify.h: hit/miss decision of a reload.
+ * Every model trains incrementally from labelled latencies (the calibration
+ * rounds of rsec_get_threshold and the trials of every iteration) and answers
+ * a class together with its confidence in [0.5, 1].
+ * 1. RSEC_CLASSIFY_MODEL_MIDPOINT - cut at the middle of the two class means
+ * 2. RSEC_CLASSIFY_MODEL_HISTOGRAM - per-class histograms, cut at the bin edge
+ *    with the fewest training errors
+ * 3. RSEC_CLASSIFY_MODEL_GMM - one Gaussian per class, maximum posterior
+ * 4. RSEC_CLASSIFY_MODEL_KNN - majority of the RSEC_CLASSIFY_KNN_K nearest of
+ *    the last RSEC_CLASSIFY_KNN_WINDOW samples of each class
+ */
+
+#define RSEC_CLASSIFY_MODEL_MIDPOINT 1
+#define RSEC_CLASSIFY_MODEL_HISTOGRAM 2
+#define RSEC_CLASSIFY_MODEL_GMM 3
+#define RSEC_CLASSIFY_MODEL_KNN 4
+#define RSEC_CLASSIFY_MODEL RSEC_CLASSIFY_MODEL_MIDPOINT
+static const char *const rsec_classify_model_text[] = {
+    "------RSEC STRING------", "RSEC_CLASSIFY_MODEL_MIDPOINT",
+    "RSEC_CLASSIFY_MODEL_HISTOGRAM", "RSEC_CLASSIFY_MODEL_GMM",
+    "RSEC_CLASSIFY_MODEL_KNN"};
+
+// labels, same as the value of RSEC_SYNC_SLOT_ACCESS
+#define RSEC_CLASSIFY_HIT 0
+#define RSEC_CLASSIFY_MISS 1
+#define RSEC_CLASSIFY_NUM_CLASSES 2
+
+// histogram: bins of RSEC_CLASSIFY_HIST_BIN_NS from RSEC_CLASSIFY_HIST_MIN_NS
+#define RSEC_CLASSIFY_HIST_MIN_NS 0
+#define RSEC_CLASSIFY_HIST_BIN_NS 20
+#define RSEC_CLASSIFY_HIST_BINS 1024
+#define RSEC_CLASSIFY_KNN_K 7
+#define RSEC_CLASSIFY_KNN_WINDOW 256
+// variance floor of the GMM (ns^2)
+#define RSEC_CLASSIFY_MIN_VAR 1.0
+
+struct rsec_classify_inf {
+    int model;
+    uint64_t count[RSEC_CLASSIFY_NUM_CLASSES];
+
+    /* running mean and squared deviation (Welford) */
+    double mean[RSEC_CLASSIFY_NUM_CLASSES];
+    double m2[RSEC_CLASSIFY_NUM_CLASSES];
+
+    /* histogram model, cut is recomputed when dirty */
+    uint32_t *hist[RSEC_CLASSIFY_NUM_CLASSES];
+    int cut_bin;
+    int dirty;
+
+    /* KNN model - ring of the last samples of each class */
+    double *knn[RSEC_CLASSIFY_NUM_CLASSES];
+
+    /* confidence of the predictions since the last report */
+    double conf_sum[RSEC_CLASSIFY_NUM_CLASSES];
+    int conf_count[RSEC_CLASSIFY_NUM_CLASSES];
+};
+
+struct rsec_classify_inf *rsec_classify_setup(int model);
+void rsec_classify_reset(struct rsec_classify_inf *cls);
+void rsec_classify_train(struct rsec_classify_inf *cls, int label,
+                         double lat);
+int rsec_classify_predict(struct rsec_classify_inf *cls, double lat,
+                          double *confidence);
+void rsec_classify_print(struct rsec_classify_inf *cls, int iteration);
+void rsec_classify_free(struct rsec_classify_inf *cls);
+
+#endif
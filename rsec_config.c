@@ -0,0 +1,303 @@
+#include "rsec.h"
+
+/**
+ * rsec_config.c: every configurable field is described once in
+ * rsec_config_options (name, type, offset, accepted range), so loading,
+ * overriding and printing share the same table.
+ */
+
+struct rsec_config rsec_config = {
+    .value_size = RSEC_DEFAULT_VALUE_SIZE,
+    .total_set_size_kb = RSEC_DEFAULT_ALLOC_TOTAL_SET_SIZE_KB,
+    .evict_mr_number = RSEC_DEFAULT_EVICT_MR_NUMBER,
+    .running_times = RSEC_DEFAULT_ACCESS_TEST_RUNNING_TIMES,
+    .access_test_time = RSEC_DEFAULT_ACCESS_TEST_TIME,
+    .trial_mode = RSEC_DEFAULT_TRIAL_MODE,
+    .trial_min = RSEC_DEFAULT_TRIAL_MIN,
+    .trial_error = RSEC_DEFAULT_TRIAL_ERROR,
+    .trial_accuracy = RSEC_DEFAULT_TRIAL_ACCURACY,
+    .threshold_try_number = RSEC_DEFAULT_PROBE_GET_THRESHOLD_TRY_NUMBER,
+    .estimated_evict_latency = RSEC_DEFAULT_ESTIMATED_EVICT_LATENCY,
+    .estimated_hit_latency = RSEC_DEFAULT_ESTIMATED_HIT_LATENCY,
+    .evict_mode = RSEC_DEFAULT_PROBE_COLLISION_CHECK_MODE,
+    .stride_strategy = RSEC_DEFAULT_PROBE_STRIDE_STRATEGY,
+    .numa_node = RSEC_DEFAULT_NUMA_NODE,
+    .rnic_sim =
+        {
+            .mtt_sets = RNIC_SIM_DEFAULT_MTT_SETS,
+            .mtt_ways = RNIC_SIM_DEFAULT_MTT_WAYS,
+            .mpt_sets = RNIC_SIM_DEFAULT_MPT_SETS,
+            .mpt_ways = RNIC_SIM_DEFAULT_MPT_WAYS,
+            .base_ns = RNIC_SIM_DEFAULT_BASE_NS,
+            .mtt_miss_ns = RNIC_SIM_DEFAULT_MTT_MISS_NS,
+            .mpt_miss_ns = RNIC_SIM_DEFAULT_MPT_MISS_NS,
+            .jitter_ns = RNIC_SIM_DEFAULT_JITTER_NS,
+        },
+    .mock_verbs =
+        {
+            .latency_ns = MOCK_VERBS_DEFAULT_LATENCY_NS,
+            .byte_ns_shift = MOCK_VERBS_DEFAULT_BYTE_NS_SHIFT,
+        },
+};
+
+#define RSEC_CONFIG_FIELD(field) offsetof(struct rsec_config, field)
+#define RSEC_CONFIG_NAMES(text) text, sizeof(text) / sizeof(text[0])
+
+static const struct rsec_config_option rsec_config_options[] = {
+    {"value_size", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(value_size), 1, INT_MAX},
+    {"total_set_size_kb", RSEC_CONFIG_LLONG,
+     RSEC_CONFIG_FIELD(total_set_size_kb), RSEC_MR_SIZE / 1024, LLONG_MAX},
+    {"evict_mr_number", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(evict_mr_number), 1,
+     INT_MAX},
+    {"running_times", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(running_times), 1,
+     INT_MAX},
+    {"access_test_time", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(access_test_time),
+     1, INT_MAX},
+    {"trial_mode", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(trial_mode),
+     RSEC_TRIAL_MODE_FIXED, RSEC_TRIAL_MODE_SPRT,
+     RSEC_CONFIG_NAMES(rsec_trial_mode_text)},
+    {"trial_min", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(trial_min), 1, INT_MAX},
+    {"trial_error", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(trial_error), 1, 500},
+    {"trial_accuracy", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(trial_accuracy), 501,
+     999},
+    {"threshold_try_number", RSEC_CONFIG_INT,
+     RSEC_CONFIG_FIELD(threshold_try_number), 100, INT_MAX},
+    {"estimated_evict_latency", RSEC_CONFIG_INT,
+     RSEC_CONFIG_FIELD(estimated_evict_latency), 0, INT_MAX},
+    {"estimated_hit_latency", RSEC_CONFIG_INT,
+     RSEC_CONFIG_FIELD(estimated_hit_latency), 0, INT_MAX},
+    {"evict_mode", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(evict_mode),
+     RSEC_PROBE_COLLISION_CHECK_MODE_MR, RSEC_PROBE_COLLISION_CHECK_MODE_STRIDE,
+     RSEC_CONFIG_NAMES(rsec_experiment_evict_mode)},
+    {"stride_strategy", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(stride_strategy),
+     RSEC_PROBE_STRIDE_STRATEGY_NULL, RSEC_PROBE_STRIDE_STRATEGY_NAIVE,
+     RSEC_CONFIG_NAMES(rsec_probe_stride_strategy)},
+    {"numa_node", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(numa_node), 0, INT_MAX},
+    {"sim_mtt_sets", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(rnic_sim.mtt_sets), 1,
+     RNIC_SIM_MAX_MTT_SETS},
+    {"sim_mtt_ways", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(rnic_sim.mtt_ways), 1,
+     RNIC_SIM_MAX_WAYS},
+    {"sim_mpt_sets", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(rnic_sim.mpt_sets), 1,
+     INT_MAX / RNIC_SIM_MAX_WAYS},
+    {"sim_mpt_ways", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(rnic_sim.mpt_ways), 1,
+     RNIC_SIM_MAX_WAYS},
+    {"sim_base_ns", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(rnic_sim.base_ns), 0,
+     INT_MAX},
+    {"sim_mtt_miss_ns", RSEC_CONFIG_INT,
+     RSEC_CONFIG_FIELD(rnic_sim.mtt_miss_ns), 0, INT_MAX},
+    {"sim_mpt_miss_ns", RSEC_CONFIG_INT,
+     RSEC_CONFIG_FIELD(rnic_sim.mpt_miss_ns), 0, INT_MAX},
+    {"sim_jitter_ns", RSEC_CONFIG_INT, RSEC_CONFIG_FIELD(rnic_sim.jitter_ns),
+     1, INT_MAX},
+    {"mock_latency_ns", RSEC_CONFIG_INT,
+     RSEC_CONFIG_FIELD(mock_verbs.latency_ns), 0, INT_MAX},
+    {"mock_byte_ns_shift", RSEC_CONFIG_INT,
+     RSEC_CONFIG_FIELD(mock_verbs.byte_ns_shift), 0,
+     MOCK_VERBS_MAX_BYTE_NS_SHIFT},
+};
+#define RSEC_CONFIG_NUM_OPTIONS \
+    (int)(sizeof(rsec_config_options) / sizeof(rsec_config_options[0]))
+
+/**
+ * rsec_config_find - option of a name, NULL if unknown
+ */
+static const struct rsec_config_option *rsec_config_find(const char *name) {
+    int i;
+    for (i = 0; i < RSEC_CONFIG_NUM_OPTIONS; i++)
+        if (!strcmp(rsec_config_options[i].name, name))
+            return &rsec_config_options[i];
+    return NULL;
+}
+
+/**
+ * rsec_config_value - parse and check the value of an option
+ * Returns 0 on success, -1 on an unknown name or a bad value.
+ * @name: option name
+ * @value: number, or one of the names of the option
+ * @number: return the value
+ */
+int rsec_config_value(const char *name, const char *value, long long *number) {
+    const struct rsec_config_option *option = rsec_config_find(name);
+    char *end;
+    int i;
+    if (option == NULL) {
+        RSEC_ERROR("unknown option %s\n", name);
+        return -1;
+    }
+    *number = strtoll(value, &end, 0);
+    if (end == value || *end != '\0') {
+        for (i = 0; i < option->num_names; i++)
+            if (!strcmp(option->names[i], value)) break;
+        if (i == option->num_names) {
+            RSEC_ERROR("bad value %s of %s\n", value, name);
+            return -1;
+        }
+        *number = i;
+    }
+    if (*number < option->min || *number > option->max) {
+        RSEC_ERROR("%s=%lld out of range [%lld, %lld]\n", name, *number,
+                   option->min, option->max);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * rsec_config_set - set one field from its text value
+ * Returns 0 on success, -1 on an unknown name or a bad value.
+ * @name: option name
+ * @value: number, or one of the names of the option
+ */
+int rsec_config_set(const char *name, const char *value) {
+    const struct rsec_config_option *option;
+    long long number;
+    if (rsec_config_value(name, value, &number)) return -1;
+    option = rsec_config_find(name);
+    if (option->type == RSEC_CONFIG_LLONG)
+        *(long long *)((char *)&rsec_config + option->offset) = number;
+    else
+        *(int *)((char *)&rsec_config + option->offset) = number;
+    return 0;
+}
+
+/**
+ * rsec_config_split - split a name=value string in place
+ * Surrounding spaces of name and value are removed. Returns 0 on success.
+ * @buffer: string (modified)
+ * @name: return the name
+ * @value: return the value
+ */
+int rsec_config_split(char *buffer, char **name, char **value) {
+    char *end, *equal = strchr(buffer, '=');
+    if (equal == NULL) {
+        RSEC_ERROR("%s is not name=value\n", buffer);
+        return -1;
+    }
+    *equal = '\0';
+    for (*name = buffer; **name == ' ' || **name == '\t'; (*name)++)
+        ;
+    for (end = equal; end > *name && (end[-1] == ' ' || end[-1] == '\t'); end--)
+        ;
+    *end = '\0';
+    for (*value = equal + 1; **value == ' ' || **value == '\t'; (*value)++)
+        ;
+    for (end = *value + strlen(*value);
+         end > *value && strchr(" \t\r\n", end[-1]); end--)
+        ;
+    *end = '\0';
+    return 0;
+}
+
+/**
+ * rsec_config_set_option - apply one name=value string
+ * @option: option string
+ */
+int rsec_config_set_option(const char *option) {
+    char buffer[RSEC_CONFIG_LINE_LENGTH];
+    char *name, *value;
+    snprintf(buffer, RSEC_CONFIG_LINE_LENGTH, "%s", option);
+    if (rsec_config_split(buffer, &name, &value)) return -1;
+    return rsec_config_set(name, value);
+}
+
+/**
+ * rsec_config_parse - call a handler on every line of a name=value file
+ * `#` starts a comment and empty lines are skipped. Returns 0 if the handler
+ * accepted every line.
+ * @file_name: file
+ * @handler: called with each line, returns 0 on success
+ */
+int rsec_config_parse(const char *file_name, int (*handler)(const char *)) {
+    char line[RSEC_CONFIG_LINE_LENGTH];
+    char *comment, *p;
+    int line_number = 0, ret = 0;
+    FILE *fp = fopen(file_name, "r");
+    if (fp == NULL) {
+        RSEC_ERROR("fail to open %s\n", file_name);
+        return -1;
+    }
+    while (fgets(line, RSEC_CONFIG_LINE_LENGTH, fp)) {
+        line_number++;
+        comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        for (p = line; *p && strchr(" \t\r\n", *p); p++)
+            ;
+        if (*p == '\0') continue;
+        if (handler(p)) {
+            RSEC_ERROR("%s:%d: invalid line\n", file_name, line_number);
+            ret = -1;
+        }
+    }
+    fclose(fp);
+    return ret;
+}
+
+/**
+ * rsec_config_load - read a configuration file
+ * @file_name: configuration file
+ */
+int rsec_config_load(const char *file_name) {
+    return rsec_config_parse(file_name, rsec_config_set_option);
+}
+
+/**
+ * rsec_config_check - stop on a configuration which cannot run
+ */
+static void rsec_config_check(int cond, const char *expr) {
+    if (!cond) die_printf("[config] %s does not hold\n", expr);
+}
+#define RSEC_CONFIG_CHECK(cond) rsec_config_check(cond, #cond)
+
+/**
+ * rsec_config_validate - check the constraints between the knobs
+ * Compile-time knobs are checked here as well, so every role stops before
+ * it connects.
+ */
+void rsec_config_validate(void) {
+    if (RSEC_PAGE_SIZE > RSEC_MR_SIZE)
+        RSEC_CONFIG_CHECK(RSEC_PAGE_SIZE % RSEC_MR_SIZE == 0);
+    else
+        RSEC_CONFIG_CHECK(RSEC_MR_SIZE % RSEC_PAGE_SIZE == 0);
+
+    if (RSEC_EXP_MODE == RSEC_EXP_MODE_CACHE) {
+        RSEC_CONFIG_CHECK(RSEC_RELOAD_MR_NUMBER == 2);
+        RSEC_CONFIG_CHECK(RSEC_PROBE_GET_THRESHOLD_TRY_NUMBER >= 100);
+        RSEC_CONFIG_CHECK(
+            RSEC_CACHE_SET_N_HEIGHT_LEFT - RSEC_CACHE_SET_N_HEIGHT_RIGHT >= 0);
+        RSEC_CONFIG_CHECK(
+            RSEC_CACHE_SLOT_M_WIDTH_LEFT - RSEC_CACHE_SLOT_M_WIDTH_RIGHT >= 0);
+        RSEC_CONFIG_CHECK(RSEC_CACHE_SET_IGNORE_BITS ==
+                          RSEC_CACHE_SET_N_HEIGHT_RIGHT);
+    }
+    RSEC_CONFIG_CHECK(RSEC_RELOAD_MR_NUMBER <= RSEC_CQ_DEPTH);
+    RSEC_CONFIG_CHECK(RSEC_ACCESS_MR_NUMBER <= RSEC_CQ_DEPTH);
+    RSEC_CONFIG_CHECK(RSEC_EVICT_QP_NUMBER <= RSEC_ATTACK_QP_NUMBER);
+    RSEC_CONFIG_CHECK(RSEC_DATA_SIZE % RSEC_AES_BLOCK_SIZE == 0);
+    RSEC_CONFIG_CHECK(RSEC_ACCESS_MODE == RSEC_OPERATION_READ);
+
+    RSEC_CONFIG_CHECK(RSEC_MR_NUMBER >= RSEC_RELOAD_MR_NUMBER);
+    RSEC_CONFIG_CHECK(RSEC_PROBE_COLLISION_CHECK_MODE !=
+                      RSEC_PROBE_COLLISION_CHECK_MODE_ASSOCIATE);
+    RSEC_CONFIG_CHECK(RSEC_NUMA_NODE <= numa_max_node());
+}
+
+/**
+ * rsec_config_print - print the configuration in use
+ */
+void rsec_config_print(void) {
+    const struct rsec_config_option *option;
+    long long number;
+    int i;
+    for (i = 0; i < RSEC_CONFIG_NUM_OPTIONS; i++) {
+        option = &rsec_config_options[i];
+        if (option->type == RSEC_CONFIG_LLONG)
+            number = *(long long *)((char *)&rsec_config + option->offset);
+        else
+            number = *(int *)((char *)&rsec_config + option->offset);
+        if (option->names)
+            RSEC_PRINT("config %s=%s\n", option->name,
+                       option->names[number]);
+        else
+            RSEC_PRINT("config %s=%lld\n", option->name, number);
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef RSEC_CONFIG_HEADER
+#define RSEC_CONFIG_HEADER
+
+#include <stddef.h>
+
+/**
+ * rsec_config.h: runtime experiment configuration.
+ * The knobs a parameter sweep changes are read from rsec_config instead of
+ * being compiled in; their RSEC_* macros in rsec.h expand to the fields below
+ * and RSEC_DEFAULT_* holds the former values. init.c loads the file given by
+ * `-F` (one `name=value` per line, `#` starts a comment), then applies every
+ * `-O name=value` on top of it and validates the result before any role
+ * starts. Server, client and attacker must run with the same configuration.
+ */
+
+#define RSEC_CONFIG_LINE_LENGTH 256
+
+#define RSEC_CONFIG_INT 1
+#define RSEC_CONFIG_LLONG 2
+
+struct rsec_config {
+    int value_size;
+    long long total_set_size_kb;
+    int evict_mr_number;
+    int running_times;
+    int access_test_time;
+    int trial_mode;
+    int trial_min;
+    int trial_error;
+    int trial_accuracy;
+    int threshold_try_number;
+    int estimated_evict_latency;
+    int estimated_hit_latency;
+    int evict_mode;
+    int stride_strategy;
+    int numa_node;
+    struct rnic_sim_params rnic_sim;  // RSEC_DATA_PATH_SIM [rnic_sim.h]
+    struct mock_verbs_params mock_verbs;  // RSEC_VERBS_MOCK [mock_verbs.h]
+};
+
+/* one configurable field; names (optional) are accepted instead of numbers */
+struct rsec_config_option {
+    const char *name;
+    int type;
+    size_t offset;
+    long long min;
+    long long max;
+    const char *const *names;
+    int num_names;
+};
+
+extern struct rsec_config rsec_config;
+
+int rsec_config_value(const char *name, const char *value, long long *number);
+int rsec_config_set(const char *name, const char *value);
+int rsec_config_split(char *buffer, char **name, char **value);
+int rsec_config_set_option(const char *option);
+int rsec_config_parse(const char *file_name, int (*handler)(const char *));
+int rsec_config_load(const char *file_name);
+void rsec_config_validate(void);
+void rsec_config_print(void);
+
+#endif
@@ -2,30 +2,136 @@
 
 /**
  * rsec_control.c - this code controls the configuration of attacker
+ * The get_* hooks ask the strategy of the running_time [rsec_strategy.h];
+ * the axes of a sweep [rsec_sweep.h] override the strategy.
  */
 
+/* hook of a strategy, the pythia one if the strategy has none */
+#define RSEC_STRATEGY_HOOK(strategy, hook) \
+    ((strategy)->ops->hook ? (strategy)->ops->hook : rsec_strategy_pythia.hook)
+
 /**
- * get_access_target - get target test/attack entry
+ * pythia_access_target - get target test/attack entry
  */
-int get_access_target(int running_times, int *key_array) {
+static int pythia_access_target(void *state, int running_times,
+                                int *key_array) {
 
     if (key_array) return key_array[running_times % RSEC_RELOAD_VPN_LENGTH];
     // DONE DELETE ABOVE LINES
     return (running_times % 4096) * 8;
 }
 
+/**
+ * pythia_shift_target - manually shift access offset
+ */
+static int pythia_shift_target(void *state, int access_target,
+                               int running_times) {
+    return -1;  // pythia
+}
+
+/**
+ * pythia_stride_strategy - get different attack ways
+ */
+static int pythia_stride_strategy(void *state, int running_times) {
+    return rsec_config.stride_strategy;  // pythia [rsec_config.h]
+}
+
+/**
+ * pythia_stride_distance_target - manually setups VPN distance between each
+ * request
+ */
+static int pythia_stride_distance_target(void *state, int running_times) {
+    return -1;  // pythia
+}
+
+/**
+ * pythia_num_evict_target - manually setups evict size
+ */
+static int pythia_num_evict_target(void *state, int running_times) {
+    // a sweep without evict_number axis keeps the evict size
+    if (rsec_sweep) return RSEC_EVICT_MR_PROCESS_NUMBER;
+    // Figure 7 experiment (figure7.sweep)
+    int subcycle = running_times % 5000;
+    int lengthcycle = subcycle / 1000;
+    return (1 << (6 + lengthcycle));
+}
+
+/**
+ * pythia_mr_target - manually setups mr evict+reload target
+ */
+static int pythia_mr_target(void *state, int running_times,
+                            uint32_t *extra_rkey) {
+    return 0;
+}
+
+/**
+ * pythia_evict_mode - different evict mode - mr or pte
+ */
+static int pythia_evict_mode(void *state, int running_times) {
+    return RSEC_PROBE_COLLISION_CHECK_MODE;  // pythia [rsec_config.h]
+}
+
+/**
+ * pythia_num_evict_qps - number of attack QPs used by the multi-QP eviction
+ * engines [rsec_evict.h]
+ */
+static int pythia_num_evict_qps(void *state, int running_times) {
+    return RSEC_EVICT_NUM_QPS;
+}
+
+const struct rsec_strategy rsec_strategy_pythia = {
+    .name = "pythia",
+    .access_target = pythia_access_target,
+    .shift_target = pythia_shift_target,
+    .stride_strategy = pythia_stride_strategy,
+    .stride_distance_target = pythia_stride_distance_target,
+    .num_evict_target = pythia_num_evict_target,
+    .mr_target = pythia_mr_target,
+    .evict_mode = pythia_evict_mode,
+    .num_evict_qps = pythia_num_evict_qps,
+};
+
+/**
+ * fixed_num_evict_target - RSEC_EVICT_MR_PROCESS_NUMBER in every iteration
+ */
+static int fixed_num_evict_target(void *state, int running_times) {
+    return RSEC_EVICT_MR_PROCESS_NUMBER;
+}
+
+/* pythia with a constant eviction set size (no Figure 7 cycle) */
+const struct rsec_strategy rsec_strategy_fixed = {
+    .name = "fixed",
+    .num_evict_target = fixed_num_evict_target,
+};
+
+/**
+ * get_access_target - get target test/attack entry
+ */
+int get_access_target(int running_times, int *key_array) {
+    struct rsec_strategy_inf *strategy = rsec_strategy_current(running_times);
+    return RSEC_STRATEGY_HOOK(strategy, access_target)(
+        strategy->state, running_times, key_array);
+}
+
 /**
  * get_shift_target - manually shift access offset
  */
 int get_shift_target(int access_target, int running_times) {
-    return -1;  // pythia
+    struct rsec_strategy_inf *strategy = rsec_strategy_current(running_times);
+    return RSEC_STRATEGY_HOOK(strategy, shift_target)(
+        strategy->state, access_target, running_times);
 }
 
 /**
  * get_stride_strategy - get different attack ways
  */
 int get_stride_strategy(int running_times) {
-    return RSEC_PROBE_STRIDE_STRATEGY_PYTHIA;  // pythia
+    struct rsec_strategy_inf *strategy = rsec_strategy_current(running_times);
+    int value = rsec_sweep_value(
+        running_times, RSEC_SWEEP_AXIS_STRIDE_STRATEGY, RSEC_SWEEP_UNSET);
+    if (value != RSEC_SWEEP_UNSET) return value;
+    return RSEC_STRATEGY_HOOK(strategy, stride_strategy)(strategy->state,
+                                                         running_times);
 }
 
 /**
@@ -33,27 +139,53 @@ int get_stride_strategy(int running_times) {
  * request
  */
 int get_stride_distance_target(int running_times) {
-    return -1;  // pythia
+    struct rsec_strategy_inf *strategy = rsec_strategy_current(running_times);
+    int value = rsec_sweep_value(
+        running_times, RSEC_SWEEP_AXIS_STRIDE_DISTANCE, RSEC_SWEEP_UNSET);
+    if (value != RSEC_SWEEP_UNSET) return value;
+    return RSEC_STRATEGY_HOOK(strategy, stride_distance_target)(
+        strategy->state, running_times);
 }
 
 /**
  * get_num_evict_target - manually setups evict size
  */
 int get_num_evict_target(int running_times) {
-    // Figure 7 experiment
-    int subcycle = running_times % 5000;
-    int lengthcycle = subcycle / 1000;
-    return (1 << (6 + lengthcycle));
+    struct rsec_strategy_inf *strategy = rsec_strategy_current(running_times);
+    int value = rsec_sweep_value(running_times, RSEC_SWEEP_AXIS_EVICT_NUMBER,
+                                 RSEC_SWEEP_UNSET);
+    if (value != RSEC_SWEEP_UNSET) return value;
+    return RSEC_STRATEGY_HOOK(strategy, num_evict_target)(strategy->state,
+                                                          running_times);
 }
 
 /**
  * get_mr_target - manually setups mr evict+reload target
  */
-int get_mr_target(int running_times, uint32_t *extra_rkey) { return 0; }
+int get_mr_target(int running_times, uint32_t *extra_rkey) {
+    struct rsec_strategy_inf *strategy = rsec_strategy_current(running_times);
+    return RSEC_STRATEGY_HOOK(strategy, mr_target)(strategy->state,
+                                                   running_times, extra_rkey);
+}
 
 /**
  * get_evict_mode - different evict mode - mr or pte
  */
-int get_evict_mode(running_times) {
-    return RSEC_PROBE_COLLISION_CHECK_MODE_STRIDE;  // pythia
+int get_evict_mode(int running_times) {
+    struct rsec_strategy_inf *strategy = rsec_strategy_current(running_times);
+    int value = rsec_sweep_value(running_times, RSEC_SWEEP_AXIS_EVICT_MODE,
+                                 RSEC_SWEEP_UNSET);
+    if (value != RSEC_SWEEP_UNSET) return value;
+    return RSEC_STRATEGY_HOOK(strategy, evict_mode)(strategy->state,
+                                                    running_times);
+}
+
+/**
+ * get_num_evict_qps - number of attack QPs used by the multi-QP eviction
+ * engines [rsec_evict.h]
+ */
+int get_num_evict_qps(int running_times) {
+    struct rsec_strategy_inf *strategy = rsec_strategy_current(running_times);
+    return RSEC_STRATEGY_HOOK(strategy, num_evict_qps)(strategy->state,
+                                                       running_times);
 }
@@ -0,0 +1,444 @@
+#include "rsec.h"
+
+/**
+ * rsec_evict.c: this code runs an eviction set against the remote RNIC.
+ * 1. rsec_evict_setup pre-builds every WR once per eviction set; request i
+ *    goes to lane i % num_lanes
+ * 2. rsec_evict_run keeps a sliding window of chunks in flight on every lane
+ *    and takes one completion per chunk
+ * Requests of one QP complete in order, so the completion of a chunk also
+ * retires every unsignaled request posted before it.
+ */
+
+static void *rsec_evict_worker(void *arg);
+
+/**
+ * rsec_evict_setup_lane - build the chunked WR list of one lane
+ * @evict: eviction engine
+ * @lane: lane to fill
+ * @evict_mr_list: eviction set
+ * @num_wr: length of evict_mr_list
+ * @extra_rkey: use this rkey for every request if non-zero
+ * @extra_offset: offset added to every remote address
+ */
+static void rsec_evict_setup_lane(struct rsec_evict_inf *evict,
+                                  struct rsec_evict_lane *lane,
+                                  struct ib_mr_attr **evict_mr_list,
+                                  int num_wr, uint32_t extra_rkey,
+                                  uint64_t extra_offset) {
+    int lane_id = lane - evict->lane;
+    struct ibv_send_wr *wr;
+    int i, j;
+    lane->evict = evict;
+    lane->num_wr = num_wr / evict->num_lanes +
+                   (lane_id < num_wr % evict->num_lanes ? 1 : 0);
+    lane->num_chunks = RSEC_ROUND_UP(lane->num_wr, RSEC_EVICT_CHUNK_SIZE) /
+                       RSEC_EVICT_CHUNK_SIZE;
+    // keep the allocations non-empty for an empty lane
+    lane->wr = malloc(sizeof(struct ibv_send_wr) * RSEC_MAX(lane->num_wr, 1));
+    lane->chunk_lat = malloc(sizeof(uint64_t) * RSEC_MAX(lane->num_chunks, 1));
+    lane->chunk_lat_sum =
+        malloc(sizeof(uint64_t) * RSEC_MAX(lane->num_chunks, 1));
+    assert(lane->wr && lane->chunk_lat && lane->chunk_lat_sum);
+    memset(lane->wr, 0, sizeof(struct ibv_send_wr) * RSEC_MAX(lane->num_wr, 1));
+    memset(lane->chunk_lat_sum, 0,
+           sizeof(uint64_t) * RSEC_MAX(lane->num_chunks, 1));
+
+    for (j = 0, i = lane_id; j < lane->num_wr; j++, i += evict->num_lanes) {
+        wr = &lane->wr[j];
+        if (RSEC_EVICT_MODE == RSEC_OPERATION_WRITE) {
+            wr->opcode = IBV_WR_RDMA_WRITE;
+            wr->send_flags = IBV_SEND_INLINE;
+        } else {
+            wr->opcode = IBV_WR_RDMA_READ;
+            wr->send_flags = 0;
+        }
+        wr->num_sge = 1;
+        wr->sg_list = &evict->sge;
+        wr->wr.rdma.remote_addr = evict_mr_list[i]->addr + extra_offset;
+        if (extra_rkey)
+            wr->wr.rdma.rkey = extra_rkey;
+        else
+            wr->wr.rdma.rkey = evict_mr_list[i]->rkey;
+        // last request of a chunk ends the chain and is the only signaled one
+        if ((j + 1) % RSEC_EVICT_CHUNK_SIZE == 0 || j == lane->num_wr - 1) {
+            wr->wr_id = j / RSEC_EVICT_CHUNK_SIZE;
+            wr->send_flags |= IBV_SEND_SIGNALED;
+            wr->next = NULL;
+        } else {
+            wr->next = &lane->wr[j + 1];
+        }
+    }
+}
+
+/**
+ * rsec_evict_setup - build an eviction engine for an eviction set
+ * @engine: RSEC_EVICT_ENGINE_*
+ * @qp_list: QP of every lane
+ * @cq_list: send CQ of every lane
+ * @num_lanes: length of qp_list/cq_list
+ * @local_mr: local buffer used by every request
+ * @evict_mr_list: eviction set
+ * @num_wr: length of evict_mr_list
+ * @extra_rkey: use this rkey for every request if non-zero
+ * @extra_offset: offset added to every remote address
+ */
+struct rsec_evict_inf *rsec_evict_setup(int engine, struct ibv_qp **qp_list,
+                                        struct ibv_cq **cq_list, int num_lanes,
+                                        struct ibv_mr *local_mr,
+                                        struct ib_mr_attr **evict_mr_list,
+                                        int num_wr, uint32_t extra_rkey,
+                                        uint64_t extra_offset) {
+    struct rsec_evict_inf *evict = malloc(sizeof(struct rsec_evict_inf));
+    struct rsec_evict_lane *lane;
+    int i;
+    assert(evict);
+    assert(num_wr >= 0 && num_lanes >= 1);
+    assert(engine != RSEC_EVICT_ENGINE_SINGLE_QP || num_lanes == 1);
+    assert(RSEC_EVICT_WINDOW * RSEC_EVICT_CHUNK_SIZE <= RSEC_CQ_DEPTH);
+    memset(evict, 0, sizeof(struct rsec_evict_inf));
+    evict->engine = engine;
+    evict->num_lanes = num_lanes;
+    evict->window = RSEC_EVICT_WINDOW;
+    evict->sge.length = RSEC_EVICT_MR_SIZE;
+    evict->sge.addr = (uintptr_t)local_mr->addr;
+    evict->sge.lkey = local_mr->lkey;
+    evict->lane = malloc(sizeof(struct rsec_evict_lane) * num_lanes);
+    assert(evict->lane);
+    memset(evict->lane, 0, sizeof(struct rsec_evict_lane) * num_lanes);
+
+    for (i = 0; i < num_lanes; i++) {
+        lane = &evict->lane[i];
+        lane->qp = qp_list[i];
+        lane->cq = cq_list[i];
+        rsec_evict_setup_lane(evict, lane, evict_mr_list, num_wr, extra_rkey,
+                              extra_offset);
+        if (engine != RSEC_EVICT_ENGINE_MULTI_THREAD) continue;
+        lane->core = RSEC_EVICT_WORKER_CORE + i;
+        if (pthread_create(&lane->worker, NULL, rsec_evict_worker, lane))
+            die_printf("[%s] failed to create worker %d\n", __func__, i);
+    }
+    return evict;
+}
+
+/**
+ * rsec_evict_post - post chunks of a lane until its window is full
+ * @lane: lane
+ * @posted: chunks posted so far
+ * @done: chunks completed so far
+ */
+static int rsec_evict_post(struct rsec_evict_lane *lane, int posted,
+                           int done) {
+    while (posted < lane->num_chunks && posted - done < lane->evict->window) {
+        userspace_one_preset(lane->qp,
+                             &lane->wr[posted * RSEC_EVICT_CHUNK_SIZE]);
+        posted++;
+    }
+    return posted;
+}
+
+/**
+ * rsec_evict_run_lane - run one lane to completion
+ * @lane: lane
+ * @start: start of the run (TSC)
+ */
+static void rsec_evict_run_lane(struct rsec_evict_lane *lane, uint64_t start) {
+    int posted = 0, done = 0;
+    while (done < lane->num_chunks) {
+        posted = rsec_evict_post(lane, posted, done);
+        userspace_one_poll(lane->cq, 1);
+        lane->chunk_lat[done] = rsec_time_end() - start;
+        lane->chunk_lat_sum[done] += lane->chunk_lat[done];
+        done++;
+    }
+}
+
+/**
+ * rsec_evict_run_lanes - run every lane from the calling thread
+ * Lanes are served round-robin; each pass tops up the window of a lane and
+ * takes whatever completions it already has.
+ * @evict: eviction engine
+ * @start: start of the run (TSC)
+ */
+static void rsec_evict_run_lanes(struct rsec_evict_inf *evict,
+                                 uint64_t start) {
+    struct ibv_wc wc[RSEC_EVICT_WINDOW];
+    int posted[evict->num_lanes], done[evict->num_lanes];
+    struct rsec_evict_lane *lane;
+    uint64_t end;
+    int i, comps, remaining = 0;
+    for (i = 0; i < evict->num_lanes; i++) {
+        posted[i] = done[i] = 0;
+        remaining += evict->lane[i].num_chunks;
+    }
+    while (remaining) {
+        for (i = 0; i < evict->num_lanes; i++) {
+            lane = &evict->lane[i];
+            if (done[i] == lane->num_chunks) continue;
+            posted[i] = rsec_evict_post(lane, posted[i], done[i]);
+            comps = userspace_one_try_poll(lane->cq, posted[i] - done[i], wc);
+            if (!comps) continue;
+            end = rsec_time_end();
+            for (; comps; comps--, done[i]++, remaining--) {
+                lane->chunk_lat[done[i]] = end - start;
+                lane->chunk_lat_sum[done[i]] += lane->chunk_lat[done[i]];
+            }
+        }
+    }
+}
+
+/**
+ * rsec_evict_worker - worker thread of one lane (MULTI_THREAD engine)
+ * Waits for a new run_seq, runs its lane and reports back in num_finished.
+ * @arg: lane
+ */
+static void *rsec_evict_worker(void *arg) {
+    struct rsec_evict_lane *lane = arg;
+    struct rsec_evict_inf *evict = lane->evict;
+    int seq = 0;
+    stick_this_thread_to_core(lane->core);
+    while (1) {
+        while (evict->run_seq == seq) RSEC_CPU_RELAX();
+        seq = evict->run_seq;
+        __sync_synchronize();
+        if (evict->stop) break;
+        rsec_evict_run_lane(lane, evict->start);
+        __sync_fetch_and_add(&evict->num_finished, 1);
+    }
+    return NULL;
+}
+
+/**
+ * rsec_evict_run - issue the whole eviction set once
+ * Returns the eviction latency (ns), i.e., the time until the last chunk of
+ * every lane completed. The completion time of every chunk is kept in the
+ * chunk_lat of its lane.
+ * @evict: eviction engine from rsec_evict_setup
+ */
+double rsec_evict_run(struct rsec_evict_inf *evict) {
+    uint64_t end;
+    evict->start = rsec_time_start();
+    switch (evict->engine) {
+        case RSEC_EVICT_ENGINE_SINGLE_QP:
+            rsec_evict_run_lane(&evict->lane[0], evict->start);
+            break;
+        case RSEC_EVICT_ENGINE_MULTI_QP:
+            rsec_evict_run_lanes(evict, evict->start);
+            break;
+        case RSEC_EVICT_ENGINE_MULTI_THREAD:
+            evict->num_finished = 0;
+            __sync_synchronize();
+            __sync_fetch_and_add(&evict->run_seq, 1);
+            while (evict->num_finished != evict->num_lanes) RSEC_CPU_RELAX();
+            break;
+        default:
+            die_printf("[%s] engine %d error\n", __func__, evict->engine);
+    }
+    end = rsec_time_end();
+    evict->num_runs++;
+    rsec_time_acc_add(rsec_time_thread_acc(RSEC_TIME_EVICT),
+                      end - evict->start);
+    return RSEC_CYCLES_TO_NS(end - evict->start);
+}
+
+/**
+ * rsec_evict_print_chunks - print the average completion time of every chunk,
+ * lanes are separated by '|'
+ * @evict: eviction engine
+ * @iteration: current iteration
+ */
+void rsec_evict_print_chunks(struct rsec_evict_inf *evict, int iteration) {
+    char line[RSEC_MAX_QP_NAME * 4];
+    struct rsec_evict_lane *lane;
+    int i, j, len = 0;
+    if (!evict->num_runs) return;
+    line[0] = 0;
+    for (i = 0; i < evict->num_lanes && len < (int)sizeof(line); i++) {
+        lane = &evict->lane[i];
+        if (i) len += snprintf(line + len, sizeof(line) - len, " |");
+        for (j = 0; j < lane->num_chunks && len < (int)sizeof(line); j++)
+            len += snprintf(line + len, sizeof(line) - len, " %0.2f",
+                            RSEC_NS_TO_US(RSEC_CYCLES_TO_NS(
+                                lane->chunk_lat_sum[j] / evict->num_runs)));
+    }
+    RSEC_PRINT("%d\tevict %s:\t%d lanes x %d (window %d)\tdone(us):%s\n",
+               iteration, rsec_evict_engine_text[evict->engine],
+               evict->num_lanes, RSEC_EVICT_CHUNK_SIZE, evict->window, line);
+}
+
+/**
+ * rsec_evict_free - stop the workers and release an eviction engine
+ * @evict: eviction engine
+ */
+void rsec_evict_free(struct rsec_evict_inf *evict) {
+    int i;
+    if (evict == NULL) return;
+    if (evict->engine == RSEC_EVICT_ENGINE_MULTI_THREAD) {
+        evict->stop = 1;
+        __sync_synchronize();
+        __sync_fetch_and_add(&evict->run_seq, 1);
+        for (i = 0; i < evict->num_lanes; i++)
+            pthread_join(evict->lane[i].worker, NULL);
+    }
+    for (i = 0; i < evict->num_lanes; i++) {
+        free(evict->lane[i].wr);
+        free(evict->lane[i].chunk_lat);
+        free(evict->lane[i].chunk_lat_sum);
+    }
+    free(evict->lane);
+    free(evict);
+}
+
+/**
+ * rsec_evict_key_hash - FNV-1a over the key bytes
+ */
+static guint rsec_evict_key_hash(gconstpointer data) {
+    return rsec_fnv1a(data, sizeof(struct rsec_evict_key));
+}
+
+/**
+ * rsec_evict_key_equal - keys are compared byte by byte
+ */
+static gboolean rsec_evict_key_equal(gconstpointer a, gconstpointer b) {
+    return !memcmp(a, b, sizeof(struct rsec_evict_key));
+}
+
+/**
+ * rsec_evict_cache_setup - create an empty eviction engine cache
+ * @engine: RSEC_EVICT_ENGINE_* of the cached engines
+ */
+struct rsec_evict_cache *rsec_evict_cache_setup(int engine) {
+    struct rsec_evict_cache *cache = malloc(sizeof(struct rsec_evict_cache));
+    assert(cache);
+    memset(cache, 0, sizeof(struct rsec_evict_cache));
+    cache->capacity = engine == RSEC_EVICT_ENGINE_MULTI_THREAD
+                          ? 1
+                          : RSEC_EVICT_CACHE_SIZE;
+    cache->table = g_hash_table_new(rsec_evict_key_hash, rsec_evict_key_equal);
+    return cache;
+}
+
+/**
+ * rsec_evict_cache_unlink - take an entry out of the LRU list
+ */
+static void rsec_evict_cache_unlink(struct rsec_evict_cache *cache,
+                                    struct rsec_evict_cache_entry *entry) {
+    if (entry->prev)
+        entry->prev->next = entry->next;
+    else
+        cache->head = entry->next;
+    if (entry->next)
+        entry->next->prev = entry->prev;
+    else
+        cache->tail = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+/**
+ * rsec_evict_cache_push - put an entry at the head of the LRU list
+ */
+static void rsec_evict_cache_push(struct rsec_evict_cache *cache,
+                                  struct rsec_evict_cache_entry *entry) {
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head) cache->head->prev = entry;
+    cache->head = entry;
+    if (cache->tail == NULL) cache->tail = entry;
+}
+
+/**
+ * rsec_evict_cache_drop - release an entry, its engine and its eviction set
+ */
+static void rsec_evict_cache_drop(struct rsec_evict_cache *cache,
+                                  struct rsec_evict_cache_entry *entry) {
+    rsec_evict_cache_unlink(cache, entry);
+    g_hash_table_remove(cache->table, &entry->key);
+    cache->num_entries--;
+    rsec_evict_free(entry->evict);
+    free(entry->mr_list);
+    free(entry);
+}
+
+/**
+ * rsec_evict_cache_lookup - find a built engine
+ * Returns NULL on miss. On hit, the entry becomes the most recently used and
+ * the chunk statistics of its engine start over.
+ * @cache: eviction engine cache
+ * @key: key from rsec_attack_sub_mr_key
+ */
+struct rsec_evict_cache_entry *rsec_evict_cache_lookup(
+    struct rsec_evict_cache *cache, struct rsec_evict_key *key) {
+    struct rsec_evict_cache_entry *entry;
+    int i;
+    entry = g_hash_table_lookup(cache->table, key);
+    if (entry == NULL) {
+        cache->num_misses++;
+        return NULL;
+    }
+    cache->num_hits++;
+    rsec_evict_cache_unlink(cache, entry);
+    rsec_evict_cache_push(cache, entry);
+    entry->evict->num_runs = 0;
+    for (i = 0; i < entry->evict->num_lanes; i++)
+        memset(entry->evict->lane[i].chunk_lat_sum, 0,
+               sizeof(uint64_t) *
+                   RSEC_MAX(entry->evict->lane[i].num_chunks, 1));
+    return entry;
+}
+
+/**
+ * rsec_evict_cache_insert - add a built engine, dropping the least recently
+ * used one if the cache is full
+ * The cache owns evict from now on and keeps a copy of mr_list, which may
+ * live in a per-iteration arena.
+ * @cache: eviction engine cache
+ * @key: key from rsec_attack_sub_mr_key
+ * @evict: engine from rsec_evict_setup
+ * @mr_list: eviction set of evict
+ * @num_mr: length of mr_list
+ * @index_set: index information of the eviction set
+ */
+struct rsec_evict_cache_entry *rsec_evict_cache_insert(
+    struct rsec_evict_cache *cache, struct rsec_evict_key *key,
+    struct rsec_evict_inf *evict, struct ib_mr_attr **mr_list, int num_mr,
+    struct return_int *index_set) {
+    struct rsec_evict_cache_entry *entry;
+    struct ib_mr_attr *mr_space;
+    int i;
+    assert(g_hash_table_lookup(cache->table, key) == NULL);
+    if (cache->num_entries == cache->capacity)
+        rsec_evict_cache_drop(cache, cache->tail);
+    entry = malloc(sizeof(struct rsec_evict_cache_entry));
+    assert(entry);
+    memset(entry, 0, sizeof(struct rsec_evict_cache_entry));
+    memcpy(&entry->key, key, sizeof(struct rsec_evict_key));
+    entry->evict = evict;
+    // pointer array and entries in one block
+    entry->mr_list = malloc((sizeof(struct ib_mr_attr *) +
+                             sizeof(struct ib_mr_attr)) * RSEC_MAX(num_mr, 1));
+    assert(entry->mr_list);
+    mr_space = (struct ib_mr_attr *)(entry->mr_list + RSEC_MAX(num_mr, 1));
+    for (i = 0; i < num_mr; i++) {
+        memcpy(&mr_space[i], mr_list[i], sizeof(struct ib_mr_attr));
+        entry->mr_list[i] = &mr_space[i];
+    }
+    entry->num_mr = num_mr;
+    memcpy(&entry->index_set, index_set, sizeof(struct return_int));
+    g_hash_table_insert(cache->table, &entry->key, entry);
+    rsec_evict_cache_push(cache, entry);
+    cache->num_entries++;
+    return entry;
+}
+
+/**
+ * rsec_evict_cache_free - print the hit rate and release every entry
+ * @cache: eviction engine cache
+ */
+void rsec_evict_cache_free(struct rsec_evict_cache *cache) {
+    if (cache == NULL) return;
+    RSEC_PRINT("evict cache: %d hits %d misses (capacity %d)\n",
+               cache->num_hits, cache->num_misses, cache->capacity);
+    while (cache->head) rsec_evict_cache_drop(cache, cache->head);
+    g_hash_table_destroy(cache->table);
+    free(cache);
+}
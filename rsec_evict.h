@@ -0,0 +1,135 @@
+#ifndef RSEC_EVICT_HEADER
+#define RSEC_EVICT_HEADER
+
+#include <glib.h>
+#include <infiniband/verbs.h>
+#include <pthread.h>
+#include <stdint.h>
+#include "rsec_struct.h"
+
+/**
+ * rsec_evict.h: pipelined eviction engine.
+ * The eviction set is striped over one or more lanes (a QP with its own CQ).
+ * Inside a lane, requests are cut into chunks of RSEC_EVICT_CHUNK_SIZE and only
+ * the last request of a chunk is signaled. Up to RSEC_EVICT_WINDOW chunks are
+ * in flight per lane, so the send queue (RSEC_CQ_DEPTH entries) never drains
+ * between chunks; a new chunk is posted as soon as an older one completes.
+ * 1. RSEC_EVICT_ENGINE_SINGLE_QP - one lane on the helper QP
+ * 2. RSEC_EVICT_ENGINE_MULTI_QP - lanes on the attack QPs, one polling thread
+ * 3. RSEC_EVICT_ENGINE_MULTI_THREAD - lanes on the attack QPs, one pinned
+ *    worker thread per lane
+ * Built engines are kept in an LRU cache (struct rsec_evict_cache) keyed by
+ * the parameters that decide the eviction set, so targets in the same bucket
+ * reuse the posted WR chains instead of building them again.
+ */
+
+#define RSEC_EVICT_ENGINE_SINGLE_QP 1
+#define RSEC_EVICT_ENGINE_MULTI_QP 2
+#define RSEC_EVICT_ENGINE_MULTI_THREAD 3
+#define RSEC_EVICT_ENGINE RSEC_EVICT_ENGINE_SINGLE_QP
+static const char *const rsec_evict_engine_text[] = {
+    "------RSEC STRING------", "RSEC_EVICT_ENGINE_SINGLE_QP",
+    "RSEC_EVICT_ENGINE_MULTI_QP", "RSEC_EVICT_ENGINE_MULTI_THREAD"};
+
+#define RSEC_EVICT_CHUNK_SIZE 64
+#define RSEC_EVICT_WINDOW (RSEC_CQ_DEPTH / RSEC_EVICT_CHUNK_SIZE)
+// number of attack QPs of the multi-QP engines [get_num_evict_qps]
+#define RSEC_EVICT_NUM_QPS 8
+// worker of lane i is pinned to core RSEC_EVICT_WORKER_CORE + i
+#define RSEC_EVICT_WORKER_CORE 4
+// cached engines; MULTI_THREAD keeps one (its workers spin while cached)
+#define RSEC_EVICT_CACHE_SIZE 16
+
+struct rsec_evict_inf;
+
+struct rsec_evict_lane {
+    struct rsec_evict_inf *evict;
+    struct ibv_qp *qp;
+    struct ibv_cq *cq;
+
+    /* chunk c starts at wr[c * RSEC_EVICT_CHUNK_SIZE] */
+    struct ibv_send_wr *wr;
+    int num_wr;
+    int num_chunks;
+
+    /* completion time of each chunk since the start of the run (cycles) */
+    uint64_t *chunk_lat;
+    uint64_t *chunk_lat_sum;
+
+    pthread_t worker;
+    int core;
+};
+
+struct rsec_evict_inf {
+    int engine;
+    int num_lanes;
+    int window;
+    struct ibv_sge sge;
+    struct rsec_evict_lane *lane;
+    int num_runs;
+
+    /* run control of the worker threads */
+    uint64_t start; /* TSC */
+    volatile int run_seq;
+    volatile int num_finished;
+    volatile int stop;
+};
+
+/* everything that decides an eviction set and its engine, memset before use */
+struct rsec_evict_key {
+    int strategy;
+    int stride;
+    int offset[2];
+    int num_offsets;
+    int size;
+    /* stride positions skipped around the target, -1 if none */
+    long skip_first;
+    long skip_last;
+    int test_mode;
+    int num_lanes;
+    int opcode;
+};
+
+struct rsec_evict_cache_entry {
+    struct rsec_evict_key key;
+    struct rsec_evict_inf *evict;
+    /* eviction set, mr_list[0] holds the whole set */
+    struct ib_mr_attr **mr_list;
+    int num_mr;
+    struct return_int index_set;
+
+    /* LRU list, head is the most recently used */
+    struct rsec_evict_cache_entry *prev;
+    struct rsec_evict_cache_entry *next;
+};
+
+struct rsec_evict_cache {
+    int capacity;
+    int num_entries;
+    /* struct rsec_evict_key -> struct rsec_evict_cache_entry */
+    GHashTable *table;
+    struct rsec_evict_cache_entry *head;
+    struct rsec_evict_cache_entry *tail;
+    int num_hits;
+    int num_misses;
+};
+
+struct rsec_evict_inf *rsec_evict_setup(int engine, struct ibv_qp **qp_list,
+                                        struct ibv_cq **cq_list, int num_lanes,
+                                        struct ibv_mr *local_mr,
+                                        struct ib_mr_attr **evict_mr_list,
+                                        int num_wr, uint32_t extra_rkey,
+                                        uint64_t extra_offset);
+double rsec_evict_run(struct rsec_evict_inf *evict);
+void rsec_evict_print_chunks(struct rsec_evict_inf *evict, int iteration);
+void rsec_evict_free(struct rsec_evict_inf *evict);
+struct rsec_evict_cache *rsec_evict_cache_setup(int engine);
+struct rsec_evict_cache_entry *rsec_evict_cache_lookup(
+    struct rsec_evict_cache *cache, struct rsec_evict_key *key);
+struct rsec_evict_cache_entry *rsec_evict_cache_insert(
+    struct rsec_evict_cache *cache, struct rsec_evict_key *key,
+    struct rsec_evict_inf *evict, struct ib_mr_attr **mr_list, int num_mr,
+    struct return_int *index_set);
+void rsec_evict_cache_free(struct rsec_evict_cache *cache);
+
+#endif
@@ -0,0 +1,130 @@
+#include "rsec.h"
+
+/**
+ * rsec_hwts.c: this code times one RDMA read of the reload target.
+ * With RSEC_RELOAD_TIMER_HW the latency is taken between two readings of the
+ * NIC clock: the free-running clock right before the doorbell and the
+ * timestamp written into the completion. Neither polling jitter nor the
+ * compiler's instruction ordering shows up in the result.
+ */
+
+/**
+ * ib_create_ts_cq - create a CQ which reports completion timestamps
+ * Falls back to a regular CQ if the device does not support it.
+ * @inf: RDMA context
+ * @cq_index: index in conn_cq/conn_cq_ex
+ */
+struct ibv_cq *ib_create_ts_cq(struct ib_inf *inf, int cq_index) {
+    struct ibv_cq_init_attr_ex cq_attr;
+    inf->conn_cq_ex[cq_index] = NULL;
+    if (RSEC_RELOAD_TIMER == RSEC_RELOAD_TIMER_HW && !rnic_sim_enabled) {
+        memset(&cq_attr, 0, sizeof(struct ibv_cq_init_attr_ex));
+        cq_attr.cqe = RSEC_CQ_DEPTH;
+        cq_attr.wc_flags = RSEC_HWTS_CQ_FLAGS;
+        inf->conn_cq_ex[cq_index] = ibv_create_cq_ex(inf->ctx, &cq_attr);
+        if (inf->conn_cq_ex[cq_index])
+            return ibv_cq_ex_to_cq(inf->conn_cq_ex[cq_index]);
+    }
+    return ibv_create_cq(inf->ctx, RSEC_CQ_DEPTH, NULL, NULL, 0);
+}
+
+/**
+ * rsec_hwts_setup - select the reload timer of a QP
+ * @inf: RDMA context
+ * @cq_index: index of the send CQ of the reload QP in conn_cq
+ */
+struct rsec_hwts_inf *rsec_hwts_setup(struct ib_inf *inf, int cq_index) {
+    struct rsec_hwts_inf *hwts = malloc(sizeof(struct rsec_hwts_inf));
+    struct ibv_device_attr_ex device_attr;
+    struct ibv_values_ex values;
+    assert(hwts);
+    memset(hwts, 0, sizeof(struct rsec_hwts_inf));
+    hwts->mode = RSEC_RELOAD_TIMER;
+    hwts->ctx = inf->ctx;
+    if (hwts->mode == RSEC_RELOAD_TIMER_HW) {
+        memset(&device_attr, 0, sizeof(struct ibv_device_attr_ex));
+        values.comp_mask = IBV_VALUES_MASK_RAW_CLOCK;
+        hwts->cq_ex = inf->conn_cq_ex[cq_index];
+        if (hwts->cq_ex == NULL || rnic_sim_enabled ||
+            ibv_query_device_ex(inf->ctx, NULL, &device_attr) ||
+            !device_attr.hca_core_clock ||
+            ibv_query_rt_values_ex(inf->ctx, &values)) {
+            RSEC_PRINT("no completion timestamps, fall back to TSC\n");
+            hwts->mode = RSEC_RELOAD_TIMER_TSC;
+            hwts->cq_ex = NULL;
+        } else {
+            hwts->hca_core_clock = device_attr.hca_core_clock;
+            hwts->timestamp_mask = device_attr.completion_timestamp_mask;
+            if (!hwts->timestamp_mask) hwts->timestamp_mask = ~0ULL;
+        }
+    }
+    if (hwts->mode == RSEC_RELOAD_TIMER_TSC) rsec_time_init();
+    RSEC_PRINT("RELOAD_TIMER: %s (hca clock %lu kHz, tsc %0.3f/ns)\n",
+               rsec_reload_timer_text[hwts->mode],
+               (unsigned long)hwts->hca_core_clock, rsec_tsc_per_ns);
+    return hwts;
+}
+
+/**
+ * rsec_hwts_read_hw - time one RDMA read with NIC timestamps
+ */
+static double rsec_hwts_read_hw(struct rsec_hwts_inf *hwts, struct ibv_qp *qp,
+                                struct ibv_mr *local_mr, int request_size,
+                                struct ib_mr_attr *remote_mr,
+                                unsigned long long offset) {
+    struct ibv_poll_cq_attr poll_attr = {.comp_mask = 0};
+    struct ibv_values_ex values = {.comp_mask = IBV_VALUES_MASK_RAW_CLOCK};
+    uint64_t start, end;
+    int ret;
+    ibv_query_rt_values_ex(hwts->ctx, &values);
+    // the raw clock is reported in cycles through the timespec
+    start = (uint64_t)values.raw_clock.tv_sec * 1000 * 1000 * 1000 +
+            values.raw_clock.tv_nsec;
+    userspace_one_read(qp, local_mr, request_size, remote_mr, offset);
+    while ((ret = ibv_start_poll(hwts->cq_ex, &poll_attr)) == ENOENT)
+        RSEC_CPU_RELAX();
+    CPE(ret, "ibv_start_poll error", ret);
+    if (hwts->cq_ex->status != IBV_WC_SUCCESS)
+        die_printf("Bad wc status %d\n", hwts->cq_ex->status);
+    end = ibv_wc_read_completion_ts(hwts->cq_ex);
+    ibv_end_poll(hwts->cq_ex);
+    return (double)((end - start) & hwts->timestamp_mask) * 1000 * 1000 /
+           hwts->hca_core_clock;
+}
+
+/**
+ * rsec_hwts_read - issue one RDMA read and return its latency (ns)
+ * @hwts: reload timer
+ * @qp: QP of the read
+ * @cq: send CQ of qp
+ * @local_mr: local buffer
+ * @request_size: size of the read
+ * @remote_mr: remote target
+ * @offset: offset in remote_mr
+ */
+double rsec_hwts_read(struct rsec_hwts_inf *hwts, struct ibv_qp *qp,
+                      struct ibv_cq *cq, struct ibv_mr *local_mr,
+                      int request_size, struct ib_mr_attr *remote_mr,
+                      unsigned long long offset) {
+    struct timespec start, end;
+    uint64_t tsc_start, tsc_end;
+    switch (hwts->mode) {
+        case RSEC_RELOAD_TIMER_HW:
+            return rsec_hwts_read_hw(hwts, qp, local_mr, request_size,
+                                     remote_mr, offset);
+        case RSEC_RELOAD_TIMER_TSC:
+            tsc_start = rsec_time_start();
+            userspace_one_read(qp, local_mr, request_size, remote_mr, offset);
+            userspace_one_poll(cq, 1);
+            tsc_end = rsec_time_end();
+            rsec_time_acc_add(rsec_time_thread_acc(RSEC_TIME_RELOAD),
+                              tsc_end - tsc_start);
+            return RSEC_CYCLES_TO_NS(tsc_end - tsc_start);
+        default:
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            userspace_one_read(qp, local_mr, request_size, remote_mr, offset);
+            userspace_one_poll(cq, 1);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            return diff_ns(&start, &end);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef RSEC_HWTS_HEADER
+#define RSEC_HWTS_HEADER
+
+#include <infiniband/verbs.h>
+#include "rsec_struct.h"
+
+/**
+ * rsec_hwts.h: reload latency measurement.
+ * 1. RSEC_RELOAD_TIMER_CLOCK - clock_gettime around post + poll
+ * 2. RSEC_RELOAD_TIMER_TSC - fenced TSC around post + poll (rsec_time.h)
+ * 3. RSEC_RELOAD_TIMER_HW - NIC clock read right before the post and the
+ *    completion timestamp of an extended CQ, converted with hca_core_clock
+ * RSEC_RELOAD_TIMER_HW falls back to RSEC_RELOAD_TIMER_TSC if the device (or
+ * the data path, e.g., rnic_sim) does not provide completion timestamps.
+ */
+
+#define RSEC_RELOAD_TIMER_CLOCK 1
+#define RSEC_RELOAD_TIMER_TSC 2
+#define RSEC_RELOAD_TIMER_HW 3
+#define RSEC_RELOAD_TIMER RSEC_RELOAD_TIMER_HW
+static const char *const rsec_reload_timer_text[] = {
+    "------RSEC STRING------", "RSEC_RELOAD_TIMER_CLOCK",
+    "RSEC_RELOAD_TIMER_TSC", "RSEC_RELOAD_TIMER_HW"};
+
+#define RSEC_HWTS_CQ_FLAGS \
+    (IBV_WC_STANDARD_FLAGS | IBV_WC_EX_WITH_COMPLETION_TIMESTAMP)
+
+struct rsec_hwts_inf {
+    int mode;
+    struct ibv_context *ctx;
+    struct ibv_cq_ex *cq_ex;
+    uint64_t hca_core_clock; /* kHz */
+    uint64_t timestamp_mask;
+};
+
+struct ibv_cq *ib_create_ts_cq(struct ib_inf *inf, int cq_index);
+struct rsec_hwts_inf *rsec_hwts_setup(struct ib_inf *inf, int cq_index);
+double rsec_hwts_read(struct rsec_hwts_inf *hwts, struct ibv_qp *qp,
+                      struct ibv_cq *cq, struct ibv_mr *local_mr,
+                      int request_size, struct ib_mr_attr *remote_mr,
+                      unsigned long long offset);
+
+#endif
@@ -0,0 +1,252 @@
+#include "rsec.h"
+
+/**
+ * rsec_log.c: the ring holds RSEC_LOG_RING_SIZE records indexed by free
+ * running head/tail counters. The attacker publishes a record by advancing
+ * head (release) and the writer frees slots by advancing tail (release), so
+ * no lock is taken on either side. If the writer falls a whole ring behind,
+ * the attacker waits for a slot; num_stalls reports how often this happened.
+ */
+
+/**
+ * rsec_log_writer - background writer thread
+ * Writes every published record, in batches up to the end of the ring, and
+ * exits once stop is set and the ring is empty.
+ * @arg: log
+ */
+static void *rsec_log_writer(void *arg) {
+    struct rsec_log_inf *log = arg;
+    uint64_t head, tail = log->tail;
+    size_t num, first;
+    int stop;
+    while (1) {
+        // stop is read before head so that the last records are not missed
+        stop = __atomic_load_n(&log->stop, __ATOMIC_ACQUIRE);
+        head = __atomic_load_n(&log->head, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            if (stop) break;
+            usleep(RSEC_LOG_IDLE_US);
+            continue;
+        }
+        first = tail & (RSEC_LOG_RING_SIZE - 1);
+        num = RSEC_MIN(head - tail, RSEC_LOG_RING_SIZE - first);
+        if (fwrite(&log->ring[first], sizeof(struct rsec_log_record), num,
+                   log->fp) != num)
+            RSEC_ERROR("short write of %zu records\n", num);
+        tail += num;
+        __atomic_store_n(&log->tail, tail, __ATOMIC_RELEASE);
+    }
+    fflush(log->fp);
+    return NULL;
+}
+
+/**
+ * rsec_log_setup - create the log file and start its writer
+ * Returns NULL if the file cannot be created.
+ * @file_name: log file
+ */
+struct rsec_log_inf *rsec_log_setup(const char *file_name) {
+    struct rsec_log_header header;
+    struct rsec_log_inf *log;
+    FILE *fp = fopen(file_name, "wb");
+    if (fp == NULL) {
+        RSEC_ERROR("fail to create %s\n", file_name);
+        return NULL;
+    }
+    memset(&header, 0, sizeof(struct rsec_log_header));
+    header.magic = RSEC_LOG_MAGIC;
+    header.version = RSEC_LOG_VERSION;
+    header.record_size = sizeof(struct rsec_log_record);
+    header.start_time = (uint64_t)time(NULL);
+    header.mr_number = RSEC_MR_NUMBER;
+    header.mr_size = RSEC_MR_SIZE;
+    header.running_times = RSEC_ACCESS_TEST_RUNNING_TIMES;
+    header.access_test_time = RSEC_ACCESS_TEST_TIME;
+    header.exp_mode = RSEC_EXP_MODE;
+    header.collision_check_mode = RSEC_PROBE_COLLISION_CHECK_MODE;
+    header.evict_engine = RSEC_EVICT_ENGINE;
+    header.evict_mode = RSEC_EVICT_MODE;
+    header.calib_mode = RSEC_CALIB_MODE;
+    header.classify_model = RSEC_CLASSIFY_MODEL;
+    if (rsec_sweep) {
+        header.sweep_points = rsec_sweep->num_points;
+        header.sweep_repetitions = rsec_sweep->repetitions;
+    }
+    fwrite(&header, sizeof(struct rsec_log_header), 1, fp);
+
+    log = malloc(sizeof(struct rsec_log_inf));
+    assert(log);
+    memset(log, 0, sizeof(struct rsec_log_inf));
+    log->fp = fp;
+    log->ring = malloc(sizeof(struct rsec_log_record) * RSEC_LOG_RING_SIZE);
+    assert(log->ring);
+    if (pthread_create(&log->writer, NULL, rsec_log_writer, log))
+        die_printf("[%s] failed to create writer\n", __func__);
+    return log;
+}
+
+/**
+ * rsec_log_push - hand a record over to the writer
+ * @log: log
+ * @record: record (copied)
+ */
+void rsec_log_push(struct rsec_log_inf *log, struct rsec_log_record *record) {
+    uint64_t head = log->head;
+    while (head - __atomic_load_n(&log->tail, __ATOMIC_ACQUIRE) ==
+           RSEC_LOG_RING_SIZE) {
+        log->num_stalls++;
+        RSEC_CPU_RELAX();
+    }
+    memcpy(&log->ring[head & (RSEC_LOG_RING_SIZE - 1)], record,
+           sizeof(struct rsec_log_record));
+    __atomic_store_n(&log->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * rsec_log_close - write the remaining records and close the log
+ * @log: log
+ */
+void rsec_log_close(struct rsec_log_inf *log) {
+    if (log == NULL) return;
+    __atomic_store_n(&log->stop, 1, __ATOMIC_RELEASE);
+    pthread_join(log->writer, NULL);
+    RSEC_PRINT("log: %lu records, %lu stalls\n", (unsigned long)log->head,
+               (unsigned long)log->num_stalls);
+    fclose(log->fp);
+    free(log->ring);
+    free(log);
+}
+
+/**
+ * rsec_log_text - name of a mode read from a log
+ * A value outside of the text array (corrupt log) is printed as a number.
+ * @text: names of the mode
+ * @num_text: length of text
+ * @value: mode
+ * @buffer: RSEC_LOG_TEXT_LENGTH bytes for an unknown value
+ */
+static const char *rsec_log_text(const char *const *text, int num_text,
+                                 int value, char *buffer) {
+    if (value >= 0 && value < num_text) return text[value];
+    snprintf(buffer, RSEC_LOG_TEXT_LENGTH, "%d", value);
+    return buffer;
+}
+#define RSEC_LOG_TEXT(text, value, buffer) \
+    rsec_log_text(text, sizeof(text) / sizeof(text[0]), value, buffer)
+
+/**
+ * rsec_log_format - format a record as the result line of attacker_code
+ * Returns the length of the line.
+ * @line: return the line
+ * @length: size of line
+ * @record: record
+ */
+int rsec_log_format(char *line, int length, struct rsec_log_record *record) {
+    char status[RSEC_LOG_TEXT_LENGTH], test_mode[RSEC_LOG_TEXT_LENGTH];
+    char stride_strategy[RSEC_LOG_TEXT_LENGTH];
+    return snprintf(
+        line, length,
+        "%d\t%d\t%s\t%s \t %0.2f\t%d/%d\tevict lat:\t%0.2f\t "
+        "%llx\t%lx\t%lx\t%0.2f(%0.2f-%0.2f)\t%0.2f(%0.2f-%0.2f)"
+        "\tindex:\t%ld\t%ld\t%ld\t%ld\t%d"
+        "\tpoint:\t%d\t%d\t%d\t%s\t%d\t%d\n",
+        record->running_time, record->access_target,
+        RSEC_LOG_TEXT(rsec_log_status_text, record->status, status),
+        RSEC_LOG_TEXT(rsec_experiment_evict_mode, record->test_mode,
+                      test_mode),
+        ((float)record->count) / record->num_trials, record->count,
+        record->num_trials, record->evict_lat_us,
+        (long long unsigned int)record->addr, (long unsigned int)record->rkey,
+        (unsigned long)record->evict_rkey, record->lat_evict,
+        record->thr_evict, record->avg_evict, record->lat_hit,
+        record->thr_hit, record->avg_hit, (long)record->index_first,
+        (long)record->index_last, (long)record->index_distance,
+        (long)record->real_distance, record->num_evict_mr, record->point,
+        record->value_size, record->evict_target,
+        RSEC_LOG_TEXT(rsec_probe_stride_strategy, record->stride_strategy,
+                      stride_strategy),
+        record->stride_distance, record->strategy);
+}
+
+/**
+ * rsec_log_decode - print a binary log as text
+ * Returns 0 on success.
+ * @file_name: log file
+ */
+int rsec_log_decode(const char *file_name) {
+    struct rsec_log_header header;
+    struct rsec_log_record record;
+    char line[RSEC_LOG_LINE_LENGTH];
+    char text[5][RSEC_LOG_TEXT_LENGTH];
+    long num_records = 0;
+    FILE *fp = fopen(file_name, "rb");
+    if (fp == NULL) {
+        RSEC_ERROR("fail to open %s\n", file_name);
+        return -1;
+    }
+    if (fread(&header, sizeof(struct rsec_log_header), 1, fp) != 1 ||
+        header.magic != RSEC_LOG_MAGIC || header.version != RSEC_LOG_VERSION ||
+        header.record_size != sizeof(struct rsec_log_record)) {
+        RSEC_ERROR("%s is not a version %d log\n", file_name,
+                   RSEC_LOG_VERSION);
+        fclose(fp);
+        return -1;
+    }
+    printf("# start %lu MR %ld x %ld running_times %d trials %d\n",
+           (unsigned long)header.start_time, (long)header.mr_number,
+           (long)header.mr_size, header.running_times,
+           header.access_test_time);
+    printf("# %s %s %s evict %d %s %s\n",
+           RSEC_LOG_TEXT(rsec_experiment_mode_text, header.exp_mode, text[0]),
+           RSEC_LOG_TEXT(rsec_experiment_evict_mode,
+                         header.collision_check_mode, text[1]),
+           RSEC_LOG_TEXT(rsec_evict_engine_text, header.evict_engine, text[2]),
+           header.evict_mode,
+           RSEC_LOG_TEXT(rsec_calib_mode_text, header.calib_mode, text[3]),
+           RSEC_LOG_TEXT(rsec_classify_model_text, header.classify_model,
+                         text[4]));
+    if (header.sweep_points)
+        printf("# sweep %d points x %d repetitions\n", header.sweep_points,
+               header.sweep_repetitions);
+    while (fread(&record, sizeof(struct rsec_log_record), 1, fp) == 1) {
+        rsec_log_format(line, RSEC_LOG_LINE_LENGTH, &record);
+        fputs(line, stdout);
+        num_records++;
+    }
+    printf("# %ld records\n", num_records);
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * rsec_log_copy_file - copy a file (source snapshot of a run)
+ * Returns 0 on success.
+ * @src: source file
+ * @dst: destination file
+ */
+int rsec_log_copy_file(const char *src, const char *dst) {
+    char buffer[RSEC_LOG_COPY_BUFFER];
+    FILE *fp_src, *fp_dst;
+    size_t len;
+    int ret = 0;
+    fp_src = fopen(src, "rb");
+    if (fp_src == NULL) {
+        RSEC_ERROR("fail to open %s\n", src);
+        return -1;
+    }
+    fp_dst = fopen(dst, "wb");
+    if (fp_dst == NULL) {
+        RSEC_ERROR("fail to create %s\n", dst);
+        fclose(fp_src);
+        return -1;
+    }
+    while ((len = fread(buffer, 1, RSEC_LOG_COPY_BUFFER, fp_src)) > 0) {
+        if (fwrite(buffer, 1, len, fp_dst) != len) {
+            ret = -1;
+            break;
+        }
+    }
+    fclose(fp_src);
+    fclose(fp_dst);
+    return ret;
+}
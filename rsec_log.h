@@ -0,0 +1,107 @@
+#ifndef RSEC_LOG_HEADER
+#define RSEC_LOG_HEADER
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * rsec_log.h: binary result log of the attacker.
+ * The file starts with a struct rsec_log_header describing the configuration
+ * of the run, followed by one fixed-size struct rsec_log_record per
+ * running_time. The attacker only copies the record into a single-producer
+ * single-consumer ring; a background writer thread drains the ring to the
+ * file in batches. Use `-D <file>` to decode a log into the text lines the
+ * attacker prints.
+ */
+
+#define RSEC_LOG_MAGIC 0x474c5352u  // "RSLG"
+#define RSEC_LOG_VERSION 3
+#define RSEC_LOG_FILE_STRING "microbenchmark-%lu.bin"
+// records in the ring (power of two)
+#define RSEC_LOG_RING_SIZE 4096
+// writer sleeps this long when the ring is empty
+#define RSEC_LOG_IDLE_US 200
+#define RSEC_LOG_LINE_LENGTH 512
+// an unknown mode of a decoded log is printed as its number
+#define RSEC_LOG_TEXT_LENGTH 16
+#define RSEC_LOG_COPY_BUFFER 65536
+
+#define RSEC_LOG_STATUS_SUCCESS 1
+#define RSEC_LOG_STATUS_FAIL 2
+#define RSEC_LOG_STATUS_NOTENOUGH 3
+static const char *const rsec_log_status_text[] = {
+    "------RSEC STRING------", "success", "fail", "notenough"};
+
+/* configuration of the run - written once at the start of the file */
+struct rsec_log_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint64_t start_time;
+    int64_t mr_number;
+    int64_t mr_size;
+    int32_t running_times;
+    int32_t access_test_time;
+    int32_t exp_mode;
+    int32_t collision_check_mode;
+    int32_t evict_engine;
+    int32_t evict_mode;
+    int32_t calib_mode;
+    int32_t classify_model;
+    int32_t sweep_points;
+    int32_t sweep_repetitions;
+};
+
+/* result of one running_time */
+struct rsec_log_record {
+    uint64_t addr;
+    double evict_lat_us;
+    double lat_evict;
+    double thr_evict;
+    double avg_evict;
+    double lat_hit;
+    double thr_hit;
+    double avg_hit;
+    int64_t index_first;
+    int64_t index_last;
+    int64_t index_distance;
+    int64_t real_distance;
+    int32_t running_time;
+    int32_t access_target;
+    int32_t status;
+    int32_t test_mode;
+    int32_t count;
+    int32_t num_trials;
+    uint32_t rkey;
+    uint32_t evict_rkey;
+    int32_t num_evict_mr;
+    /* configuration of the iteration; point is -1 without sweep */
+    int32_t point;
+    int32_t value_size;
+    int32_t evict_target;
+    int32_t stride_strategy;
+    int32_t stride_distance;
+    int32_t strategy;  // index in the -P list
+    int32_t reserved;
+};
+
+struct rsec_log_inf {
+    FILE *fp;
+    struct rsec_log_record *ring;
+    /* head is only written by the attacker, tail only by the writer */
+    uint64_t head __attribute__((aligned(64)));
+    uint64_t tail __attribute__((aligned(64)));
+    int stop __attribute__((aligned(64)));
+    pthread_t writer;
+    uint64_t num_stalls;
+};
+
+struct rsec_log_inf *rsec_log_setup(const char *file_name);
+void rsec_log_push(struct rsec_log_inf *log, struct rsec_log_record *record);
+void rsec_log_close(struct rsec_log_inf *log);
+int rsec_log_format(char *line, int length, struct rsec_log_record *record);
+int rsec_log_decode(const char *file_name);
+int rsec_log_copy_file(const char *src, const char *dst);
+
+#endif
@@ -0,0 +1,210 @@
+#include "rsec.h"
+
+/**
+ * rsec_sample.c: bucket i < RSEC_HDR_SUB_COUNT holds the value i; above that,
+ * values with their highest bit at position RSEC_HDR_SUB_BITS + e share a
+ * bucket per 2^e, so every power of two is split into RSEC_HDR_SUB_COUNT
+ * buckets.
+ */
+
+__thread struct rsec_sample_ring *rsec_sample_local_ring = NULL;
+
+/**
+ * rsec_sample_thread_ring - sample ring of the calling thread
+ * The ring is allocated on the first call of each thread.
+ */
+struct rsec_sample_ring *rsec_sample_thread_ring(void) {
+    struct rsec_sample_ring *ring = rsec_sample_local_ring;
+    if (ring) return ring;
+    ring = malloc(sizeof(struct rsec_sample_ring));
+    assert(ring);
+    memset(ring, 0, sizeof(struct rsec_sample_ring));
+    ring->samples = malloc(sizeof(struct rsec_sample) * RSEC_SAMPLE_RING_SIZE);
+    assert(ring->samples);
+    // touch the ring now instead of on the first trials
+    memset(ring->samples, 0,
+           sizeof(struct rsec_sample) * RSEC_SAMPLE_RING_SIZE);
+    rsec_sample_local_ring = ring;
+    return ring;
+}
+
+/**
+ * rsec_hdr_index - bucket of a value
+ */
+static int rsec_hdr_index(uint64_t value) {
+    int e;
+    if (value >= UINT32_MAX) value = UINT32_MAX;
+    if (value < RSEC_HDR_SUB_COUNT) return value;
+    e = 63 - __builtin_clzll(value) - RSEC_HDR_SUB_BITS;
+    return (e + 1) * RSEC_HDR_SUB_COUNT + (value >> e) - RSEC_HDR_SUB_COUNT;
+}
+
+/**
+ * rsec_hdr_value - smallest value of a bucket
+ */
+static uint64_t rsec_hdr_value(int index) {
+    int e;
+    if (index < RSEC_HDR_SUB_COUNT) return index;
+    e = index / RSEC_HDR_SUB_COUNT - 1;
+    return (uint64_t)(index % RSEC_HDR_SUB_COUNT + RSEC_HDR_SUB_COUNT) << e;
+}
+
+/**
+ * rsec_hdr_reset - empty a histogram
+ * @hdr: histogram
+ */
+void rsec_hdr_reset(struct rsec_hdr *hdr) {
+    memset(hdr, 0, sizeof(struct rsec_hdr));
+}
+
+/**
+ * rsec_hdr_add - add one value
+ * @hdr: histogram
+ * @value: value
+ */
+void rsec_hdr_add(struct rsec_hdr *hdr, uint64_t value) {
+    if (!hdr->count || value < hdr->min) hdr->min = value;
+    if (value > hdr->max) hdr->max = value;
+    hdr->bucket[rsec_hdr_index(value)]++;
+    hdr->count++;
+}
+
+/**
+ * rsec_hdr_percentile - value at a percentile
+ * Returns the lower bound of the bucket (within the relative error of the
+ * histogram), clamped to the recorded min/max. 0 if the histogram is empty.
+ * @hdr: histogram
+ * @percentile: 0-100
+ */
+uint64_t rsec_hdr_percentile(struct rsec_hdr *hdr, double percentile) {
+    uint64_t rank, seen = 0;
+    int i;
+    if (!hdr->count) return 0;
+    rank = (uint64_t)(percentile / 100 * hdr->count + 0.5);
+    rank = RSEC_MIN(RSEC_MAX(rank, 1), hdr->count);
+    for (i = 0; i < RSEC_HDR_NUM_BUCKETS; i++) {
+        seen += hdr->bucket[i];
+        if (seen >= rank)
+            return RSEC_MIN(RSEC_MAX(rsec_hdr_value(i), hdr->min), hdr->max);
+    }
+    return hdr->max;
+}
+
+/**
+ * rsec_sample_stat_setup - create empty histograms
+ */
+struct rsec_sample_stat *rsec_sample_stat_setup(void) {
+    struct rsec_sample_stat *stat = malloc(sizeof(struct rsec_sample_stat));
+    assert(stat);
+    memset(stat, 0, sizeof(struct rsec_sample_stat));
+    return stat;
+}
+
+/**
+ * rsec_sample_drain - move the samples of a ring into the histograms
+ * The histograms of the previous iteration are cleared first. Returns the
+ * number of samples drained.
+ * @ring: sample ring
+ * @stat: histograms
+ */
+int rsec_sample_drain(struct rsec_sample_ring *ring,
+                      struct rsec_sample_stat *stat) {
+    struct rsec_sample *sample;
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = ring->tail;
+    int num = head - tail;
+    rsec_hdr_reset(&stat->iter_hit);
+    rsec_hdr_reset(&stat->iter_miss);
+    rsec_hdr_reset(&stat->iter_evict);
+    stat->iter_correct = 0;
+    for (; tail != head; tail++) {
+        sample = &ring->samples[tail & (RSEC_SAMPLE_RING_SIZE - 1)];
+        if (sample->label == RSEC_CLASSIFY_HIT) {
+            rsec_hdr_add(&stat->iter_hit, sample->reload_ns);
+            rsec_hdr_add(&stat->total_hit, sample->reload_ns);
+        } else {
+            rsec_hdr_add(&stat->iter_miss, sample->reload_ns);
+            rsec_hdr_add(&stat->total_miss, sample->reload_ns);
+        }
+        rsec_hdr_add(&stat->iter_evict, sample->evict_ns);
+        rsec_hdr_add(&stat->total_evict, sample->evict_ns);
+        if (sample->label == sample->decision) stat->iter_correct++;
+    }
+    stat->total_correct += stat->iter_correct;
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    if (ring->num_dropped) {
+        RSEC_ERROR("%lu samples dropped\n", (unsigned long)ring->num_dropped);
+        ring->num_dropped = 0;
+    }
+    return num;
+}
+
+/**
+ * rsec_sample_format_hdr - one percentile summary
+ */
+static int rsec_sample_format_hdr(char *line, int length, const char *name,
+                                  struct rsec_hdr *hdr) {
+    return snprintf(line, length, "\t%s %lu: %lu/%lu/%lu/%lu (%lu-%lu)", name,
+                    (unsigned long)hdr->count,
+                    (unsigned long)rsec_hdr_percentile(hdr, 50),
+                    (unsigned long)rsec_hdr_percentile(hdr, 90),
+                    (unsigned long)rsec_hdr_percentile(hdr, 99),
+                    (unsigned long)rsec_hdr_percentile(hdr, 99.9),
+                    (unsigned long)hdr->min, (unsigned long)hdr->max);
+}
+
+/**
+ * rsec_sample_print - print the percentiles of the last drained iteration
+ * Reload latency per victim access and eviction latency, as
+ * count: p50/p90/p99/p99.9 (min-max) in ns.
+ * @stat: histograms
+ * @iteration: running_time
+ */
+void rsec_sample_print(struct rsec_sample_stat *stat, int iteration) {
+    char line[RSEC_SAMPLE_LINE_LENGTH];
+    int len = 0;
+    len += rsec_sample_format_hdr(line + len, RSEC_SAMPLE_LINE_LENGTH - len,
+                                  "hit", &stat->iter_hit);
+    len += rsec_sample_format_hdr(line + len, RSEC_SAMPLE_LINE_LENGTH - len,
+                                  "miss", &stat->iter_miss);
+    rsec_sample_format_hdr(line + len, RSEC_SAMPLE_LINE_LENGTH - len, "evict",
+                           &stat->iter_evict);
+    RSEC_PRINT("%d\tsamples correct %d%s\n", iteration, stat->iter_correct,
+               line);
+}
+
+/**
+ * rsec_sample_export - write the histograms of the whole run
+ * One line per non-empty bucket: lower bound (ns) and the number of hit
+ * reloads, miss reloads and evictions in it. Returns 0 on success.
+ * @stat: histograms
+ * @file_name: output file
+ */
+int rsec_sample_export(struct rsec_sample_stat *stat, const char *file_name) {
+    FILE *fp = fopen(file_name, "w");
+    int i;
+    if (fp == NULL) {
+        RSEC_ERROR("fail to create %s\n", file_name);
+        return -1;
+    }
+    fprintf(fp, "# correct %ld/%lu\n", stat->total_correct,
+            (unsigned long)(stat->total_hit.count + stat->total_miss.count));
+    fprintf(fp, "# ns\thit\tmiss\tevict\n");
+    for (i = 0; i < RSEC_HDR_NUM_BUCKETS; i++) {
+        if (!stat->total_hit.bucket[i] && !stat->total_miss.bucket[i] &&
+            !stat->total_evict.bucket[i])
+            continue;
+        fprintf(fp, "%lu\t%lu\t%lu\t%lu\n", (unsigned long)rsec_hdr_value(i),
+                (unsigned long)stat->total_hit.bucket[i],
+                (unsigned long)stat->total_miss.bucket[i],
+                (unsigned long)stat->total_evict.bucket[i]);
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * rsec_sample_stat_free - free the histograms
+ * @stat: histograms
+ */
+void rsec_sample_stat_free(struct rsec_sample_stat *stat) { free(stat); }
@@ -0,0 +1,105 @@
+#ifndef RSEC_SAMPLE_HEADER
+#define RSEC_SAMPLE_HEADER
+
+#include <stdint.h>
+
+/**
+ * rsec_sample.h: per-trial latency samples of the attacker.
+ * The trial loop only stores a 16-byte struct rsec_sample into a preallocated
+ * per-thread ring (no lock, no syscall). At the end of each running_time the
+ * ring is drained into HDR-style histograms - log-linear buckets with
+ * 2^RSEC_HDR_SUB_BITS sub-buckets per power of two, i.e. a relative error
+ * below 1/2^RSEC_HDR_SUB_BITS - which give the percentiles of the iteration
+ * and are accumulated over the whole run for rsec_sample_export.
+ */
+
+// records (power of two); a full ring drops new samples
+#define RSEC_SAMPLE_RING_SIZE (1 << 16)
+#define RSEC_SAMPLE_FILE_STRING "%s.hist"
+#define RSEC_SAMPLE_LINE_LENGTH 256
+#define RSEC_HDR_SUB_BITS 5
+#define RSEC_HDR_SUB_COUNT (1 << RSEC_HDR_SUB_BITS)
+// buckets for 32-bit values (ns)
+#define RSEC_HDR_NUM_BUCKETS ((33 - RSEC_HDR_SUB_BITS) * RSEC_HDR_SUB_COUNT)
+
+struct rsec_sample {
+    uint32_t trial;
+    uint8_t label;     // RSEC_CLASSIFY_HIT / RSEC_CLASSIFY_MISS (victim)
+    uint8_t decision;  // answer of the attacker
+    uint16_t reserved;
+    uint32_t evict_ns;
+    uint32_t reload_ns;
+};
+
+struct rsec_sample_ring {
+    struct rsec_sample *samples;
+    /* head is only written by the recording thread, tail by the drain */
+    uint64_t head;
+    uint64_t tail;
+    uint64_t num_dropped;
+};
+
+struct rsec_hdr {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t bucket[RSEC_HDR_NUM_BUCKETS];
+};
+
+/* histograms of one running_time (iter) and of the whole run (total) */
+struct rsec_sample_stat {
+    struct rsec_hdr iter_hit, iter_miss, iter_evict;
+    struct rsec_hdr total_hit, total_miss, total_evict;
+    int iter_correct;
+    long total_correct;
+};
+
+/**
+ * rsec_sample_ns - saturate a latency (ns) into 32 bits
+ */
+static inline uint32_t rsec_sample_ns(double ns) {
+    if (ns <= 0) return 0;
+    if (ns >= UINT32_MAX) return UINT32_MAX;
+    return (uint32_t)ns;
+}
+
+/**
+ * rsec_sample_record - store the sample of one trial
+ * @ring: ring of the calling thread
+ * @trial: trial index in the running_time
+ * @label: access of the victim
+ * @decision: answer of the attacker
+ * @evict_ns: eviction latency
+ * @reload_ns: reload latency
+ */
+static inline void rsec_sample_record(struct rsec_sample_ring *ring, int trial,
+                                      int label, int decision,
+                                      double evict_ns, double reload_ns) {
+    struct rsec_sample *sample;
+    uint64_t head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) ==
+        RSEC_SAMPLE_RING_SIZE) {
+        ring->num_dropped++;
+        return;
+    }
+    sample = &ring->samples[head & (RSEC_SAMPLE_RING_SIZE - 1)];
+    sample->trial = trial;
+    sample->label = label;
+    sample->decision = decision;
+    sample->evict_ns = rsec_sample_ns(evict_ns);
+    sample->reload_ns = rsec_sample_ns(reload_ns);
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+struct rsec_sample_ring *rsec_sample_thread_ring(void);
+void rsec_hdr_reset(struct rsec_hdr *hdr);
+void rsec_hdr_add(struct rsec_hdr *hdr, uint64_t value);
+uint64_t rsec_hdr_percentile(struct rsec_hdr *hdr, double percentile);
+struct rsec_sample_stat *rsec_sample_stat_setup(void);
+int rsec_sample_drain(struct rsec_sample_ring *ring,
+                      struct rsec_sample_stat *stat);
+void rsec_sample_print(struct rsec_sample_stat *stat, int iteration);
+int rsec_sample_export(struct rsec_sample_stat *stat, const char *file_name);
+void rsec_sample_stat_free(struct rsec_sample_stat *stat);
+
+#endif
@@ -0,0 +1,137 @@
+#include "rsec.h"
+#include <dlfcn.h>
+
+/**
+ * rsec_strategy.c: registry of the loaded strategies. The index of a
+ * strategy in the list is the value of the `strategy` sweep axis.
+ */
+
+static const struct rsec_strategy *const rsec_strategy_builtin[] = {
+    &rsec_strategy_pythia,
+    &rsec_strategy_fixed,
+};
+#define RSEC_STRATEGY_NUM_BUILTIN \
+    (int)(sizeof(rsec_strategy_builtin) / sizeof(rsec_strategy_builtin[0]))
+
+static struct rsec_strategy_inf rsec_strategies[RSEC_STRATEGY_MAX];
+static int rsec_num_strategies;
+
+/**
+ * rsec_strategy_add - load one strategy and initialize its state
+ * Returns 0 on success.
+ * @spec: name[:arg]
+ */
+static int rsec_strategy_add(const char *spec) {
+    struct rsec_strategy_inf *strategy;
+    char name[RSEC_STRATEGY_NAME_LENGTH];
+    char *arg;
+    int i;
+    if (rsec_num_strategies == RSEC_STRATEGY_MAX) {
+        RSEC_ERROR("more than %d strategies\n", RSEC_STRATEGY_MAX);
+        return -1;
+    }
+    strategy = &rsec_strategies[rsec_num_strategies];
+    memset(strategy, 0, sizeof(struct rsec_strategy_inf));
+    snprintf(strategy->name, RSEC_STRATEGY_NAME_LENGTH, "%s", spec);
+    snprintf(name, RSEC_STRATEGY_NAME_LENGTH, "%s", spec);
+    arg = strchr(name, ':');
+    if (arg) *arg++ = '\0';
+
+    if (strchr(name, '/')) {
+        strategy->handle = dlopen(name, RTLD_NOW | RTLD_LOCAL);
+        if (strategy->handle == NULL) {
+            RSEC_ERROR("fail to load %s: %s\n", name, dlerror());
+            return -1;
+        }
+        strategy->ops = dlsym(strategy->handle, RSEC_STRATEGY_SYMBOL);
+        if (strategy->ops == NULL) {
+            RSEC_ERROR("%s has no %s\n", name, RSEC_STRATEGY_SYMBOL);
+            dlclose(strategy->handle);
+            return -1;
+        }
+    } else {
+        for (i = 0; i < RSEC_STRATEGY_NUM_BUILTIN; i++)
+            if (!strcmp(rsec_strategy_builtin[i]->name, name))
+                strategy->ops = rsec_strategy_builtin[i];
+        if (strategy->ops == NULL) {
+            RSEC_ERROR("unknown strategy %s\n", name);
+            return -1;
+        }
+    }
+    if (strategy->ops->init) strategy->state = strategy->ops->init(arg);
+    rsec_num_strategies++;
+    return 0;
+}
+
+/**
+ * rsec_strategy_load - load a comma separated list of strategies
+ * Returns 0 on success.
+ * @list: name[:arg],...
+ */
+int rsec_strategy_load(const char *list) {
+    char buffer[RSEC_CONFIG_LINE_LENGTH];
+    char *spec, *save = NULL;
+    snprintf(buffer, RSEC_CONFIG_LINE_LENGTH, "%s", list);
+    for (spec = strtok_r(buffer, ",", &save); spec;
+         spec = strtok_r(NULL, ",", &save))
+        if (rsec_strategy_add(spec)) return -1;
+    return 0;
+}
+
+/**
+ * rsec_strategy_default - use the pythia strategy if none is given (-P)
+ */
+static void rsec_strategy_default(void) {
+    if (rsec_num_strategies) return;
+    rsec_strategies[0].ops = &rsec_strategy_pythia;
+    snprintf(rsec_strategies[0].name, RSEC_STRATEGY_NAME_LENGTH, "%s",
+             rsec_strategy_pythia.name);
+    rsec_num_strategies = 1;
+}
+
+/**
+ * rsec_strategy_find - index of a loaded strategy, -1 if not loaded
+ * @name: name[:arg] as given to rsec_strategy_load
+ */
+int rsec_strategy_find(const char *name) {
+    int i;
+    rsec_strategy_default();
+    for (i = 0; i < rsec_num_strategies; i++)
+        if (!strcmp(rsec_strategies[i].name, name)) return i;
+    return -1;
+}
+
+/**
+ * rsec_strategy_current - strategy of a running_time
+ * @running_times: iteration
+ */
+struct rsec_strategy_inf *rsec_strategy_current(int running_times) {
+    rsec_strategy_default();
+    return &rsec_strategies[rsec_sweep_value(
+        running_times, RSEC_SWEEP_AXIS_STRATEGY, 0)];
+}
+
+/**
+ * rsec_strategy_print - print the loaded strategies
+ */
+void rsec_strategy_print(void) {
+    int i;
+    rsec_strategy_default();
+    for (i = 0; i < rsec_num_strategies; i++)
+        RSEC_PRINT("strategy %d: %s (%s)\n", i, rsec_strategies[i].name,
+                   rsec_strategies[i].handle ? "plugin" : "built-in");
+}
+
+/**
+ * rsec_strategy_cleanup - release the state and the plugins
+ */
+void rsec_strategy_cleanup(void) {
+    struct rsec_strategy_inf *strategy;
+    int i;
+    for (i = 0; i < rsec_num_strategies; i++) {
+        strategy = &rsec_strategies[i];
+        if (strategy->ops->fini) strategy->ops->fini(strategy->state);
+        if (strategy->handle) dlclose(strategy->handle);
+    }
+    rsec_num_strategies = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef RSEC_STRATEGY_HEADER
+#define RSEC_STRATEGY_HEADER
+
+#include <stdint.h>
+
+/**
+ * rsec_strategy.h: attack strategies behind the control hooks.
+ * Every get_* hook of rsec_control.c asks the strategy of the current
+ * running_time. A strategy is a table of hooks with its own state; a NULL
+ * hook falls back to the built-in pythia strategy. Strategies are given with
+ * `-P name[:arg],...` (`strategy` in setup.json) where name is either a
+ * built-in strategy (rsec_strategy_builtin) or a shared object exporting
+ * `const struct rsec_strategy rsec_strategy` (a name containing '/'),
+ * e.g. strategy_example.c. Several strategies run side by side in one
+ * campaign with the `strategy` axis of a sweep file; without it every
+ * running_time uses the first one. Victim and attacker must load the same
+ * list.
+ */
+
+#define RSEC_STRATEGY_SYMBOL "rsec_strategy"
+#define RSEC_STRATEGY_MAX 16
+#define RSEC_STRATEGY_NAME_LENGTH 128
+
+struct rsec_strategy {
+    const char *name;
+    /* returns the state handed to every hook, arg may be NULL */
+    void *(*init)(const char *arg);
+    void (*fini)(void *state);
+
+    int (*access_target)(void *state, int running_times, int *key_array);
+    int (*shift_target)(void *state, int access_target, int running_times);
+    int (*stride_strategy)(void *state, int running_times);
+    int (*stride_distance_target)(void *state, int running_times);
+    int (*num_evict_target)(void *state, int running_times);
+    int (*mr_target)(void *state, int running_times, uint32_t *extra_rkey);
+    int (*evict_mode)(void *state, int running_times);
+    int (*num_evict_qps)(void *state, int running_times);
+};
+
+struct rsec_strategy_inf {
+    char name[RSEC_STRATEGY_NAME_LENGTH];
+    const struct rsec_strategy *ops;
+    void *state;
+    /* dlopen handle, NULL for a built-in strategy */
+    void *handle;
+};
+
+extern const struct rsec_strategy rsec_strategy_pythia;
+extern const struct rsec_strategy rsec_strategy_fixed;
+
+int rsec_strategy_load(const char *list);
+int rsec_strategy_find(const char *name);
+struct rsec_strategy_inf *rsec_strategy_current(int running_times);
+void rsec_strategy_print(void);
+void rsec_strategy_cleanup(void);
+
+#endif
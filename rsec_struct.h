@@ -7,6 +7,23 @@
 #define RSEC_MAX_QP_NAME 256
 #define RSEC_RESERVED_NAME_PREFIX "__RSEC_RESERVED_NAME_PREFIX"
 #define MEMCACHED_IP "10.10.1.4"
+#define RSEC_MEMCACHED_WAIT_FOREVER (-1)
+#define RSEC_MEMCACHED_TIMEOUT (-2)
+// waits retry right away for a few times, then sleep with exponential backoff
+#define RSEC_MEMCACHED_BACKOFF_SPIN 8
+#define RSEC_MEMCACHED_BACKOFF_MIN_US 1
+#define RSEC_MEMCACHED_BACKOFF_MAX_US 1000
+// every key is scoped by the run epoch (-E) so campaigns never collide
+#define RSEC_MEMCACHED_EPOCH_STRING "e%u:%s"
+#define RSEC_MEMCACHED_MAX_KEY (RSEC_MAX_QP_NAME + 16)
+// expiration (in seconds) of setup keys (QP/MR) and trial/terminate keys
+#define RSEC_MEMCACHED_SETUP_EXPIRATION (60 * 60 * 24)
+#define RSEC_MEMCACHED_TRIAL_EXPIRATION (60 * 10)
+// shared memory registry (RSEC_REGISTRY_SHM), one segment per run epoch
+#define RSEC_REGISTRY_SHM_STRING "/rsec-registry-%u"
+#define RSEC_REGISTRY_SHM_SLOTS (1 << 15)  // must be a power of 2
+#define RSEC_REGISTRY_SHM_INLINE_SIZE 64
+#define RSEC_REGISTRY_SHM_HEAP_SIZE (64 << 20)
 
 #define RSEC_CQ_DEPTH 1024
 #define RSEC_QP_MAX_SGE 2
@@ -33,6 +50,7 @@ struct ib_qp_attr {
 
     int lid;
     int qpn;
+    int mtu; /* active MTU (enum ibv_mtu) of the port of this QP */
 
     union ibv_gid remote_gid;
 };
@@ -42,6 +60,26 @@ struct ib_mr_attr {
     uint32_t rkey;
 };
 
+/* MR list computed on demand - entry i is (base + i * stride, rkey) */
+struct rsec_mr_view {
+    uint64_t base;
+    uint64_t stride;
+    uint32_t rkey;
+    long long count;
+};
+
+/**
+ * rsec_mr_view_get - entry of an MR view
+ * @view: MR view
+ * @index: entry index
+ * @mr: return the entry
+ */
+static inline void rsec_mr_view_get(const struct rsec_mr_view *view,
+                                    long long index, struct ib_mr_attr *mr) {
+    mr->addr = view->base + (uint64_t)index * view->stride;
+    mr->rkey = view->rkey;
+}
+
 struct configuration_params {
     int global_thread_id;
     int local_thread_id;
@@ -55,6 +93,10 @@ struct configuration_params {
     int num_loopback;
     int interaction_mode;
     int num_attack_qps;
+    unsigned int epoch;
+    int registry_mode;
+    int data_path;
+    int verbs_mode;
 };
 
 struct RSEC_message_frame {
@@ -90,6 +132,7 @@ struct ib_inf {
     int num_global_rcqps;
     struct ibv_qp **conn_qp;
     struct ibv_cq **conn_cq, *server_recv_cq;
+    struct ibv_cq_ex **conn_cq_ex; /* NULL unless created by ib_create_ts_cq */
     struct ib_qp_attr **all_rcqps;
 
     uint64_t *rcqp_buf;
@@ -136,6 +179,9 @@ struct ib_inf {
     struct ib_qp_attr **attack_rcqps;
 
     union ibv_gid local_gid;
+    int network_mode; /* RSEC_NETWORK_IB or RSEC_NETWORK_ROCE */
+    int sgid_index;
+    enum ibv_mtu active_mtu;
 };
 
 struct ib_local_inf {
@@ -0,0 +1,314 @@
+#include "rsec.h"
+#include <math.h>
+
+/**
+ * rsec_sweep.c: points are the cartesian product of the axes, the last axis
+ * (strategy) changing fastest. The schedule is shuffled with a seeded
+ * xorshift generator (seed 0 takes the run epoch, which every role shares).
+ */
+
+struct rsec_sweep_inf *rsec_sweep = NULL;
+
+/**
+ * rsec_sweep_rand - next value of the schedule generator (xorshift64)
+ */
+static uint64_t rsec_sweep_rand(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return x;
+}
+
+/**
+ * rsec_sweep_shuffle - Fisher-Yates shuffle of an int array
+ */
+static void rsec_sweep_shuffle(int *array, int length, uint64_t *state) {
+    int i, j, tmp;
+    for (i = length - 1; i > 0; i--) {
+        j = rsec_sweep_rand(state) % (i + 1);
+        tmp = array[i];
+        array[i] = array[j];
+        array[j] = tmp;
+    }
+}
+
+/**
+ * rsec_sweep_set_axis - parse the value list of an axis
+ */
+static int rsec_sweep_set_axis(int axis, char *list) {
+    char *token, *save = NULL, *end;
+    long long number;
+    int *num_values = &rsec_sweep->num_values[axis];
+    *num_values = 0;
+    for (token = strtok_r(list, ",", &save); token;
+         token = strtok_r(NULL, ",", &save)) {
+        while (*token == ' ' || *token == '\t') token++;
+        for (end = token + strlen(token);
+             end > token && (end[-1] == ' ' || end[-1] == '\t'); end--)
+            ;
+        *end = '\0';
+        if (*num_values == RSEC_SWEEP_MAX_VALUES) {
+            RSEC_ERROR("more than %d values of %s\n", RSEC_SWEEP_MAX_VALUES,
+                       rsec_sweep_axis_text[axis]);
+            return -1;
+        }
+        switch (axis) {
+            case RSEC_SWEEP_AXIS_VALUE_SIZE:
+            case RSEC_SWEEP_AXIS_EVICT_MODE:
+            case RSEC_SWEEP_AXIS_STRIDE_STRATEGY:
+                if (rsec_config_value(rsec_sweep_axis_text[axis], token,
+                                      &number))
+                    return -1;
+                break;
+            case RSEC_SWEEP_AXIS_STRATEGY:
+                number = rsec_strategy_find(token);
+                if (number < 0) {
+                    RSEC_ERROR("strategy %s is not loaded (-P)\n", token);
+                    return -1;
+                }
+                break;
+            default:
+                number = strtoll(token, &end, 0);
+                if (end == token || *end != '\0') {
+                    RSEC_ERROR("bad value %s of %s\n", token,
+                               rsec_sweep_axis_text[axis]);
+                    return -1;
+                }
+        }
+        // the server lays out blocks of the configured value size
+        if (axis == RSEC_SWEEP_AXIS_VALUE_SIZE &&
+            RSEC_ROUND_UP(number, RSEC_MR_SIZE) != RSEC_REAL_BLOCK_SIZE) {
+            RSEC_ERROR("value_size %lld needs another block size than %d\n",
+                       number, RSEC_VALUE_SIZE);
+            return -1;
+        }
+        if (axis == RSEC_SWEEP_AXIS_EVICT_NUMBER && number < 1) {
+            RSEC_ERROR("evict_number %lld < 1\n", number);
+            return -1;
+        }
+        if (axis == RSEC_SWEEP_AXIS_EVICT_MODE &&
+            number == RSEC_PROBE_COLLISION_CHECK_MODE_ASSOCIATE) {
+            RSEC_ERROR("evict_mode %s is not supported\n", token);
+            return -1;
+        }
+        rsec_sweep->values[axis][(*num_values)++] = number;
+    }
+    return *num_values ? 0 : -1;
+}
+
+/**
+ * rsec_sweep_set_option - handler of one line of the sweep file
+ */
+static int rsec_sweep_set_option(const char *option) {
+    char buffer[RSEC_CONFIG_LINE_LENGTH];
+    char *name, *value, *end;
+    long long number;
+    int axis;
+    snprintf(buffer, RSEC_CONFIG_LINE_LENGTH, "%s", option);
+    if (rsec_config_split(buffer, &name, &value)) return -1;
+    for (axis = 0; axis < RSEC_SWEEP_NUM_AXES; axis++)
+        if (!strcmp(name, rsec_sweep_axis_text[axis]))
+            return rsec_sweep_set_axis(axis, value);
+    if (!strcmp(name, "order")) {
+        for (number = 1; number <= RSEC_SWEEP_ORDER_INTERLEAVE; number++)
+            if (!strcmp(value, rsec_sweep_order_text[number])) break;
+        if (number > RSEC_SWEEP_ORDER_INTERLEAVE) number = atoi(value);
+        if (number < RSEC_SWEEP_ORDER_SEQUENTIAL ||
+            number > RSEC_SWEEP_ORDER_INTERLEAVE) {
+            RSEC_ERROR("bad order %s\n", value);
+            return -1;
+        }
+        rsec_sweep->order = number;
+        return 0;
+    }
+    if (!strcmp(name, "stop_ci")) {
+        rsec_sweep->stop_ci = strtod(value, &end);
+        return end == value || *end != '\0' || rsec_sweep->stop_ci < 0 ? -1
+                                                                        : 0;
+    }
+    number = strtoll(value, &end, 0);
+    if (end == value || *end != '\0' || number < 0) {
+        RSEC_ERROR("bad value %s of %s\n", value, name);
+        return -1;
+    }
+    if (!strcmp(name, "repetitions"))
+        rsec_sweep->repetitions = RSEC_MAX(number, 1);
+    else if (!strcmp(name, "seed"))
+        rsec_sweep->seed = number;
+    else if (!strcmp(name, "min_repetitions"))
+        rsec_sweep->min_repetitions = number;
+    else {
+        RSEC_ERROR("unknown sweep option %s=%s\n", name, value);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * rsec_sweep_load - read a sweep file and build its schedule
+ * Sets the number of running_times of the run to points x repetitions.
+ * Returns 0 on success.
+ * @file_name: sweep file
+ * @epoch: run epoch, seeds the schedule if the file has no seed
+ */
+int rsec_sweep_load(const char *file_name, unsigned int epoch) {
+    struct rsec_sweep_point *point;
+    uint64_t state;
+    int axis, i, j, index, *order;
+    rsec_sweep = malloc(sizeof(struct rsec_sweep_inf));
+    assert(rsec_sweep);
+    memset(rsec_sweep, 0, sizeof(struct rsec_sweep_inf));
+    rsec_sweep->repetitions = 1;
+    rsec_sweep->order = RSEC_SWEEP_ORDER_SEQUENTIAL;
+    if (rsec_config_parse(file_name, rsec_sweep_set_option)) return -1;
+
+    rsec_sweep->num_points = 1;
+    for (axis = 0; axis < RSEC_SWEEP_NUM_AXES; axis++)
+        rsec_sweep->num_points *= RSEC_MAX(rsec_sweep->num_values[axis], 1);
+    if ((long long)rsec_sweep->num_points * rsec_sweep->repetitions >
+        INT_MAX) {
+        RSEC_ERROR("sweep of %s is too large\n", file_name);
+        return -1;
+    }
+    rsec_sweep->points =
+        malloc(sizeof(struct rsec_sweep_point) * rsec_sweep->num_points);
+    assert(rsec_sweep->points);
+    memset(rsec_sweep->points, 0,
+           sizeof(struct rsec_sweep_point) * rsec_sweep->num_points);
+    for (i = 0; i < rsec_sweep->num_points; i++) {
+        point = &rsec_sweep->points[i];
+        point->id = i;
+        index = i;
+        for (axis = RSEC_SWEEP_NUM_AXES - 1; axis >= 0; axis--) {
+            if (!rsec_sweep->num_values[axis]) {
+                point->value[axis] = RSEC_SWEEP_UNSET;
+                continue;
+            }
+            point->value[axis] =
+                rsec_sweep->values[axis][index % rsec_sweep->num_values[axis]];
+            index /= rsec_sweep->num_values[axis];
+        }
+    }
+
+    // schedule
+    state = rsec_sweep->seed;
+    if (!state) state = ((uint64_t)epoch << 32) ^ RSEC_SWEEP_SEED;
+    rsec_sweep->seed = state;
+    rsec_sweep->num_iterations =
+        rsec_sweep->num_points * rsec_sweep->repetitions;
+    rsec_sweep->schedule = malloc(sizeof(int) * rsec_sweep->num_iterations);
+    order = malloc(sizeof(int) * rsec_sweep->num_points);
+    assert(rsec_sweep->schedule && order);
+    for (i = 0; i < rsec_sweep->num_points; i++) order[i] = i;
+    if (rsec_sweep->order == RSEC_SWEEP_ORDER_BLOCK)
+        rsec_sweep_shuffle(order, rsec_sweep->num_points, &state);
+    for (i = 0; i < rsec_sweep->num_points; i++)
+        for (j = 0; j < rsec_sweep->repetitions; j++)
+            rsec_sweep->schedule[i * rsec_sweep->repetitions + j] = order[i];
+    if (rsec_sweep->order == RSEC_SWEEP_ORDER_INTERLEAVE)
+        rsec_sweep_shuffle(rsec_sweep->schedule, rsec_sweep->num_iterations,
+                           &state);
+    free(order);
+    rsec_config.running_times = rsec_sweep->num_iterations;
+    return 0;
+}
+
+/**
+ * rsec_sweep_point - point of an iteration, NULL without sweep
+ * @iteration: running_time
+ */
+struct rsec_sweep_point *rsec_sweep_point(int iteration) {
+    if (rsec_sweep == NULL || iteration >= rsec_sweep->num_iterations)
+        return NULL;
+    return &rsec_sweep->points[rsec_sweep->schedule[iteration]];
+}
+
+/**
+ * rsec_sweep_value - value of an axis in an iteration
+ * @iteration: running_time
+ * @axis: enum RSEC_SWEEP_AXIS
+ * @fallback: returned if the axis is not swept
+ */
+int rsec_sweep_value(int iteration, int axis, int fallback) {
+    struct rsec_sweep_point *point = rsec_sweep_point(iteration);
+    if (point == NULL || point->value[axis] == RSEC_SWEEP_UNSET)
+        return fallback;
+    return point->value[axis];
+}
+
+/**
+ * rsec_sweep_apply - set the configuration knobs of an iteration
+ * Called by victim and attacker at the start of every running_time. Only
+ * the value size is a configuration knob; the other axes are read by the
+ * control hooks.
+ * @iteration: running_time
+ */
+void rsec_sweep_apply(int iteration) {
+    rsec_config.value_size = rsec_sweep_value(
+        iteration, RSEC_SWEEP_AXIS_VALUE_SIZE, rsec_config.value_size);
+}
+
+/**
+ * rsec_sweep_skip - whether the point of an iteration stopped early
+ * @iteration: running_time
+ */
+int rsec_sweep_skip(int iteration) {
+    struct rsec_sweep_point *point = rsec_sweep_point(iteration);
+    if (point == NULL || !point->done) return 0;
+    rsec_sweep->num_skipped++;
+    return 1;
+}
+
+/**
+ * rsec_sweep_update - add the accuracy of an iteration to its point
+ * The point is done once the confidence interval of its mean accuracy is
+ * narrower than +-stop_ci (never if stop_ci is 0).
+ * @iteration: running_time
+ * @count: correct trials
+ * @num_trials: trials of the iteration
+ */
+void rsec_sweep_update(int iteration, int count, int num_trials) {
+    struct rsec_sweep_point *point = rsec_sweep_point(iteration);
+    double accuracy, delta;
+    if (point == NULL) return;
+    accuracy = (double)count / num_trials;
+    point->num_runs++;
+    delta = accuracy - point->mean;
+    point->mean += delta / point->num_runs;
+    point->m2 += delta * (accuracy - point->mean);
+    if (rsec_sweep->stop_ci <= 0 || point->num_runs < 2 ||
+        point->num_runs < rsec_sweep->min_repetitions)
+        return;
+    if (RSEC_SWEEP_Z * sqrt(point->m2 / (point->num_runs - 1) /
+                            point->num_runs) < rsec_sweep->stop_ci)
+        point->done = 1;
+}
+
+/**
+ * rsec_sweep_print - print the schedule or, after the run, the accuracy of
+ * every point
+ */
+void rsec_sweep_print(void) {
+    struct rsec_sweep_point *point;
+    char line[RSEC_CONFIG_LINE_LENGTH];
+    int i, axis, len;
+    if (rsec_sweep == NULL) return;
+    line[0] = '\0';
+    RSEC_PRINT("sweep: %d points x %d repetitions %s seed %lu skipped %d\n",
+               rsec_sweep->num_points, rsec_sweep->repetitions,
+               rsec_sweep_order_text[rsec_sweep->order],
+               (unsigned long)rsec_sweep->seed, rsec_sweep->num_skipped);
+    for (i = 0; i < rsec_sweep->num_points; i++) {
+        point = &rsec_sweep->points[i];
+        len = 0;
+        for (axis = 0; axis < RSEC_SWEEP_NUM_AXES; axis++)
+            if (point->value[axis] != RSEC_SWEEP_UNSET)
+                len += snprintf(line + len, RSEC_CONFIG_LINE_LENGTH - len,
+                                " %s=%d", rsec_sweep_axis_text[axis],
+                                point->value[axis]);
+        RSEC_PRINT("point %d:%s\truns %d accuracy %0.4f%s\n", i, line,
+                   point->num_runs, point->mean, point->done ? " (stop)" : "");
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef RSEC_SWEEP_HEADER
+#define RSEC_SWEEP_HEADER
+
+#include <limits.h>
+#include <stdint.h>
+
+/**
+ * rsec_sweep.h: parameter sweep of an experiment campaign.
+ * A sweep file (`-W`, name=value lines like rsec.conf) lists the values of
+ * each axis as comma separated lists; the sweep runs every combination
+ * (point) `repetitions` times. The schedule maps each running_time to a point
+ * and only depends on the file and the seed, so victim and attacker compute
+ * the same schedule and stay in lockstep without exchanging it. The control
+ * hooks of rsec_control.c return the values of the current point.
+ * Early stop: once a point has min_repetitions iterations and the 95%
+ * confidence interval of its accuracy is narrower than +-stop_ci, the
+ * attacker skips its remaining iterations and tells the victim through the
+ * CALIBRATE signal (RSEC_SWEEP_SKIP).
+ */
+
+// SEQUENTIAL: points in file order, the repetitions of a point back to back
+// BLOCK: points shuffled, the repetitions of a point back to back
+// INTERLEAVE: every iteration shuffled (spreads drift over all points)
+#define RSEC_SWEEP_ORDER_SEQUENTIAL 1
+#define RSEC_SWEEP_ORDER_BLOCK 2
+#define RSEC_SWEEP_ORDER_INTERLEAVE 3
+static const char *const rsec_sweep_order_text[] = {
+    "------RSEC STRING------", "RSEC_SWEEP_ORDER_SEQUENTIAL",
+    "RSEC_SWEEP_ORDER_BLOCK", "RSEC_SWEEP_ORDER_INTERLEAVE"};
+
+#define RSEC_SWEEP_MAX_VALUES 64
+#define RSEC_SWEEP_UNSET INT_MIN
+#define RSEC_SWEEP_SEED 0x5eedULL
+// value of the CALIBRATE signal which skips the iteration
+#define RSEC_SWEEP_SKIP 2
+#define RSEC_SWEEP_Z 1.96
+
+enum RSEC_SWEEP_AXIS {
+    RSEC_SWEEP_AXIS_VALUE_SIZE = 0,
+    RSEC_SWEEP_AXIS_EVICT_MODE = 1,
+    RSEC_SWEEP_AXIS_STRIDE_STRATEGY = 2,
+    RSEC_SWEEP_AXIS_STRIDE_DISTANCE = 3,
+    RSEC_SWEEP_AXIS_EVICT_NUMBER = 4,
+    RSEC_SWEEP_AXIS_STRATEGY = 5,
+    RSEC_SWEEP_NUM_AXES = 6
+};
+// file names of the axes (value_size, evict_mode and stride_strategy take
+// the values of the rsec_config option of the same name, strategy takes the
+// names given to -P)
+static const char *const rsec_sweep_axis_text[] = {
+    "value_size",   "evict_mode", "stride_strategy", "stride_distance",
+    "evict_number", "strategy"};
+
+struct rsec_sweep_point {
+    int id;
+    int value[RSEC_SWEEP_NUM_AXES];  // RSEC_SWEEP_UNSET if not swept
+
+    /* accuracy of the iterations run so far (attacker) */
+    int num_runs;
+    double mean;
+    double m2;
+    int done;
+};
+
+struct rsec_sweep_inf {
+    int values[RSEC_SWEEP_NUM_AXES][RSEC_SWEEP_MAX_VALUES];
+    int num_values[RSEC_SWEEP_NUM_AXES];
+    int repetitions;
+    int order;
+    uint64_t seed;
+    int min_repetitions;
+    double stop_ci;
+
+    struct rsec_sweep_point *points;
+    int num_points;
+    /* point of each running_time */
+    int *schedule;
+    int num_iterations;
+    int num_skipped;
+};
+
+extern struct rsec_sweep_inf *rsec_sweep;
+
+int rsec_sweep_load(const char *file_name, unsigned int epoch);
+struct rsec_sweep_point *rsec_sweep_point(int iteration);
+int rsec_sweep_value(int iteration, int axis, int fallback);
+void rsec_sweep_apply(int iteration);
+int rsec_sweep_skip(int iteration);
+void rsec_sweep_update(int iteration, int count, int num_trials);
+void rsec_sweep_print(void);
+
+#endif
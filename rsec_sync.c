@@ -0,0 +1,149 @@
+#include "rsec.h"
+
+/**
+ * rsec_sync.c: this code synchronizes attacker and client for every trial.
+ * In RSEC_SYNC_MODE_RDMA, each side owns a small mailbox (one 8-byte slot per
+ * signal type). A signal is an RDMA write of (sequence number, value) into the
+ * peer's slot over the RC QP that already connects both machines, and a wait
+ * spins on the local slot until the expected sequence number shows up.
+ * RSEC_SYNC_MODE_MEMCACHED keeps the original publish/get based handshake;
+ * every key there has exactly one reader, which deletes it after the read.
+ */
+
+static const char *const rsec_sync_slot_string[] = {
+    RSEC_EVICT_STRING,    RSEC_ACCESS_STRING,   RSEC_WARMUP_STRING_1,
+    RSEC_WARMUP_STRING_2, RSEC_WARMUP_STRING_3, RSEC_WARMUP_STRING_4,
+    RSEC_CALIBRATE_STRING};
+
+/**
+ * rsec_sync_setup - create the trial handshake channel to a peer
+ * 1. register local mailbox and staging buffer
+ * 2. exchange mailbox information through memcached (bootstrap only)
+ * @inf: RDMA context
+ * @machine_id: local machine id
+ * @peer_id: machine id of the other side of the handshake
+ */
+struct rsec_sync_inf *rsec_sync_setup(struct ib_inf *inf, int machine_id,
+                                      int peer_id) {
+    struct rsec_sync_inf *sync = malloc(sizeof(struct rsec_sync_inf));
+    int mailbox_size = sizeof(uint64_t) * RSEC_SYNC_SLOT_NUMBER;
+    char mailbox_name[RSEC_MAX_QP_NAME];
+    struct ib_mr_attr local_mailbox;
+    int ret_len;
+    assert(sync);
+    memset(sync, 0, sizeof(struct rsec_sync_inf));
+    sync->mode = RSEC_SYNC_MODE;
+    sync->machine_id = machine_id;
+    sync->peer_id = peer_id;
+    RSEC_PRINT("SYNC_MODE: %s (peer %d)\n", rsec_sync_mode_text[sync->mode],
+               peer_id);
+    if (sync->mode != RSEC_SYNC_MODE_RDMA) return sync;
+
+    assert(peer_id >= 0 && peer_id < inf->global_machines);
+    assert(peer_id != machine_id);
+    sync->qp = inf->conn_qp[peer_id * RSEC_PARALLEL_RC_QPS];
+    sync->cq = inf->conn_cq[peer_id * RSEC_PARALLEL_RC_QPS];
+
+    sync->mailbox = ib_malloc(mailbox_size);
+    memset((void *)sync->mailbox, 0, mailbox_size);
+    sync->mailbox_mr =
+        ibv_reg_mr(inf->pd, (void *)sync->mailbox, mailbox_size,
+                   IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_WRITE);
+    assert(sync->mailbox_mr);
+
+    sync->staging = ib_malloc(mailbox_size);
+    memset(sync->staging, 0, mailbox_size);
+    sync->staging_mr = ibv_reg_mr(inf->pd, sync->staging, mailbox_size,
+                                  IBV_ACCESS_LOCAL_WRITE);
+    assert(sync->staging_mr);
+
+    local_mailbox.addr = (uintptr_t)sync->mailbox;
+    local_mailbox.rkey = sync->mailbox_mr->rkey;
+    sprintf(mailbox_name, RSEC_SYNC_MAILBOX_STRING, machine_id, peer_id);
+    memcached_publish(mailbox_name, &local_mailbox, sizeof(struct ib_mr_attr));
+
+    sprintf(mailbox_name, RSEC_SYNC_MAILBOX_STRING, peer_id, machine_id);
+    ret_len = memcached_wait_published_into(
+        mailbox_name, &sync->remote_mailbox, sizeof(struct ib_mr_attr),
+        RSEC_MEMCACHED_WAIT_FOREVER);
+    assert(ret_len == sizeof(struct ib_mr_attr));
+    RSEC_PRINT("get sync mailbox of %d: rkey %lu addr %llx\n", peer_id,
+               (unsigned long)sync->remote_mailbox.rkey,
+               (unsigned long long)sync->remote_mailbox.addr);
+    return sync;
+}
+
+/**
+ * rsec_sync_signal - notify the peer
+ * @sync: handshake channel
+ * @slot: signal type (RSEC_SYNC_SLOT_*)
+ * @iteration: running_times - only used by memcached mode to form the key
+ * @index: trial index - only used by memcached mode to form the key
+ * @value: value delivered with the signal
+ */
+void rsec_sync_signal(struct rsec_sync_inf *sync, int slot, int iteration,
+                      int index, unsigned long value) {
+    assert(slot >= 0 && slot < RSEC_SYNC_SLOT_NUMBER);
+    if (sync->mode == RSEC_SYNC_MODE_RDMA) {
+        struct ibv_sge sge;
+        struct ibv_send_wr wr, *bad_send_wr;
+        int ret;
+        sync->send_seq[slot]++;
+        sync->staging[slot] = RSEC_SYNC_PACK(sync->send_seq[slot], value);
+
+        sge.addr = (uintptr_t)&sync->staging[slot];
+        sge.length = sizeof(uint64_t);
+        sge.lkey = sync->staging_mr->lkey;
+        wr.opcode = IBV_WR_RDMA_WRITE;
+        wr.num_sge = 1;
+        wr.next = NULL;
+        wr.sg_list = &sge;
+        wr.send_flags = IBV_SEND_SIGNALED;
+        wr.wr_id = slot;
+        wr.wr.rdma.remote_addr =
+            sync->remote_mailbox.addr + slot * sizeof(uint64_t);
+        wr.wr.rdma.rkey = sync->remote_mailbox.rkey;
+        ret = ibv_post_send(sync->qp, &wr, &bad_send_wr);
+        CPE(ret, "ibv_post_send error", ret);
+        // staging slot can only be reused after the NIC has read it
+        userspace_one_poll(sync->cq, 1);
+    } else {
+        char memcached_string[RSEC_MEMCACHED_STRING_LENGTH];
+        unsigned long signal_output = value;
+        sprintf(memcached_string, rsec_sync_slot_string[slot], iteration,
+                index);
+        memcached_publish_expire(memcached_string, &signal_output,
+                                 RSEC_SIGNAL_SIZE,
+                                 RSEC_MEMCACHED_TRIAL_EXPIRATION);
+    }
+}
+
+/**
+ * rsec_sync_wait - wait for the peer to signal and return its value
+ * @sync: handshake channel
+ * @slot: signal type (RSEC_SYNC_SLOT_*)
+ * @iteration: running_times - only used by memcached mode to form the key
+ * @index: trial index - only used by memcached mode to form the key
+ */
+unsigned long rsec_sync_wait(struct rsec_sync_inf *sync, int slot,
+                             int iteration, int index) {
+    assert(slot >= 0 && slot < RSEC_SYNC_SLOT_NUMBER);
+    if (sync->mode == RSEC_SYNC_MODE_RDMA) {
+        uint64_t slot_value;
+        sync->recv_seq[slot]++;
+        while (1) {
+            slot_value = sync->mailbox[slot];
+            if (RSEC_SYNC_TO_SEQ(slot_value) == sync->recv_seq[slot]) break;
+            RSEC_CPU_RELAX();
+        }
+        return (unsigned long)RSEC_SYNC_TO_VALUE(slot_value);
+    } else {
+        char memcached_string[RSEC_MEMCACHED_STRING_LENGTH];
+        unsigned long value;
+        sprintf(memcached_string, rsec_sync_slot_string[slot], iteration,
+                index);
+        value = memcached_wait_signal(memcached_string);
+        memcached_delete_key(memcached_string);
+        return value;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef RSEC_SYNC_HEADER
+#define RSEC_SYNC_HEADER
+
+#include <infiniband/verbs.h>
+#include "rsec_struct.h"
+
+/**
+ * rsec_sync.h: trial handshake between attacker and client.
+ * Memcached is only used to exchange the mailbox of each side. After that,
+ * every signal is a single RDMA write into the peer's mailbox.
+ */
+
+#define RSEC_SYNC_MODE_MEMCACHED 1
+#define RSEC_SYNC_MODE_RDMA 2
+#define RSEC_SYNC_MODE RSEC_SYNC_MODE_RDMA
+static const char *const rsec_sync_mode_text[] = {
+    "------RSEC STRING------", "RSEC_SYNC_MODE_MEMCACHED",
+    "RSEC_SYNC_MODE_RDMA"};
+
+#define RSEC_SYNC_MAILBOX_STRING "sync-mailbox-%d-%d"
+
+// each mailbox slot packs a sequence number and the signal value
+#define RSEC_SYNC_SEQ_SHIFT 32
+#define RSEC_SYNC_VALUE_MASK ((1ULL << RSEC_SYNC_SEQ_SHIFT) - 1)
+#define RSEC_SYNC_PACK(seq, value) \
+    (((uint64_t)(seq) << RSEC_SYNC_SEQ_SHIFT) | ((value)&RSEC_SYNC_VALUE_MASK))
+#define RSEC_SYNC_TO_SEQ(slot_value) ((slot_value) >> RSEC_SYNC_SEQ_SHIFT)
+#define RSEC_SYNC_TO_VALUE(slot_value) ((slot_value)&RSEC_SYNC_VALUE_MASK)
+
+enum RSEC_SYNC_SLOT {
+    RSEC_SYNC_SLOT_EVICT = 0,
+    RSEC_SYNC_SLOT_ACCESS = 1,
+    RSEC_SYNC_SLOT_WARMUP_1 = 2,
+    RSEC_SYNC_SLOT_WARMUP_2 = 3,
+    RSEC_SYNC_SLOT_WARMUP_3 = 4,
+    RSEC_SYNC_SLOT_WARMUP_4 = 5,
+    RSEC_SYNC_SLOT_CALIBRATE = 6,
+    RSEC_SYNC_SLOT_NUMBER = 7
+};
+
+struct rsec_sync_inf {
+    int mode;
+    int machine_id;
+    int peer_id;
+
+    /* RC QP connected to the peer */
+    struct ibv_qp *qp;
+    struct ibv_cq *cq;
+
+    /* local mailbox - written by the peer */
+    volatile uint64_t *mailbox;
+    struct ibv_mr *mailbox_mr;
+    /* local staging buffer - source of our RDMA writes */
+    uint64_t *staging;
+    struct ibv_mr *staging_mr;
+    /* peer mailbox */
+    struct ib_mr_attr remote_mailbox;
+
+    uint32_t send_seq[RSEC_SYNC_SLOT_NUMBER];
+    uint32_t recv_seq[RSEC_SYNC_SLOT_NUMBER];
+};
+
+struct rsec_sync_inf *rsec_sync_setup(struct ib_inf *inf, int machine_id,
+                                      int peer_id);
+void rsec_sync_signal(struct rsec_sync_inf *sync, int slot, int iteration,
+                      int index, unsigned long value);
+unsigned long rsec_sync_wait(struct rsec_sync_inf *sync, int slot,
+                             int iteration, int index);
+
+#endif
@@ -0,0 +1,131 @@
+#include "rsec.h"
+
+/**
+ * rsec_time.c: TSC calibration and the per-thread sample accumulators.
+ * Every thread allocates its accumulators once and links them into
+ * rsec_time_live. When the thread exits, the accumulators are merged into
+ * rsec_time_retired and freed, so short-lived lane and evict threads leave
+ * nothing behind. rsec_time_report merges both under rsec_time_lock; the
+ * samples themselves are added without any lock.
+ */
+
+double rsec_tsc_per_ns = 1;
+
+struct rsec_time_slot {
+    struct rsec_time_acc acc[RSEC_TIME_NUMBER];
+    struct rsec_time_slot *next;
+};
+
+static __thread struct rsec_time_slot *rsec_time_local;
+static struct rsec_time_slot *rsec_time_live;
+static struct rsec_time_acc rsec_time_retired[RSEC_TIME_NUMBER];
+static pthread_mutex_t rsec_time_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t rsec_time_key;
+static pthread_once_t rsec_time_key_once = PTHREAD_ONCE_INIT;
+
+/**
+ * rsec_time_calibrate - measure TSC ticks per ns against CLOCK_MONOTONIC
+ */
+static void rsec_time_calibrate(void) {
+    struct timespec start, end;
+    uint64_t tsc_start, tsc_end;
+    double ns;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    tsc_start = rsec_time_start();
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ns = diff_ns(&start, &end);
+    } while (ns < RSEC_TSC_CALIBRATE_NS);
+    tsc_end = rsec_time_end();
+    rsec_tsc_per_ns = (tsc_end - tsc_start) / ns;
+    RSEC_PRINT("TSC: %0.3f cycles/ns\n", rsec_tsc_per_ns);
+}
+
+/**
+ * rsec_time_init - calibrate the TSC once
+ * Concurrent callers return once rsec_tsc_per_ns is set.
+ */
+void rsec_time_init(void) {
+    static pthread_once_t calibrated = PTHREAD_ONCE_INIT;
+    pthread_once(&calibrated, rsec_time_calibrate);
+}
+
+/**
+ * rsec_time_thread_exit - retire the accumulators of an exiting thread
+ */
+static void rsec_time_thread_exit(void *data) {
+    struct rsec_time_slot *slot = data, **prev;
+    int kind;
+    pthread_mutex_lock(&rsec_time_lock);
+    for (prev = &rsec_time_live; *prev != slot; prev = &(*prev)->next)
+        ;
+    *prev = slot->next;
+    for (kind = RSEC_TIME_EVICT; kind < RSEC_TIME_NUMBER; kind++)
+        rsec_time_acc_merge(&rsec_time_retired[kind], &slot->acc[kind]);
+    pthread_mutex_unlock(&rsec_time_lock);
+    free(slot);
+}
+
+static void rsec_time_key_create(void) {
+    pthread_key_create(&rsec_time_key, rsec_time_thread_exit);
+}
+
+/**
+ * rsec_time_thread_acc - accumulator of the calling thread
+ * @kind: kind of the samples (RSEC_TIME_*)
+ */
+struct rsec_time_acc *rsec_time_thread_acc(int kind) {
+    struct rsec_time_slot *slot = rsec_time_local;
+    assert(kind >= RSEC_TIME_EVICT && kind < RSEC_TIME_NUMBER);
+    if (slot) return &slot->acc[kind];
+    pthread_once(&rsec_time_key_once, rsec_time_key_create);
+    slot = malloc(sizeof(struct rsec_time_slot));
+    assert(slot);
+    memset(slot, 0, sizeof(struct rsec_time_slot));
+    pthread_mutex_lock(&rsec_time_lock);
+    slot->next = rsec_time_live;
+    rsec_time_live = slot;
+    pthread_mutex_unlock(&rsec_time_lock);
+    pthread_setspecific(rsec_time_key, slot);
+    rsec_time_local = slot;
+    return &slot->acc[kind];
+}
+
+/**
+ * rsec_time_acc_merge - add the samples of src to dst
+ * @dst: accumulator
+ * @src: accumulator
+ */
+void rsec_time_acc_merge(struct rsec_time_acc *dst,
+                         const struct rsec_time_acc *src) {
+    if (!src->count) return;
+    if (!dst->count || src->min_cycles < dst->min_cycles)
+        dst->min_cycles = src->min_cycles;
+    if (src->max_cycles > dst->max_cycles) dst->max_cycles = src->max_cycles;
+    dst->sum_cycles += src->sum_cycles;
+    dst->count += src->count;
+}
+
+/**
+ * rsec_time_report - print the merged samples of every thread and kind
+ * Running threads should be done with their samples.
+ */
+void rsec_time_report(void) {
+    struct rsec_time_acc total;
+    struct rsec_time_slot *slot;
+    int kind;
+    for (kind = RSEC_TIME_EVICT; kind < RSEC_TIME_NUMBER; kind++) {
+        memset(&total, 0, sizeof(struct rsec_time_acc));
+        pthread_mutex_lock(&rsec_time_lock);
+        rsec_time_acc_merge(&total, &rsec_time_retired[kind]);
+        for (slot = rsec_time_live; slot; slot = slot->next)
+            rsec_time_acc_merge(&total, &slot->acc[kind]);
+        pthread_mutex_unlock(&rsec_time_lock);
+        if (!total.count) continue;
+        RSEC_PRINT("%s count:%lu average:%f min:%f max:%f\n",
+                   rsec_time_text[kind], (unsigned long)total.count,
+                   RSEC_CYCLES_TO_NS(total.sum_cycles) / total.count,
+                   RSEC_CYCLES_TO_NS(total.min_cycles),
+                   RSEC_CYCLES_TO_NS(total.max_cycles));
+    }
+}
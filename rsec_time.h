@@ -0,0 +1,74 @@
+#ifndef RSEC_TIME_HEADER
+#define RSEC_TIME_HEADER
+
+#include <stdint.h>
+
+/**
+ * rsec_time.h: TSC based timing for the probe path.
+ * rsec_time_start/rsec_time_end are fenced TSC reads (a few ns each) which
+ * neither the compiler nor the CPU moves across the measured code. Samples are
+ * kept as integer cycles and only converted to ns (rsec_tsc_per_ns, measured
+ * once by rsec_time_init) when they are reported. Accumulators are per thread
+ * and merged when the thread exits or is reported, so probing threads never
+ * share a lock. Every thread has one accumulator per kind of sample:
+ * 1. RSEC_TIME_EVICT - one run of the eviction set (rsec_evict_run)
+ * 2. RSEC_TIME_RELOAD - one reload timed by the TSC (rsec_hwts_read)
+ */
+
+#define RSEC_TIME_EVICT 1
+#define RSEC_TIME_RELOAD 2
+#define RSEC_TIME_NUMBER 3
+static const char *const rsec_time_text[] = {
+    "------RSEC STRING------", "RSEC_TIME_EVICT", "RSEC_TIME_RELOAD"};
+
+#define RSEC_TSC_CALIBRATE_NS (20 * 1000 * 1000)
+#define RSEC_CYCLES_TO_NS(cycles) ((double)(cycles) / rsec_tsc_per_ns)
+
+struct rsec_time_acc {
+    uint64_t count;
+    uint64_t sum_cycles;
+    uint64_t min_cycles;
+    uint64_t max_cycles;
+};
+
+extern double rsec_tsc_per_ns;
+
+/**
+ * rsec_time_start - TSC read that does not start before earlier instructions
+ */
+static inline uint64_t rsec_time_start(void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("lfence\n\trdtsc" : "=a"(lo), "=d"(hi)::"memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * rsec_time_end - TSC read after every earlier instruction retired
+ */
+static inline uint64_t rsec_time_end(void) {
+    uint32_t lo, hi, aux;
+    __asm__ __volatile__("rdtscp\n\tlfence"
+                         : "=a"(lo), "=d"(hi), "=c"(aux)::"memory");
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * rsec_time_acc_add - add one sample to an accumulator
+ * @acc: accumulator
+ * @cycles: sample
+ */
+static inline void rsec_time_acc_add(struct rsec_time_acc *acc,
+                                     uint64_t cycles) {
+    if (!acc->count || cycles < acc->min_cycles) acc->min_cycles = cycles;
+    if (cycles > acc->max_cycles) acc->max_cycles = cycles;
+    acc->sum_cycles += cycles;
+    acc->count++;
+}
+
+void rsec_time_init(void);
+struct rsec_time_acc *rsec_time_thread_acc(int kind);
+void rsec_time_acc_merge(struct rsec_time_acc *dst,
+                         const struct rsec_time_acc *src);
+void rsec_time_report(void);
+
+#endif
@@ -0,0 +1,68 @@
+#include "rsec.h"
+#include <math.h>
+
+/**
+ * rsec_trial.c: the stop rule is evaluated after every trial, so it only
+ * keeps running sums (no allocation, one sqrt or one add per trial).
+ */
+
+/**
+ * rsec_trial_setup - read the trial controller knobs of rsec_config
+ * @trial: controller
+ */
+void rsec_trial_setup(struct rsec_trial_inf *trial) {
+    double p1 = RSEC_TRIAL_PERMILLE(rsec_config.trial_accuracy);
+    memset(trial, 0, sizeof(struct rsec_trial_inf));
+    trial->mode = rsec_config.trial_mode;
+    trial->min_trials = rsec_config.trial_min;
+    trial->error = RSEC_TRIAL_PERMILLE(rsec_config.trial_error);
+    // H0: accuracy 0.5 (no leak), H1: accuracy p1
+    trial->llr_correct = log(p1 / 0.5);
+    trial->llr_wrong = log((1 - p1) / 0.5);
+    trial->llr_accept = log((1 - RSEC_TRIAL_SPRT_BETA) / RSEC_TRIAL_SPRT_ALPHA);
+    trial->llr_reject = log(RSEC_TRIAL_SPRT_BETA / (1 - RSEC_TRIAL_SPRT_ALPHA));
+}
+
+/**
+ * rsec_trial_reset - start the trials of a new target
+ * @trial: controller
+ */
+void rsec_trial_reset(struct rsec_trial_inf *trial) {
+    trial->num_trials = 0;
+    trial->num_correct = 0;
+    trial->llr = 0;
+}
+
+/**
+ * rsec_trial_wilson - half width of the Wilson score interval
+ */
+static double rsec_trial_wilson(int num_correct, int num_trials) {
+    double n = num_trials, p = num_correct / n;
+    double z2 = RSEC_TRIAL_Z * RSEC_TRIAL_Z;
+    return RSEC_TRIAL_Z * sqrt(p * (1 - p) / n + z2 / (4 * n * n)) /
+           (1 + z2 / n);
+}
+
+/**
+ * rsec_trial_add - add the answer of one trial
+ * Returns 1 if the target needs no more trials.
+ * @trial: controller
+ * @correct: whether the attacker answered correctly
+ */
+int rsec_trial_add(struct rsec_trial_inf *trial, int correct) {
+    trial->num_trials++;
+    if (correct) trial->num_correct++;
+    switch (trial->mode) {
+        case RSEC_TRIAL_MODE_WILSON:
+            if (trial->num_trials < trial->min_trials) return 0;
+            return rsec_trial_wilson(trial->num_correct, trial->num_trials) <=
+                   trial->error;
+        case RSEC_TRIAL_MODE_SPRT:
+            trial->llr += correct ? trial->llr_correct : trial->llr_wrong;
+            if (trial->num_trials < trial->min_trials) return 0;
+            return trial->llr >= trial->llr_accept ||
+                   trial->llr <= trial->llr_reject;
+        default:
+            return 0;
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef RSEC_TRIAL_HEADER
+#define RSEC_TRIAL_HEADER
+
+/**
+ * rsec_trial.h: adaptive number of trials per target.
+ * Instead of always running RSEC_ACCESS_TEST_TIME trials, the attacker stops
+ * a target once its running correct count is conclusive (never before
+ * trial_min trials):
+ * 1. RSEC_TRIAL_MODE_WILSON: the 95% Wilson score interval of the accuracy
+ *    is narrower than +-trial_error
+ * 2. RSEC_TRIAL_MODE_SPRT: Wald's sequential probability ratio test between
+ *    chance (accuracy 0.5) and a leaking target (accuracy trial_accuracy)
+ *    accepts one of them with error rates RSEC_TRIAL_SPRT_ALPHA/BETA
+ * RSEC_ACCESS_TEST_TIME stays the upper bound. The attacker ends the target
+ * by sending RSEC_TRIAL_STOP instead of the next evict signal.
+ */
+
+#define RSEC_TRIAL_MODE_FIXED 1
+#define RSEC_TRIAL_MODE_WILSON 2
+#define RSEC_TRIAL_MODE_SPRT 3
+static const char *const rsec_trial_mode_text[] = {
+    "------RSEC STRING------", "RSEC_TRIAL_MODE_FIXED",
+    "RSEC_TRIAL_MODE_WILSON", "RSEC_TRIAL_MODE_SPRT"};
+
+// value of the evict signal which ends the trials of a target
+#define RSEC_TRIAL_STOP RSEC_SYNC_VALUE_MASK
+#define RSEC_TRIAL_Z 1.96
+#define RSEC_TRIAL_SPRT_ALPHA 0.01
+#define RSEC_TRIAL_SPRT_BETA 0.01
+// trial_error and trial_accuracy of rsec_config are in 1/1000
+#define RSEC_TRIAL_PERMILLE(value) ((value) / 1000.0)
+
+struct rsec_trial_inf {
+    int mode;
+    int min_trials;
+    int num_trials;
+    int num_correct;
+    double error;
+    /* SPRT: log-likelihood ratio and its bounds */
+    double llr;
+    double llr_correct;
+    double llr_wrong;
+    double llr_accept;
+    double llr_reject;
+};
+
+void rsec_trial_setup(struct rsec_trial_inf *trial);
+void rsec_trial_reset(struct rsec_trial_inf *trial);
+int rsec_trial_add(struct rsec_trial_inf *trial, int correct);
+
+#endif
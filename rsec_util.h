@@ -26,6 +26,10 @@
         exit(err_code);                            \
     }
 
+#define RSEC_CPU_RELAX() asm volatile("pause" ::: "memory")
+
+uint32_t rsec_fnv1a(const void *data, size_t length);
+
 //#define RSEC_MIN(a, b) (((a) < (b)) ? (a) : (b))
 //#define RSEC_MAX(a, b) (((a) > (b)) ? (a) : (b))
 //#define RSEC_ROUND_UP(N, S) ((((N) + (S) - 1) / (S)) * (S))
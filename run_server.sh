@@ -2,5 +2,7 @@
 source ./setup.json
 #make clean all
 sleep 1
-./init.o -b 1 -s 1 -c 2 -S 1 -I 0 -d $device -L 2
+./init.o -b 1 -s 1 -c 2 -S 1 -I 0 -d $device -L 2 -E $epoch -R $registry \
+	-N $data_path -V $verbs -F $config ${sweep:+-W $sweep} \
+	${strategy:+-P $strategy}
 
@@ -38,6 +38,12 @@ void *run_server(void *arg) {
     int ret;
     param_arr = malloc(num_threads * sizeof(struct configuration_params));
     thread_arr = malloc(num_threads * sizeof(pthread_t));
+    memcached_set_epoch(input_arg->epoch);
+    memcached_set_backend(input_arg->registry_mode);
+    mock_verbs_init(input_arg->verbs_mode, &rsec_config.mock_verbs);
+    rnic_sim_init(input_arg->data_path, RNIC_SIM_SEED + machine_id,
+                  &rsec_config.rnic_sim);
+    rsec_time_init();
     // initialize barrier
     ret = pthread_barrier_init(&local_barrier, NULL, input_arg->total_threads);
     if (ret)
@@ -85,6 +91,30 @@ void *main_server(void *arg) {
         ;
 }
 
+/**
+ * rsec_wait_terminate - wait until every machine publishes its terminate key
+ * @num_machines: number of machines in the experiment
+ */
+static void rsec_wait_terminate(int num_machines) {
+    char **terminate_keys = malloc(sizeof(char *) * num_machines);
+    void **values = malloc(sizeof(void *) * num_machines);
+    int per_machine;
+    for (per_machine = 0; per_machine < num_machines; per_machine++) {
+        terminate_keys[per_machine] = malloc(RSEC_MEMCACHED_STRING_LENGTH);
+        sprintf(terminate_keys[per_machine], RSEC_TERMINATE_STRING,
+                per_machine);
+    }
+    memcached_wait_published_multi((const char *const *)terminate_keys,
+                                   num_machines, values, NULL,
+                                   RSEC_MEMCACHED_WAIT_FOREVER);
+    for (per_machine = 0; per_machine < num_machines; per_machine++) {
+        free(terminate_keys[per_machine]);
+        free(values[per_machine]);
+    }
+    free(terminate_keys);
+    free(values);
+}
+
 /**
  * helper_code - major code helper is running in Pythia
  * 1. register all memory space
@@ -111,19 +141,14 @@ void helper_code(struct ib_inf *global_inf, struct ib_local_inf *local_inf,
     RSEC_PRINT("this is for RSEC_HELPER\n");
     {
         char *memcached_string = malloc(RSEC_MEMCACHED_STRING_LENGTH);
-        int per_machine;
 
         memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
         sprintf(memcached_string, RSEC_TERMINATE_STRING, input_arg->machine_id);
-        memcached_publish(memcached_string, &input_arg->machine_id,
-                          sizeof(int));
-
-        for (per_machine = 0; per_machine < global_inf->global_machines;
-             per_machine++) {
-            memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
-            sprintf(memcached_string, RSEC_TERMINATE_STRING, per_machine);
-            memcached_get_published_size(memcached_string, sizeof(int));
-        }
+        memcached_publish_expire(memcached_string, &input_arg->machine_id,
+                                 sizeof(int), RSEC_MEMCACHED_TRIAL_EXPIRATION);
+
+        rsec_wait_terminate(global_inf->global_machines);
+        memcached_cleanup_published();
         free(memcached_string);
         rsec_free_all(rsec_malloc_array);
         RSEC_PRINT("helper finish experiment\n");
@@ -211,19 +236,14 @@ void server_code(struct ib_inf *global_inf, struct ib_local_inf *local_inf,
 
     {
         char *memcached_string = malloc(RSEC_MEMCACHED_STRING_LENGTH);
-        int per_machine;
 
         memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
         sprintf(memcached_string, RSEC_TERMINATE_STRING, input_arg->machine_id);
-        memcached_publish(memcached_string, &input_arg->machine_id,
-                          sizeof(int));
-
-        for (per_machine = 0; per_machine < global_inf->global_machines;
-             per_machine++) {
-            memset(memcached_string, 0, RSEC_MEMCACHED_STRING_LENGTH);
-            sprintf(memcached_string, RSEC_TERMINATE_STRING, per_machine);
-            memcached_get_published_size(memcached_string, sizeof(int));
-        }
+        memcached_publish_expire(memcached_string, &input_arg->machine_id,
+                                 sizeof(int), RSEC_MEMCACHED_TRIAL_EXPIRATION);
+
+        rsec_wait_terminate(global_inf->global_machines);
+        memcached_cleanup_published();
         free(memcached_string);
         rsec_free_all(rsec_malloc_array);
         RSEC_PRINT("server finish experiment\n");
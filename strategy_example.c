@@ -0,0 +1,43 @@
+#include "rsec.h"
+
+/**
+ * strategy_example.c - example strategy plugin [rsec_strategy.h]
+ * Build with `make strategy_example.so` and load with
+ * `-P ./strategy_example.so:6-10`: every iteration draws the eviction set
+ * size among the powers of two 2^6..2^10 (the argument), the other hooks
+ * keep the pythia behavior. Plugins see the symbols of init.o (-rdynamic),
+ * e.g. rsec_config.
+ */
+
+struct example_state {
+    int min_shift;
+    int max_shift;
+    unsigned int seed;
+};
+
+static void *example_init(const char *arg) {
+    struct example_state *state = malloc(sizeof(struct example_state));
+    assert(state);
+    state->min_shift = 6;
+    state->max_shift = 10;
+    if (arg) sscanf(arg, "%d-%d", &state->min_shift, &state->max_shift);
+    assert(state->min_shift >= 0 && state->min_shift <= state->max_shift &&
+           state->max_shift < 31);
+    state->seed = 1;  // same draws in every run
+    return state;
+}
+
+static void example_fini(void *state) { free(state); }
+
+static int example_num_evict_target(void *state, int running_times) {
+    struct example_state *example = state;
+    int range = example->max_shift - example->min_shift + 1;
+    return 1 << (example->min_shift + rand_r(&example->seed) % range);
+}
+
+const struct rsec_strategy rsec_strategy = {
+    .name = "example",
+    .init = example_init,
+    .fini = example_fini,
+    .num_evict_target = example_num_evict_target,
+};
@@ -1,4 +1,8 @@
 #include "rsec.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 void dbg_printf(const char *fmt, ...) {
     va_list args;
     va_start(args, fmt);
@@ -14,34 +18,6 @@ void die_printf(const char *fmt, ...) {
     exit(1);
 }
 
-double count, sum_time;
-pthread_spinlock_t sum_diff_ns_lock;
-double sum_diff_ns(struct timespec *start, struct timespec *end, int flag) {
-    double ret;
-    double time;
-    if (flag == 0) {
-        time = (end->tv_sec - start->tv_sec) * 1000 * 1000 * 1000;
-        time += (end->tv_nsec - start->tv_nsec);
-        pthread_spin_lock(&sum_diff_ns_lock);
-        count++;
-        sum_time += time;
-        pthread_spin_unlock(&sum_diff_ns_lock);
-        return time;
-    } else if (flag == 1) {
-        ret = pthread_spin_init(&sum_diff_ns_lock, 0);
-        count = 0;
-        sum_time = 0;
-        return ret;
-    } else if (flag == 2) {
-        pthread_spin_lock(&sum_diff_ns_lock);
-        printf("[sum] sum:%f count:%f average:%f\n", sum_time, count,
-               sum_time / count);
-        pthread_spin_unlock(&sum_diff_ns_lock);
-        return 0;
-    } else
-        return 0;
-}
-
 double diff_ns(struct timespec *start, struct timespec *end) {
     double time;
 
@@ -72,6 +48,55 @@ int stick_this_thread_to_core(int core_id) {
     return pthread_setaffinity_np(current_thread, sizeof(cpu_set_t), &cpuset);
 }
 
+/**
+ * rsec_fnv1a - FNV-1a hash of a buffer
+ * @data: buffer
+ * @length: size of data
+ */
+uint32_t rsec_fnv1a(const void *data, size_t length) {
+    const unsigned char *byte = data;
+    uint32_t hash = 2166136261u;
+    size_t i;
+    for (i = 0; i < length; i++) hash = (hash ^ byte[i]) * 16777619u;
+    return hash;
+}
+
+/**
+ * rsec_shm_attach - create or attach a POSIX shared memory segment
+ * Exactly one process becomes the creator (zero-filled segment) and has to
+ * initialize it; other processes only wait until the segment is sized, so
+ * the creator still has to publish its own ready flag.
+ * @shm_name: segment name
+ * @size: segment size
+ * @creator: return 1 if this process created the segment
+ */
+void *rsec_shm_attach(const char *shm_name, size_t size, int *creator) {
+    struct stat st;
+    void *segment;
+    int fd;
+
+    *creator = 1;
+    fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        CPE(errno != EEXIST, "shm_open error", errno);
+        *creator = 0;
+        fd = shm_open(shm_name, O_RDWR, 0600);
+        CPE(fd < 0, "shm_open error", errno);
+        // wait until the creator has sized the segment
+        while (1) {
+            CPE(fstat(fd, &st), "fstat error", errno);
+            if (st.st_size >= size) break;
+            usleep(1000);
+        }
+    } else {
+        CPE(ftruncate(fd, size), "ftruncate error", errno);
+    }
+    segment = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    CPE(segment == MAP_FAILED, "mmap error", errno);
+    close(fd);
+    return segment;
+}
+
 void array_swap(int *a, int *b) {
     int temp = *a;
     *a = *b;